@@ -0,0 +1,691 @@
+ 
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Datos de animacion y evaluacion de keyframes, sin dependencias de OpenGL
+// (AnimatedModel los usa y bench.cpp los mide por separado)
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp> // For glm::quat and glm::slerp
+#include <assimp/scene.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <algorithm> // For std::upper_bound
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+
+// Bone structure
+struct Bone {
+    std::string name;
+    int id; // Unique ID for the bone, used as an index in boneTransforms
+    glm::mat4 offsetMatrix;
+};
+
+// Keyframes con tiempo en ticks (float) y valores glm, en lugar de aiVectorKey/aiQuatKey
+struct VectorKey {
+    float time;
+    glm::vec3 value;
+};
+
+struct QuatKey {
+    float time;
+    glm::quat value;
+};
+
+// Rango de keys de un hueso dentro de los arreglos contiguos de Animation.
+// Un count de 0 significa que el canal no esta animado (se usa identidad).
+struct BoneTrack {
+    uint32_t positionBegin = 0, positionCount = 0;
+    uint32_t rotationBegin = 0, rotationCount = 0;
+    uint32_t scaleBegin = 0, scaleCount = 0;
+};
+
+// Animation information structure.
+// Las pistas se indexan por Bone::id; las keys de todos los huesos viven en tres arreglos contiguos.
+struct Animation {
+    std::string name;
+    float duration;
+    float ticksPerSecond;
+    std::vector<BoneTrack> tracks;
+    std::vector<VectorKey> positionKeys;
+    std::vector<QuatKey> rotationKeys;
+    std::vector<VectorKey> scaleKeys;
+};
+
+// Ultimo key usado por cada canal de cada pista. Cada instancia que reproduce un clip tiene el suyo,
+// asi el siguiente frame solo tiene que comprobar el key actual y el siguiente.
+struct TrackCursor {
+    uint32_t position = 0, rotation = 0, scale = 0;
+};
+
+struct AnimationCursor {
+    std::vector<TrackCursor> tracks;
+
+    void reset(size_t trackCount) {
+        tracks.assign(trackCount, TrackCursor());
+    }
+};
+
+inline glm::mat4 convertMatrix(const aiMatrix4x4& from) {
+    glm::mat4 to;
+    to[0][0] = from.a1; to[0][1] = from.b1; to[0][2] = from.c1; to[0][3] = from.d1;
+    to[1][0] = from.a2; to[1][1] = from.b2; to[1][2] = from.c2; to[1][3] = from.d2;
+    to[2][0] = from.a3; to[2][1] = from.b3; to[2][2] = from.c3; to[2][3] = from.d3;
+    to[3][0] = from.a4; to[3][1] = from.b4; to[3][2] = from.c4; to[3][3] = from.d4;
+    return to;
+}
+
+// Convierte un aiAnimation a pistas indexadas por Bone::id.
+// Los canales de nodos que no son huesos se ignoran (no afectan a la paleta).
+inline Animation convertAnimation(const aiAnimation* anim, const std::map<std::string, Bone>& bones) {
+    Animation animation;
+    animation.name = anim->mName.C_Str();
+    animation.duration = static_cast<float>(anim->mDuration);
+    animation.ticksPerSecond = anim->mTicksPerSecond ? static_cast<float>(anim->mTicksPerSecond) : 25.0f;
+    animation.tracks.resize(bones.size());
+
+    for (unsigned int j = 0; j < anim->mNumChannels; j++) {
+        const aiNodeAnim* channel = anim->mChannels[j];
+        auto it = bones.find(channel->mNodeName.C_Str());
+        if (it == bones.end() || it->second.id >= (int)animation.tracks.size()) {
+            continue;
+        }
+        BoneTrack& track = animation.tracks[it->second.id];
+
+        track.positionBegin = static_cast<uint32_t>(animation.positionKeys.size());
+        track.positionCount = channel->mNumPositionKeys;
+        for (unsigned int k = 0; k < channel->mNumPositionKeys; k++) {
+            const aiVectorKey& key = channel->mPositionKeys[k];
+            animation.positionKeys.push_back({static_cast<float>(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+        }
+
+        track.rotationBegin = static_cast<uint32_t>(animation.rotationKeys.size());
+        track.rotationCount = channel->mNumRotationKeys;
+        for (unsigned int k = 0; k < channel->mNumRotationKeys; k++) {
+            const aiQuatKey& key = channel->mRotationKeys[k];
+            animation.rotationKeys.push_back({static_cast<float>(key.mTime), glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z)});
+        }
+
+        track.scaleBegin = static_cast<uint32_t>(animation.scaleKeys.size());
+        track.scaleCount = channel->mNumScalingKeys;
+        for (unsigned int k = 0; k < channel->mNumScalingKeys; k++) {
+            const aiVectorKey& key = channel->mScalingKeys[k];
+            animation.scaleKeys.push_back({static_cast<float>(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+        }
+    }
+    return animation;
+}
+
+// Devuelve k tal que keys[k].time <= animTime < keys[k + 1].time (count >= 2).
+// Primero prueba el key del frame anterior y el siguiente (reproduccion normal, O(1));
+// si el tiempo salto hacia atras (bucle) o muy adelante, hace una busqueda binaria.
+template <typename Key>
+inline uint32_t findKeyIndex(const Key* keys, uint32_t count, float animTime, uint32_t& cursor) {
+    uint32_t k = cursor;
+    if (k + 1 < count && keys[k].time <= animTime) {
+        if (animTime < keys[k + 1].time) {
+            return k;
+        }
+        if (k + 2 < count && animTime < keys[k + 2].time) {
+            cursor = k + 1;
+            return k + 1;
+        }
+    }
+    // Primer key con time > animTime, buscando en [1, count - 1)
+    const Key* first = keys + 1;
+    const Key* last = keys + count - 1;
+    const Key* it = std::upper_bound(first, last, animTime,
+                                     [](float t, const Key& key) { return t < key.time; });
+    k = static_cast<uint32_t>(it - keys) - 1;
+    cursor = k;
+    return k;
+}
+
+// Factor de interpolacion entre dos keys, limitado a [0, 1] (antes del primer key o despues
+// del ultimo se mantiene el valor del extremo).
+inline float keyBlendFactor(float t0, float t1, float animTime) {
+    float span = t1 - t0;
+    if (span <= 0.0f) {
+        return 0.0f;
+    }
+    return glm::clamp((animTime - t0) / span, 0.0f, 1.0f);
+}
+
+inline glm::vec3 sampleVectorKeys(const VectorKey* keys, uint32_t count, float animTime, uint32_t& cursor, const glm::vec3& fallback) {
+    if (count == 0) {
+        return fallback;
+    }
+    if (count == 1) {
+        return keys[0].value;
+    }
+    uint32_t k = findKeyIndex(keys, count, animTime, cursor);
+    float t = keyBlendFactor(keys[k].time, keys[k + 1].time, animTime);
+    return glm::mix(keys[k].value, keys[k + 1].value, t);
+}
+
+inline glm::quat sampleQuatKeys(const QuatKey* keys, uint32_t count, float animTime, uint32_t& cursor) {
+    if (count == 0) {
+        return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+    if (count == 1) {
+        return keys[0].value;
+    }
+    uint32_t k = findKeyIndex(keys, count, animTime, cursor);
+    float t = keyBlendFactor(keys[k].time, keys[k + 1].time, animTime);
+    return glm::slerp(keys[k].value, keys[k + 1].value, t);
+}
+
+// Transformacion local (T * R * S) del hueso boneId en el instante animTime (en ticks)
+inline glm::mat4 getInterpolatedBoneTransform(const Animation& anim, int boneId, float animTime, AnimationCursor& cursor) {
+    const BoneTrack& track = anim.tracks[boneId];
+    TrackCursor& c = cursor.tracks[boneId];
+
+    glm::vec3 position = sampleVectorKeys(anim.positionKeys.data() + track.positionBegin, track.positionCount, animTime, c.position, glm::vec3(0.0f));
+    glm::quat rotation = sampleQuatKeys(anim.rotationKeys.data() + track.rotationBegin, track.rotationCount, animTime, c.rotation);
+    glm::vec3 scale = sampleVectorKeys(anim.scaleKeys.data() + track.scaleBegin, track.scaleCount, animTime, c.scale, glm::vec3(1.0f));
+
+    // Equivale a translate * mat4_cast(rotation) * scale sin las dos multiplicaciones de matrices
+    glm::mat4 transform = glm::mat4_cast(rotation);
+    transform[0] *= scale.x;
+    transform[1] *= scale.y;
+    transform[2] *= scale.z;
+    transform[3] = glm::vec4(position, 1.0f);
+    return transform;
+}
+
+// Jerarquia de nodos aplanada. Los nodos estan en orden topologico (parents[i] < i), asi que
+// la pose global se calcula con un solo recorrido lineal, sin recursion ni nombres.
+// Solo se guardan los nodos que son huesos o tienen algun hueso por debajo.
+struct Skeleton {
+    std::vector<int> parents;             // Indice del nodo padre, -1 para la raiz
+    std::vector<glm::mat4> bindLocal;     // mTransformation de cada nodo (pose de enlace)
+    std::vector<int> boneIds;             // Bone::id del nodo, -1 si no es un hueso
+    std::vector<glm::mat4> boneOffsets;   // offsetMatrix indexada por Bone::id
+    std::vector<std::string> names;       // Solo para depuracion
+
+    size_t nodeCount() const { return parents.size(); }
+    size_t boneCount() const { return boneOffsets.size(); }
+};
+
+// Que los arreglos del esqueleto cuadren entre si (para los que llegan de un archivo): cada nodo
+// tiene matriz y Bone::id, su padre va antes que el (calculateBoneTransformations recorre en orden)
+// y su Bone::id es -1 o un indice de boneOffsets.
+inline bool skeletonConsistent(const Skeleton& skeleton) {
+    const size_t nodeCount = skeleton.nodeCount();
+    if (skeleton.bindLocal.size() != nodeCount || skeleton.boneIds.size() != nodeCount) {
+        return false;
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const int parent = skeleton.parents[i];
+        const int boneId = skeleton.boneIds[i];
+        if (parent < -1 || parent >= static_cast<int>(i) || boneId < -1 ||
+            (boneId >= 0 && static_cast<size_t>(boneId) >= skeleton.boneCount())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Devuelve true si el nodo o alguno de sus descendientes es un hueso
+inline bool appendSkeletonNode(const aiNode* node, int parent, const std::map<std::string, Bone>& bones, Skeleton& skeleton) {
+    auto it = bones.find(node->mName.C_Str());
+    int index = static_cast<int>(skeleton.parents.size());
+    skeleton.parents.push_back(parent);
+    skeleton.bindLocal.push_back(convertMatrix(node->mTransformation));
+    skeleton.boneIds.push_back(it != bones.end() ? it->second.id : -1);
+    skeleton.names.push_back(node->mName.C_Str());
+
+    bool used = it != bones.end();
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        used |= appendSkeletonNode(node->mChildren[i], index, bones, skeleton);
+    }
+    if (!used) {
+        // Subarbol sin huesos: los nodos se agregaron al final, se pueden quitar sin romper los indices
+        skeleton.parents.resize(index);
+        skeleton.bindLocal.resize(index);
+        skeleton.boneIds.resize(index);
+        skeleton.names.resize(index);
+    }
+    return used;
+}
+
+inline Skeleton buildSkeleton(const aiNode* root, const std::map<std::string, Bone>& bones) {
+    Skeleton skeleton;
+    appendSkeletonNode(root, -1, bones, skeleton);
+    skeleton.boneOffsets.assign(bones.size(), glm::mat4(1.0f));
+    for (const auto& [name, bone] : bones) {
+        if (bone.id >= 0 && bone.id < (int)skeleton.boneOffsets.size()) {
+            skeleton.boneOffsets[bone.id] = bone.offsetMatrix;
+        }
+    }
+    return skeleton;
+}
+
+// Calcula la paleta de huesos (boneTransforms[boneId] = global * offset) para el instante animTime.
+// globalTransforms es un buffer de trabajo con una matriz por nodo; anim puede ser nullptr
+// (pose de enlace). Ninguno de los dos buffers se redimensiona si ya tiene el tamaño correcto.
+// skippedBones (opcional, uno por Bone::id): los huesos marcados no se muestrean y quedan en la
+// pose de enlace (dedos, cara... en personajes lejanos, ver AnimationLod.hpp).
+inline void calculateBoneTransformations(const Skeleton& skeleton, const Animation* anim, float animTime,
+                                         AnimationCursor* cursor,
+                                         std::vector<glm::mat4>& globalTransforms,
+                                         std::vector<glm::mat4>& boneTransforms,
+                                         const uint8_t* skippedBones = nullptr) {
+    const size_t nodeCount = skeleton.nodeCount();
+    if (globalTransforms.size() != nodeCount) {
+        globalTransforms.resize(nodeCount);
+    }
+    if (boneTransforms.size() != skeleton.boneCount()) {
+        boneTransforms.resize(skeleton.boneCount(), glm::mat4(1.0f));
+    }
+    const bool animated = anim && cursor;
+
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const int boneId = skeleton.boneIds[i];
+        glm::mat4 local = (animated && boneId >= 0 && !(skippedBones && skippedBones[boneId]))
+            ? getInterpolatedBoneTransform(*anim, boneId, animTime, *cursor)
+            : skeleton.bindLocal[i];
+
+        const int parent = skeleton.parents[i];
+        globalTransforms[i] = parent >= 0 ? globalTransforms[parent] * local : local;
+
+        if (boneId >= 0) {
+            boneTransforms[boneId] = globalTransforms[i] * skeleton.boneOffsets[boneId];
+        }
+    }
+}
+
+// --- Poses locales y mezcla de clips ---
+
+// Canales de LocalPose: traslacion, rotacion (x, y, z, w) y escala
+enum PoseChannel { PoseTX, PoseTY, PoseTZ, PoseRX, PoseRY, PoseRZ, PoseRW, PoseSX, PoseSY, PoseSZ, kPoseChannels };
+
+// Pose en espacio local (T, R, S) de cada hueso, indexada por Bone::id, como estructura de arreglos:
+// cada canal es contiguo y tiene relleno hasta un multiplo de 4 huesos, asi la mezcla procesa
+// 4 huesos por instruccion sin caso especial al final.
+struct LocalPose {
+    std::vector<float> data; // kPoseChannels canales de stride floats
+    size_t boneCount = 0;
+    size_t stride = 0;
+
+    void resize(size_t bones) {
+        boneCount = bones;
+        stride = (bones + 3) & ~size_t(3);
+        data.assign(stride * kPoseChannels, 0.0f);
+    }
+
+    float* channel(int c) { return data.data() + c * stride; }
+    const float* channel(int c) const { return data.data() + c * stride; }
+
+    void set(size_t bone, const glm::vec3& t, const glm::quat& r, const glm::vec3& s) {
+        float* d = data.data() + bone;
+        d[PoseTX * stride] = t.x; d[PoseTY * stride] = t.y; d[PoseTZ * stride] = t.z;
+        d[PoseRX * stride] = r.x; d[PoseRY * stride] = r.y; d[PoseRZ * stride] = r.z; d[PoseRW * stride] = r.w;
+        d[PoseSX * stride] = s.x; d[PoseSY * stride] = s.y; d[PoseSZ * stride] = s.z;
+    }
+
+    // T * R * S, como getInterpolatedBoneTransform
+    glm::mat4 matrix(size_t bone) const {
+        const float* d = data.data() + bone;
+        glm::quat rotation(d[PoseRW * stride], d[PoseRX * stride], d[PoseRY * stride], d[PoseRZ * stride]);
+        glm::mat4 transform = glm::mat4_cast(rotation);
+        transform[0] *= d[PoseSX * stride];
+        transform[1] *= d[PoseSY * stride];
+        transform[2] *= d[PoseSZ * stride];
+        transform[3] = glm::vec4(d[PoseTX * stride], d[PoseTY * stride], d[PoseTZ * stride], 1.0f);
+        return transform;
+    }
+};
+
+// Pose de enlace de los huesos (bindLocal descompuesto en T, R, S)
+inline void skeletonBindPose(const Skeleton& skeleton, LocalPose& out) {
+    out.resize(skeleton.boneCount());
+    for (size_t i = 0; i < skeleton.nodeCount(); ++i) {
+        const int boneId = skeleton.boneIds[i];
+        if (boneId < 0 || static_cast<size_t>(boneId) >= out.boneCount) {
+            continue;
+        }
+        const glm::mat4& m = skeleton.bindLocal[i];
+        glm::vec3 scale(glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])));
+        glm::mat4 rotation(1.0f);
+        for (int c = 0; c < 3; ++c) {
+            rotation[c] = scale[c] > 0.0f ? m[c] * (1.0f / scale[c]) : glm::vec4(0.0f);
+        }
+        out.set(boneId, glm::vec3(m[3]), glm::normalize(glm::quat_cast(rotation)), scale);
+    }
+}
+
+// Muestrea anim en animTime (ticks) para todos los huesos. Sin clip se copia la pose de enlace,
+// igual que para los huesos marcados en skippedBones.
+inline void sampleLocalPose(const Animation* anim, float animTime, AnimationCursor& cursor, const LocalPose& bindPose, LocalPose& out,
+                            const uint8_t* skippedBones = nullptr) {
+    if (!anim) {
+        out = bindPose;
+        return;
+    }
+    if (out.boneCount != bindPose.boneCount) {
+        out.resize(bindPose.boneCount);
+    }
+    const size_t tracked = std::min(out.boneCount, anim->tracks.size());
+    for (size_t b = 0; b < tracked; ++b) {
+        if (skippedBones && skippedBones[b]) {
+            for (int c = 0; c < kPoseChannels; ++c) {
+                out.channel(c)[b] = bindPose.channel(c)[b];
+            }
+            continue;
+        }
+        const BoneTrack& track = anim->tracks[b];
+        TrackCursor& c = cursor.tracks[b];
+        out.set(b,
+                sampleVectorKeys(anim->positionKeys.data() + track.positionBegin, track.positionCount, animTime, c.position, glm::vec3(0.0f)),
+                sampleQuatKeys(anim->rotationKeys.data() + track.rotationBegin, track.rotationCount, animTime, c.rotation),
+                sampleVectorKeys(anim->scaleKeys.data() + track.scaleBegin, track.scaleCount, animTime, c.scale, glm::vec3(1.0f)));
+    }
+    for (size_t b = tracked; b < out.boneCount; ++b) {
+        out.set(b, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    }
+}
+
+// out = suma de poses[k] * weights[k], con los pesos normalizados. Las rotaciones se suman en el
+// hemisferio de la primera pose y se normalizan al final (nlerp): entre clips de locomocion, con
+// rotaciones parecidas, no se distingue de un slerp y el resultado no depende del orden.
+// Todas las poses deben tener el mismo numero de huesos.
+inline void blendLocalPoses(const LocalPose* const* poses, const float* weights, size_t count, LocalPose& out) {
+    if (count == 0) {
+        return;
+    }
+    float total = 0.0f;
+    for (size_t k = 0; k < count; ++k) {
+        total += weights[k];
+    }
+    const float scale = total > 0.0f ? 1.0f / total : 1.0f / count;
+    if (out.boneCount != poses[0]->boneCount) {
+        out.resize(poses[0]->boneCount);
+    }
+    const size_t n = out.stride;
+    const LocalPose& reference = *poses[0];
+
+    for (size_t k = 0; k < count; ++k) {
+        const LocalPose& pose = *poses[k];
+        const float w = (total > 0.0f ? weights[k] : 1.0f) * scale;
+        const bool first = k == 0;
+#if defined(__SSE2__)
+        const __m128 weight = _mm_set1_ps(w);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        for (size_t i = 0; i < n; i += 4) {
+            // Mismo hemisferio que la pose de referencia: se cambia el signo del peso donde el producto escalar es negativo
+            __m128 dot = _mm_setzero_ps();
+            for (int c = PoseRX; c <= PoseRW; ++c) {
+                dot = _mm_add_ps(dot, _mm_mul_ps(_mm_loadu_ps(pose.channel(c) + i), _mm_loadu_ps(reference.channel(c) + i)));
+            }
+            __m128 rotationWeight = _mm_xor_ps(weight, _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signBit));
+            for (int c = 0; c < kPoseChannels; ++c) {
+                __m128 w4 = (c >= PoseRX && c <= PoseRW) ? rotationWeight : weight;
+                __m128 value = _mm_mul_ps(_mm_loadu_ps(pose.channel(c) + i), w4);
+                float* o = out.channel(c) + i;
+                _mm_storeu_ps(o, first ? value : _mm_add_ps(_mm_loadu_ps(o), value));
+            }
+        }
+#else
+        for (size_t i = 0; i < n; ++i) {
+            float dot = 0.0f;
+            for (int c = PoseRX; c <= PoseRW; ++c) {
+                dot += pose.channel(c)[i] * reference.channel(c)[i];
+            }
+            for (int c = 0; c < kPoseChannels; ++c) {
+                float w4 = (c >= PoseRX && c <= PoseRW && dot < 0.0f) ? -w : w;
+                float value = pose.channel(c)[i] * w4;
+                out.channel(c)[i] = first ? value : out.channel(c)[i] + value;
+            }
+        }
+#endif
+    }
+
+    float* rx = out.channel(PoseRX);
+    float* ry = out.channel(PoseRY);
+    float* rz = out.channel(PoseRZ);
+    float* rw = out.channel(PoseRW);
+#if defined(__SSE2__)
+    const __m128 epsilon = _mm_set1_ps(1e-12f);
+    for (size_t i = 0; i < n; i += 4) {
+        __m128 x = _mm_loadu_ps(rx + i), y = _mm_loadu_ps(ry + i), z = _mm_loadu_ps(rz + i), w = _mm_loadu_ps(rw + i);
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSquared, epsilon)));
+        _mm_storeu_ps(rx + i, _mm_mul_ps(x, inverseLength));
+        _mm_storeu_ps(ry + i, _mm_mul_ps(y, inverseLength));
+        _mm_storeu_ps(rz + i, _mm_mul_ps(z, inverseLength));
+        _mm_storeu_ps(rw + i, _mm_mul_ps(w, inverseLength));
+    }
+#else
+    for (size_t i = 0; i < n; ++i) {
+        float inverseLength = 1.0f / std::sqrt(std::max(rx[i] * rx[i] + ry[i] * ry[i] + rz[i] * rz[i] + rw[i] * rw[i], 1e-12f));
+        rx[i] *= inverseLength; ry[i] *= inverseLength; rz[i] *= inverseLength; rw[i] *= inverseLength;
+    }
+#endif
+}
+
+// Paleta a partir de una pose local ya mezclada: un solo recorrido de la jerarquia
+inline void calculateBoneTransformations(const Skeleton& skeleton, const LocalPose& pose,
+                                         std::vector<glm::mat4>& globalTransforms,
+                                         std::vector<glm::mat4>& boneTransforms) {
+    const size_t nodeCount = skeleton.nodeCount();
+    if (globalTransforms.size() != nodeCount) {
+        globalTransforms.resize(nodeCount);
+    }
+    if (boneTransforms.size() != skeleton.boneCount()) {
+        boneTransforms.resize(skeleton.boneCount(), glm::mat4(1.0f));
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const int boneId = skeleton.boneIds[i];
+        const bool posed = boneId >= 0 && static_cast<size_t>(boneId) < pose.boneCount;
+        glm::mat4 local = posed ? pose.matrix(boneId) : skeleton.bindLocal[i];
+
+        const int parent = skeleton.parents[i];
+        globalTransforms[i] = parent >= 0 ? globalTransforms[parent] * local : local;
+
+        if (boneId >= 0) {
+            boneTransforms[boneId] = globalTransforms[i] * skeleton.boneOffsets[boneId];
+        }
+    }
+}
+
+// Pesos de locomocion: cada clip tiene la velocidad a la que se ve natural (en orden creciente) y
+// speed se reparte entre los dos vecinos; fuera del rango todo va al extremo.
+inline void locomotionWeights(const float* clipSpeeds, size_t count, float speed, float* weights) {
+    for (size_t i = 0; i < count; ++i) {
+        weights[i] = 0.0f;
+    }
+    if (count == 0) {
+        return;
+    }
+    if (speed <= clipSpeeds[0]) {
+        weights[0] = 1.0f;
+        return;
+    }
+    for (size_t i = 0; i + 1 < count; ++i) {
+        if (speed <= clipSpeeds[i + 1]) {
+            float span = clipSpeeds[i + 1] - clipSpeeds[i];
+            float t = span > 0.0f ? (speed - clipSpeeds[i]) / span : 1.0f;
+            weights[i] = 1.0f - t;
+            weights[i + 1] = t;
+            return;
+        }
+    }
+    weights[count - 1] = 1.0f;
+}
+
+// Un clip dentro de una mezcla. weight se acerca a targetWeight con la velocidad de fundido del estado.
+struct AnimationLayer {
+    const Animation* animation = nullptr; // nullptr = pose de enlace
+    float weight = 0.0f;
+    float targetWeight = 0.0f;
+    float time = 0.0f; // Ticks
+    AnimationCursor cursor;
+};
+
+// Estado de animacion de un personaje: tiempo, cursores y buffers de salida propios.
+// El esqueleto y los clips son solo lectura, asi que varios estados pueden compartirlos
+// y actualizarse en paralelo (ver AnimationWorkers.hpp).
+// Con un solo clip la paleta sale directamente de los keys; con capas (initLayers) cada clip se
+// muestrea a una LocalPose, las poses se mezclan y la paleta se construye una vez con el resultado.
+struct AnimationState {
+    const Skeleton* skeleton = nullptr;
+    const Animation* animation = nullptr; // nullptr = pose de enlace
+    float animationTime = 0.0f;
+    AnimationCursor cursor;
+    std::vector<glm::mat4> globalTransforms; // Buffer de trabajo, una matriz por nodo
+    std::vector<glm::mat4> boneTransforms;   // Paleta que se sube al shader
+
+    // Mezcla (vacio = un solo clip)
+    std::vector<AnimationLayer> layers;
+    float fadeSeconds = 0.25f; // Tiempo para que un peso pase de 0 a 1
+    float phase = 0.0f;        // Fase normalizada [0, 1) comun a las capas, para que los ciclos vayan a la par
+    LocalPose bindPose;
+    std::vector<LocalPose> layerPoses;
+    LocalPose blendedPose;
+    std::vector<const LocalPose*> blendInputs;
+    std::vector<float> blendWeights;
+
+    // Huesos que evaluate() deja en la pose de enlace (uno por Bone::id, nullptr = ninguno)
+    const uint8_t* skippedBones = nullptr;
+
+    // Reserva todos los buffers; despues de esto update() no vuelve a reservar memoria
+    void init(const Skeleton& skel, const Animation* anim) {
+        skeleton = &skel;
+        animation = anim;
+        animationTime = 0.0f;
+        cursor.reset(anim ? anim->tracks.size() : 0);
+        globalTransforms.assign(skel.nodeCount(), glm::mat4(1.0f));
+        boneTransforms.assign(skel.boneCount(), glm::mat4(1.0f));
+        layers.clear();
+    }
+
+    // Mezcla de clips (nullptr = pose de enlace). Empieza con todo el peso en la capa active.
+    void initLayers(const Skeleton& skel, const std::vector<const Animation*>& clips, size_t active = 0) {
+        init(skel, nullptr);
+        layers.resize(clips.size());
+        layerPoses.resize(clips.size());
+        for (size_t i = 0; i < clips.size(); ++i) {
+            AnimationLayer& layer = layers[i];
+            layer.animation = clips[i];
+            layer.weight = layer.targetWeight = i == active ? 1.0f : 0.0f;
+            layer.time = 0.0f;
+            layer.cursor.reset(clips[i] ? clips[i]->tracks.size() : 0);
+            layerPoses[i].resize(skel.boneCount());
+        }
+        phase = 0.0f;
+        skeletonBindPose(skel, bindPose);
+        blendedPose.resize(skel.boneCount());
+        blendInputs.reserve(clips.size());
+        blendWeights.reserve(clips.size());
+    }
+
+    // Pesos objetivo de las capas (se normalizan al mezclar); el cambio se funde en fadeSeconds
+    void setLayerTargets(const float* weights) {
+        for (size_t i = 0; i < layers.size(); ++i) {
+            layers[i].targetWeight = weights[i];
+        }
+    }
+
+    void update(float deltaTime) {
+        advance(deltaTime);
+        evaluate();
+    }
+
+    // Solo el reloj: tiempo, fase y fundido de pesos, sin tocar la paleta (personajes fuera de
+    // pantalla o entre dos evaluaciones de un LOD reducido)
+    void advance(float deltaTime) {
+        if (!skeleton) {
+            return;
+        }
+        if (!layers.empty()) {
+            advanceLayers(deltaTime);
+            return;
+        }
+        if (animation && animation->duration > 0.0f) {
+            animationTime += deltaTime * animation->ticksPerSecond;
+            animationTime = std::fmod(animationTime, animation->duration);
+        }
+    }
+
+    // Paleta para el instante actual
+    void evaluate() {
+        if (!skeleton) {
+            return;
+        }
+        if (!layers.empty()) {
+            evaluateLayers();
+            return;
+        }
+        calculateBoneTransformations(*skeleton, animation, animationTime, animation ? &cursor : nullptr,
+                                     globalTransforms, boneTransforms, skippedBones);
+    }
+
+private:
+    void advanceLayers(float deltaTime) {
+        // Fundido de pesos y avance de la fase con la media ponderada de los ciclos por segundo
+        const float step = fadeSeconds > 0.0f ? deltaTime / fadeSeconds : 1.0f;
+        float cyclesPerSecond = 0.0f, animatedWeight = 0.0f;
+        for (AnimationLayer& layer : layers) {
+            float delta = layer.targetWeight - layer.weight;
+            layer.weight += std::min(std::max(delta, -step), step);
+            if (layer.animation && layer.animation->duration > 0.0f && layer.weight > 0.0f) {
+                cyclesPerSecond += layer.weight * layer.animation->ticksPerSecond / layer.animation->duration;
+                animatedWeight += layer.weight;
+            }
+        }
+        if (animatedWeight > 0.0f) {
+            phase = std::fmod(phase + deltaTime * cyclesPerSecond / animatedWeight, 1.0f);
+        }
+    }
+
+    void evaluateLayers() {
+        // Solo se muestrean las capas con peso
+        blendInputs.clear();
+        blendWeights.clear();
+        for (size_t i = 0; i < layers.size(); ++i) {
+            AnimationLayer& layer = layers[i];
+            if (layer.weight <= 0.001f) {
+                continue;
+            }
+            if (layer.animation) {
+                layer.time = phase * layer.animation->duration;
+                sampleLocalPose(layer.animation, layer.time, layer.cursor, bindPose, layerPoses[i], skippedBones);
+                blendInputs.push_back(&layerPoses[i]);
+            } else {
+                blendInputs.push_back(&bindPose);
+            }
+            blendWeights.push_back(layer.weight);
+        }
+        if (blendInputs.empty()) {
+            blendInputs.push_back(&bindPose);
+            blendWeights.push_back(1.0f);
+        }
+        const LocalPose* pose = blendInputs[0];
+        if (blendInputs.size() > 1) {
+            blendLocalPoses(blendInputs.data(), blendWeights.data(), blendInputs.size(), blendedPose);
+            pose = &blendedPose;
+        }
+        calculateBoneTransformations(*skeleton, *pose, globalTransforms, boneTransforms);
+    }
+};
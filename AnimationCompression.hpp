@@ -0,0 +1,451 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Almacenamiento comprimido de clips, para tener muchos por personaje:
+// 1. Al importar se quitan los keys que la interpolacion reproduce dentro de una tolerancia
+//    (y las pistas constantes quedan en un solo key).
+// 2. Los keys restantes se cuantizan a 8 bytes: tiempo en 16 bits sobre la duracion, posicion y
+//    escala en 16 bits por componente sobre la caja de la pista, y rotaciones con "smallest three"
+//    (las tres componentes menores en 15 bits y el indice de la mayor en los bits altos).
+// 3. AnimationClipLibrary descomprime un clip a Animation solo cuando alguien lo reproduce y guarda
+//    los mas recientes en una LRU pequeña; el resto de la biblioteca se queda comprimida.
+// Sin OpenGL, como Animation.hpp.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Animation.hpp"
+
+// Error maximo que se acepta al quitar un key (en el espacio local del hueso)
+struct AnimationCompressionSettings {
+    float positionTolerance = 0.001f;  // Unidades del modelo
+    float rotationTolerance = 0.0005f; // Radianes
+    float scaleTolerance = 0.0005f;
+};
+
+struct PackedVectorKey {
+    uint16_t time;
+    uint16_t value[3];
+};
+
+struct PackedQuatKey {
+    uint16_t time;
+    uint16_t value[3];
+};
+
+// Rangos de keys como BoneTrack, mas la caja sobre la que se cuantizan posicion y escala
+struct CompressedTrack {
+    BoneTrack keys;
+    glm::vec3 positionMin = glm::vec3(0.0f), positionExtent = glm::vec3(0.0f);
+    glm::vec3 scaleMin = glm::vec3(1.0f), scaleExtent = glm::vec3(0.0f);
+};
+
+struct CompressedAnimation {
+    std::string name;
+    float duration = 0.0f;
+    float ticksPerSecond = 25.0f;
+    std::vector<CompressedTrack> tracks;
+    std::vector<PackedVectorKey> positionKeys;
+    std::vector<PackedQuatKey> rotationKeys;
+    std::vector<PackedVectorKey> scaleKeys;
+    uint32_t sourceKeyCount = 0; // Keys antes de la reduccion (para los informes)
+};
+
+// --- Memoria ---
+
+// Lo que ocupa una Animation con esa cantidad de pistas y keys
+inline size_t animationBytes(size_t nameLength, size_t trackCount, size_t vectorKeyCount, size_t quatKeyCount) {
+    return sizeof(Animation) + nameLength + trackCount * sizeof(BoneTrack) + vectorKeyCount * sizeof(VectorKey) +
+           quatKeyCount * sizeof(QuatKey);
+}
+
+inline size_t animationBytes(const Animation& animation) {
+    return animationBytes(animation.name.size(), animation.tracks.size(),
+                          animation.positionKeys.size() + animation.scaleKeys.size(), animation.rotationKeys.size());
+}
+
+// Lo que ocupara clip como Animation al descomprimirlo (decompressAnimation conserva pistas y keys)
+inline size_t decompressedAnimationBytes(const CompressedAnimation& clip) {
+    return animationBytes(clip.name.size(), clip.tracks.size(), clip.positionKeys.size() + clip.scaleKeys.size(),
+                          clip.rotationKeys.size());
+}
+
+inline size_t compressedAnimationBytes(const CompressedAnimation& clip) {
+    return sizeof(CompressedAnimation) + clip.name.size() + clip.tracks.size() * sizeof(CompressedTrack) +
+           (clip.positionKeys.size() + clip.scaleKeys.size()) * sizeof(PackedVectorKey) +
+           clip.rotationKeys.size() * sizeof(PackedQuatKey);
+}
+
+inline size_t animationKeyCount(const Animation& animation) {
+    return animation.positionKeys.size() + animation.rotationKeys.size() + animation.scaleKeys.size();
+}
+
+inline size_t compressedKeyCount(const CompressedAnimation& clip) {
+    return clip.positionKeys.size() + clip.rotationKeys.size() + clip.scaleKeys.size();
+}
+
+// --- Reduccion de keys ---
+
+// Quita de keys[0..count) los keys que la interpolacion entre sus vecinos conservados reproduce
+// con un error <= tolerance (error(interpolado, original)). Si todos caben en la tolerancia del
+// primero la pista queda constante, con un solo key.
+template <typename Key, typename Interpolate, typename Error>
+std::vector<Key> reduceKeys(const Key* keys, uint32_t count, float tolerance, Interpolate interpolate, Error error) {
+    std::vector<Key> kept;
+    if (count == 0) {
+        return kept;
+    }
+    bool constant = true;
+    for (uint32_t i = 1; i < count && constant; ++i) {
+        constant = error(keys[0].value, keys[i].value) <= tolerance;
+    }
+    if (constant || count <= 2) {
+        kept.assign(keys, keys + (constant ? 1 : count));
+        return kept;
+    }
+
+    // Greedy: se intenta unir el ultimo key conservado con el siguiente al candidato, comprobando
+    // todos los keys intermedios contra los originales
+    kept.push_back(keys[0]);
+    uint32_t anchor = 0;
+    for (uint32_t i = 1; i + 1 < count; ++i) {
+        const Key& a = keys[anchor];
+        const Key& b = keys[i + 1];
+        bool removable = true;
+        for (uint32_t j = anchor + 1; j <= i && removable; ++j) {
+            float t = keyBlendFactor(a.time, b.time, keys[j].time);
+            removable = error(interpolate(a.value, b.value, t), keys[j].value) <= tolerance;
+        }
+        if (!removable) {
+            kept.push_back(keys[i]);
+            anchor = i;
+        }
+    }
+    kept.push_back(keys[count - 1]);
+    return kept;
+}
+
+inline std::vector<VectorKey> reduceVectorKeys(const VectorKey* keys, uint32_t count, float tolerance) {
+    return reduceKeys(keys, count, tolerance,
+                      [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); },
+                      [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); });
+}
+
+// Angulo entre las dos rotaciones (q y -q son la misma). Con la cuerda |a - b| = 2 sin(angulo / 4)
+// en vez de acos(dot), que en float no distingue angulos por debajo de ~0.001 rad.
+inline float quatAngle(const glm::quat& a, const glm::quat& b) {
+    glm::quat c = glm::dot(a, b) < 0.0f ? -b : b;
+    float dx = a.x - c.x, dy = a.y - c.y, dz = a.z - c.z, dw = a.w - c.w;
+    float chord = std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+    return 4.0f * std::asin(std::min(1.0f, 0.5f * chord));
+}
+
+inline std::vector<QuatKey> reduceQuatKeys(const QuatKey* keys, uint32_t count, float tolerance) {
+    return reduceKeys(keys, count, tolerance,
+                      [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); },
+                      quatAngle);
+}
+
+// --- Cuantizacion ---
+
+inline uint16_t quantizeUnit16(float value) {
+    return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+}
+
+inline float dequantizeUnit16(uint16_t value) {
+    return value * (1.0f / 65535.0f);
+}
+
+inline uint16_t quantizeKeyTime(float time, float duration) {
+    return duration > 0.0f ? quantizeUnit16(time / duration) : 0;
+}
+
+inline float dequantizeKeyTime(uint16_t time, float duration) {
+    return dequantizeUnit16(time) * duration;
+}
+
+inline void packVector(const glm::vec3& value, const glm::vec3& minimum, const glm::vec3& extent, uint16_t out[3]) {
+    for (int c = 0; c < 3; ++c) {
+        out[c] = extent[c] > 0.0f ? quantizeUnit16((value[c] - minimum[c]) / extent[c]) : 0;
+    }
+}
+
+inline glm::vec3 unpackVector(const uint16_t in[3], const glm::vec3& minimum, const glm::vec3& extent) {
+    return minimum + extent * glm::vec3(dequantizeUnit16(in[0]), dequantizeUnit16(in[1]), dequantizeUnit16(in[2]));
+}
+
+// Las tres componentes menores de un cuaternion unitario estan en [-1/sqrt(2), 1/sqrt(2)]
+constexpr float kQuatComponentRange = 0.70710678f;
+
+inline uint16_t packQuatComponent(float c) {
+    float unit = (c / kQuatComponentRange) * 0.5f + 0.5f;
+    return static_cast<uint16_t>(std::lround(std::min(std::max(unit, 0.0f), 1.0f) * 32767.0f));
+}
+
+inline float unpackQuatComponent(uint16_t c) {
+    return ((c & 0x7fff) * (1.0f / 32767.0f) * 2.0f - 1.0f) * kQuatComponentRange;
+}
+
+// Smallest three: se guarda la rotacion con la componente mayor positiva (q y -q son la misma),
+// asi esa componente se reconstruye como sqrt(1 - las otras al cuadrado)
+inline void packQuat(const glm::quat& rotation, uint16_t out[3]) {
+    glm::quat q = glm::normalize(rotation);
+    float c[4] = {q.x, q.y, q.z, q.w};
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (std::fabs(c[i]) > std::fabs(c[largest])) {
+            largest = i;
+        }
+    }
+    float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+    for (int i = 0, o = 0; i < 4; ++i) {
+        if (i != largest) {
+            out[o++] = packQuatComponent(c[i] * sign);
+        }
+    }
+    out[0] |= static_cast<uint16_t>((largest & 1) << 15);
+    out[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+inline glm::quat unpackQuat(const uint16_t in[3]) {
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+    float small[3] = {unpackQuatComponent(in[0]), unpackQuatComponent(in[1]), unpackQuatComponent(in[2])};
+    float c[4];
+    float sum = 0.0f;
+    for (int i = 0, s = 0; i < 4; ++i) {
+        if (i != largest) {
+            c[i] = small[s++];
+            sum += c[i] * c[i];
+        }
+    }
+    c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    return glm::normalize(glm::quat(c[3], c[0], c[1], c[2]));
+}
+
+// --- Clips ---
+
+inline void vectorKeyBounds(const std::vector<VectorKey>& keys, glm::vec3& minimum, glm::vec3& extent) {
+    glm::vec3 maximum = keys[0].value;
+    minimum = keys[0].value;
+    for (const VectorKey& key : keys) {
+        minimum = glm::min(minimum, key.value);
+        maximum = glm::max(maximum, key.value);
+    }
+    extent = maximum - minimum;
+}
+
+inline CompressedAnimation compressAnimation(const Animation& animation,
+                                             const AnimationCompressionSettings& settings = AnimationCompressionSettings()) {
+    CompressedAnimation clip;
+    clip.name = animation.name;
+    clip.duration = animation.duration;
+    clip.ticksPerSecond = animation.ticksPerSecond;
+    clip.sourceKeyCount = static_cast<uint32_t>(animationKeyCount(animation));
+    clip.tracks.resize(animation.tracks.size());
+
+    for (size_t t = 0; t < animation.tracks.size(); ++t) {
+        const BoneTrack& source = animation.tracks[t];
+        CompressedTrack& track = clip.tracks[t];
+
+        std::vector<VectorKey> positions = reduceVectorKeys(animation.positionKeys.data() + source.positionBegin,
+                                                            source.positionCount, settings.positionTolerance);
+        track.keys.positionBegin = static_cast<uint32_t>(clip.positionKeys.size());
+        track.keys.positionCount = static_cast<uint32_t>(positions.size());
+        if (!positions.empty()) {
+            vectorKeyBounds(positions, track.positionMin, track.positionExtent);
+        }
+        for (const VectorKey& key : positions) {
+            PackedVectorKey packed;
+            packed.time = quantizeKeyTime(key.time, clip.duration);
+            packVector(key.value, track.positionMin, track.positionExtent, packed.value);
+            clip.positionKeys.push_back(packed);
+        }
+
+        std::vector<QuatKey> rotations = reduceQuatKeys(animation.rotationKeys.data() + source.rotationBegin,
+                                                        source.rotationCount, settings.rotationTolerance);
+        track.keys.rotationBegin = static_cast<uint32_t>(clip.rotationKeys.size());
+        track.keys.rotationCount = static_cast<uint32_t>(rotations.size());
+        for (const QuatKey& key : rotations) {
+            PackedQuatKey packed;
+            packed.time = quantizeKeyTime(key.time, clip.duration);
+            packQuat(key.value, packed.value);
+            clip.rotationKeys.push_back(packed);
+        }
+
+        std::vector<VectorKey> scales = reduceVectorKeys(animation.scaleKeys.data() + source.scaleBegin,
+                                                         source.scaleCount, settings.scaleTolerance);
+        track.keys.scaleBegin = static_cast<uint32_t>(clip.scaleKeys.size());
+        track.keys.scaleCount = static_cast<uint32_t>(scales.size());
+        if (!scales.empty()) {
+            vectorKeyBounds(scales, track.scaleMin, track.scaleExtent);
+        }
+        for (const VectorKey& key : scales) {
+            PackedVectorKey packed;
+            packed.time = quantizeKeyTime(key.time, clip.duration);
+            packVector(key.value, track.scaleMin, track.scaleExtent, packed.value);
+            clip.scaleKeys.push_back(packed);
+        }
+    }
+    return clip;
+}
+
+// Vuelve al formato que evalua Animation.hpp (mismos rangos de keys, valores ya cuantizados)
+inline Animation decompressAnimation(const CompressedAnimation& clip) {
+    Animation animation;
+    animation.name = clip.name;
+    animation.duration = clip.duration;
+    animation.ticksPerSecond = clip.ticksPerSecond;
+    animation.tracks.resize(clip.tracks.size());
+    animation.positionKeys.resize(clip.positionKeys.size());
+    animation.rotationKeys.resize(clip.rotationKeys.size());
+    animation.scaleKeys.resize(clip.scaleKeys.size());
+
+    for (size_t t = 0; t < clip.tracks.size(); ++t) {
+        const CompressedTrack& track = clip.tracks[t];
+        animation.tracks[t] = track.keys;
+        for (uint32_t k = track.keys.positionBegin; k < track.keys.positionBegin + track.keys.positionCount; ++k) {
+            const PackedVectorKey& packed = clip.positionKeys[k];
+            animation.positionKeys[k] = {dequantizeKeyTime(packed.time, clip.duration),
+                                         unpackVector(packed.value, track.positionMin, track.positionExtent)};
+        }
+        for (uint32_t k = track.keys.rotationBegin; k < track.keys.rotationBegin + track.keys.rotationCount; ++k) {
+            const PackedQuatKey& packed = clip.rotationKeys[k];
+            animation.rotationKeys[k] = {dequantizeKeyTime(packed.time, clip.duration), unpackQuat(packed.value)};
+        }
+        for (uint32_t k = track.keys.scaleBegin; k < track.keys.scaleBegin + track.keys.scaleCount; ++k) {
+            const PackedVectorKey& packed = clip.scaleKeys[k];
+            animation.scaleKeys[k] = {dequantizeKeyTime(packed.time, clip.duration),
+                                      unpackVector(packed.value, track.scaleMin, track.scaleExtent)};
+        }
+    }
+    return animation;
+}
+
+// Los rangos de keys de cada pista caben en sus arreglos (para archivos leidos de disco)
+inline bool compressedAnimationConsistent(const CompressedAnimation& clip) {
+    for (const CompressedTrack& track : clip.tracks) {
+        if (track.keys.positionBegin + size_t(track.keys.positionCount) > clip.positionKeys.size() ||
+            track.keys.rotationBegin + size_t(track.keys.rotationCount) > clip.rotationKeys.size() ||
+            track.keys.scaleBegin + size_t(track.keys.scaleCount) > clip.scaleKeys.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Biblioteca de clips ---
+
+struct AnimationClipMemory {
+    std::string name;
+    size_t sourceKeys = 0, keptKeys = 0;
+    size_t compressedBytes = 0;
+    size_t decompressedBytes = 0; // Lo que ocupa como Animation cuando se reproduce
+};
+
+struct AnimationClipLibraryStats {
+    size_t decompressions = 0, hits = 0, evictions = 0;
+};
+
+// Clips comprimidos de un modelo y una LRU de los descomprimidos. Los clips se entregan con
+// shared_ptr: salir de la LRU no libera un clip que alguien sigue reproduciendo, y si se vuelve a
+// pedir mientras vive se reutiliza sin descomprimir. Solo desde un hilo (el de carga/juego).
+class AnimationClipLibrary {
+public:
+    explicit AnimationClipLibrary(size_t hotCapacity = 4) : capacity(std::max<size_t>(hotCapacity, 1)) {}
+
+    void assign(std::vector<CompressedAnimation> compressedClips) {
+        clips = std::move(compressedClips);
+        live.assign(clips.size(), std::weak_ptr<const Animation>());
+        hot.clear();
+    }
+
+    size_t size() const { return clips.size(); }
+    const CompressedAnimation& compressed(size_t index) const { return clips[index]; }
+
+    std::shared_ptr<const Animation> acquire(size_t index) {
+        if (index >= clips.size()) {
+            return nullptr;
+        }
+        std::shared_ptr<const Animation> clip = live[index].lock();
+        if (clip) {
+            ++stats.hits;
+        } else {
+            clip = std::make_shared<const Animation>(decompressAnimation(clips[index]));
+            live[index] = clip;
+            ++stats.decompressions;
+        }
+        auto it = std::find(hot.begin(), hot.end(), clip);
+        if (it != hot.end()) {
+            hot.erase(it);
+        }
+        hot.insert(hot.begin(), clip);
+        if (hot.size() > capacity) {
+            hot.pop_back();
+            ++stats.evictions;
+        }
+        return clip;
+    }
+
+    std::vector<AnimationClipMemory> memoryReport() const {
+        std::vector<AnimationClipMemory> report;
+        for (const CompressedAnimation& clip : clips) {
+            AnimationClipMemory entry;
+            entry.name = clip.name;
+            entry.sourceKeys = clip.sourceKeyCount;
+            entry.keptKeys = compressedKeyCount(clip);
+            entry.compressedBytes = compressedAnimationBytes(clip);
+            entry.decompressedBytes = decompressedAnimationBytes(clip);
+            report.push_back(entry);
+        }
+        return report;
+    }
+
+    size_t compressedBytes() const {
+        size_t bytes = 0;
+        for (const CompressedAnimation& clip : clips) {
+            bytes += compressedAnimationBytes(clip);
+        }
+        return bytes;
+    }
+
+    // Bytes de los clips descomprimidos que siguen vivos (en la LRU o reproduciendose)
+    size_t residentBytes() const {
+        size_t bytes = 0;
+        for (const auto& weak : live) {
+            if (std::shared_ptr<const Animation> clip = weak.lock()) {
+                bytes += animationBytes(*clip);
+            }
+        }
+        return bytes;
+    }
+
+    const AnimationClipLibraryStats& statistics() const { return stats; }
+
+private:
+    std::vector<CompressedAnimation> clips;
+    std::vector<std::weak_ptr<const Animation>> live;  // Por clip, mientras alguien lo tenga
+    std::vector<std::shared_ptr<const Animation>> hot; // El mas reciente primero
+    size_t capacity;
+    AnimationClipLibraryStats stats;
+};
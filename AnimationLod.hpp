@@ -0,0 +1,316 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Nivel de detalle de la animacion, sin llamadas a OpenGL.
+//
+// Cada personaje cae en un tier segun su tamaño en pantalla y su distancia a la camara:
+//   Full      cerca: la paleta se evalua en cada frame.
+//   Reduced   mediano: se evalua cada 2 frames y entre medias se interpola.
+//   Far       pequeño o lejano: cada 4 frames, sin los huesos de poca influencia (dedos, cara...).
+//   Baked     multitud al fondo: solo avanza el reloj y el shader lee la paleta horneada del frame
+//             que toca (PoseBaking.hpp, AnimatedModel::setBakedPlayback).
+//   Offscreen fuera del frustum: solo avanza el reloj; al volver a verse se evalua en el acto.
+// El reloj de todos avanza en cada frame, asi que bajar de tier no desincroniza nada. Las
+// evaluaciones de Reduced y Far se reparten entre frames (no todos los personajes a la vez) y la
+// paleta interpolada va un intervalo por detras de la ultima evaluacion: a la distancia a la que
+// se usa no se nota, y evita extrapolar.
+//
+// Cada tier se mide por separado contra su propio presupuesto de tiempo por frame. Si Reduced o
+// Far se pasan, su intervalo crece (hasta maxInterval) y vuelve al nominal cuando sobra margen.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Animation.hpp"
+#include "AnimationWorkers.hpp"
+#include "Frustum.hpp"
+
+enum class AnimationLodTier : uint8_t { Full, Reduced, Far, Baked, Offscreen };
+constexpr size_t kAnimationLodTiers = 5;
+
+inline const char* animationLodTierName(AnimationLodTier tier) {
+    switch (tier) {
+    case AnimationLodTier::Full: return "full";
+    case AnimationLodTier::Reduced: return "reduced";
+    case AnimationLodTier::Far: return "far";
+    case AnimationLodTier::Baked: return "baked";
+    default: return "offscreen";
+    }
+}
+
+struct AnimationLodSettings {
+    // Altura en pantalla (fraccion de la altura del viewport) por debajo de la que se baja de tier
+    float reducedScreenSize = 0.25f;
+    float farScreenSize = 0.08f;
+    float bakedScreenSize = 0.03f;
+    // Distancias a partir de las que se baja de tier aunque el personaje se vea grande (FOV estrecho)
+    float reducedDistance = 60.0f;
+    float farDistance = 150.0f;
+    float bakedDistance = 250.0f;
+    // Frames entre evaluaciones de cada tier (Baked y Offscreen no se evaluan)
+    uint32_t interval[kAnimationLodTiers] = {1, 2, 4, 0, 0};
+    uint32_t maxInterval = 8;
+    // Presupuesto por frame de cada tier, en milisegundos
+    float budgetMs[kAnimationLodTiers] = {2.0f, 1.0f, 0.5f, 0.1f, 0.1f};
+    // Fraccion del peso total de skinning por debajo de la que un hueso no se evalua en Far
+    float boneInfluenceThreshold = 0.005f;
+};
+
+// Altura aproximada de bounds en pantalla (1 = todo el viewport), con su esfera envolvente
+inline float projectedScreenSize(const Aabb& bounds, const glm::vec3& cameraPos, float tanHalfFovY) {
+    glm::vec3 extent = bounds.max - bounds.min;
+    float radius = 0.5f * std::sqrt(glm::dot(extent, extent));
+    glm::vec3 offset = bounds.center() - cameraPos;
+    float distance = std::sqrt(glm::dot(offset, offset));
+    if (distance <= radius) {
+        return 1.0f;
+    }
+    return radius / (distance * tanHalfFovY);
+}
+
+// bakedAvailable: el personaje puede reproducir poses horneadas (si no, se queda en Far)
+inline AnimationLodTier selectAnimationLodTier(const AnimationLodSettings& settings, bool visible, float screenSize, float distance,
+                                               bool bakedAvailable = false) {
+    if (!visible) {
+        return AnimationLodTier::Offscreen;
+    }
+    if (bakedAvailable && (screenSize < settings.bakedScreenSize || distance > settings.bakedDistance)) {
+        return AnimationLodTier::Baked;
+    }
+    if (screenSize < settings.farScreenSize || distance > settings.farDistance) {
+        return AnimationLodTier::Far;
+    }
+    if (screenSize < settings.reducedScreenSize || distance > settings.reducedDistance) {
+        return AnimationLodTier::Reduced;
+    }
+    return AnimationLodTier::Full;
+}
+
+// Huesos que se pueden dejar en la pose de enlace: su influencia (fraccion del peso de skinning,
+// indexada por Bone::id) y la de todos sus descendientes esta por debajo de threshold. Un hueso con
+// poco peso pero con hijos importantes (p. ej. la clavicula) se sigue evaluando.
+inline std::vector<uint8_t> lowInfluenceBones(const Skeleton& skeleton, const std::vector<float>& influence, float threshold) {
+    const size_t nodeCount = skeleton.nodeCount();
+    std::vector<uint8_t> important(nodeCount, 0);
+    // Los padres van antes que los hijos: recorriendo al reves cada nodo ya tiene a sus hijos resueltos
+    for (size_t i = nodeCount; i-- > 0;) {
+        const int boneId = skeleton.boneIds[i];
+        if (boneId >= 0 && (static_cast<size_t>(boneId) >= influence.size() || influence[boneId] >= threshold)) {
+            important[i] = 1;
+        }
+        const int parent = skeleton.parents[i];
+        if (important[i] && parent >= 0) {
+            important[parent] = 1;
+        }
+    }
+    std::vector<uint8_t> skipped(skeleton.boneCount(), 0);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const int boneId = skeleton.boneIds[i];
+        if (boneId >= 0 && static_cast<size_t>(boneId) < skipped.size() && !important[i]) {
+            skipped[boneId] = 1;
+        }
+    }
+    return skipped;
+}
+
+// out = from + (to - from) * t, matriz a matriz. Entre dos evaluaciones cercanas la rotacion casi no
+// cambia, asi que la mezcla lineal no encoge la malla de forma visible.
+inline void blendPalettes(const glm::mat4* from, const glm::mat4* to, size_t count, float t, glm::mat4* out) {
+    for (size_t b = 0; b < count; ++b) {
+        for (int c = 0; c < 4; ++c) {
+            out[b][c] = from[b][c] + (to[b][c] - from[b][c]) * t;
+        }
+    }
+}
+
+struct AnimationLodTierStats {
+    uint32_t characters = 0;   // Personajes en el tier este frame
+    uint32_t evaluated = 0;    // Paletas calculadas desde los keys
+    uint32_t interpolated = 0; // Paletas interpoladas entre dos evaluaciones
+    uint32_t clockOnly = 0;    // Solo se avanzo el reloj
+    uint32_t bonesSkipped = 0; // Huesos dejados en la pose de enlace
+    uint32_t interval = 1;     // Intervalo efectivo (puede superar al nominal si no llega el presupuesto)
+    double milliseconds = 0.0;
+    uint32_t overBudgetFrames = 0; // Acumulado desde el principio
+};
+
+class AnimationLodScheduler {
+public:
+    AnimationLodSettings settings;
+
+    // lowDetailBones (opcional, uno por Bone::id, ver lowInfluenceBones) debe vivir mientras se use el estado
+    size_t add(AnimationState* state, const std::vector<uint8_t>* lowDetailBones = nullptr) {
+        Entry entry;
+        entry.state = state;
+        if (lowDetailBones && !lowDetailBones->empty()) {
+            entry.lowDetailBones = lowDetailBones->data();
+            entry.skippedCount = static_cast<uint32_t>(std::count(lowDetailBones->begin(), lowDetailBones->end(), 1));
+        }
+        entries.push_back(std::move(entry));
+        return entries.size() - 1;
+    }
+
+    void clear() { entries.clear(); }
+    size_t size() const { return entries.size(); }
+
+    void setTier(size_t i, AnimationLodTier tier) { entries[i].tier = tier; }
+    AnimationLodTier tier(size_t i) const { return entries[i].tier; }
+
+    // Avanza todos los relojes y deja en boneTransforms la paleta de cada personaje visible
+    void update(AnimationWorkerPool& pool, float deltaTime) {
+        for (size_t t = 0; t < kAnimationLodTiers; ++t) {
+            AnimationLodTierStats& s = stats[t];
+            uint32_t overBudget = s.overBudgetFrames;
+            uint32_t interval = std::max(s.interval, settings.interval[t]);
+            s = AnimationLodTierStats();
+            s.overBudgetFrames = overBudget;
+            s.interval = clockOnly(static_cast<AnimationLodTier>(t)) ? 0 : interval;
+            tierEntries[t].clear();
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            tierEntries[static_cast<size_t>(entries[i].tier)].push_back(i);
+        }
+
+        for (size_t t = 0; t < kAnimationLodTiers; ++t) {
+            const AnimationLodTier tier = static_cast<AnimationLodTier>(t);
+            const std::vector<size_t>& indices = tierEntries[t];
+            AnimationLodTierStats& s = stats[t];
+            s.characters = static_cast<uint32_t>(indices.size());
+            if (indices.empty()) {
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            TierJob job{&indices, tier, s.interval, deltaTime};
+            // Solo dos punteros capturados: std::function no reserva memoria
+            pool.parallelFor(indices.size(), 4, [this, &job](size_t begin, size_t end) { runTier(job, begin, end); });
+            s.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            s.evaluated = job.evaluated;
+            s.bonesSkipped = job.bonesSkipped;
+            if (clockOnly(tier)) {
+                s.clockOnly = s.characters;
+            } else if (tier != AnimationLodTier::Full) {
+                s.interpolated = s.characters - s.evaluated;
+            }
+            adaptInterval(t);
+        }
+        ++frame;
+    }
+
+    const AnimationLodTierStats& tierStats(AnimationLodTier tier) const { return stats[static_cast<size_t>(tier)]; }
+
+private:
+    struct Entry {
+        AnimationState* state = nullptr;
+        const uint8_t* lowDetailBones = nullptr;
+        uint32_t skippedCount = 0;
+        AnimationLodTier tier = AnimationLodTier::Full;
+        // Ultimas dos evaluaciones, para interpolar en los frames intermedios
+        std::vector<glm::mat4> from, to;
+        uint32_t framesSinceEvaluation = 0;
+        bool hasPalette = false; // from/to validos (se pierde al pasar por Full, Baked u Offscreen)
+    };
+
+    struct TierJob {
+        const std::vector<size_t>* indices;
+        AnimationLodTier tier;
+        uint32_t interval;
+        float deltaTime;
+        std::atomic<uint32_t> evaluated{0}, bonesSkipped{0};
+    };
+
+    std::vector<Entry> entries;
+    std::vector<size_t> tierEntries[kAnimationLodTiers];
+    AnimationLodTierStats stats[kAnimationLodTiers];
+    uint64_t frame = 0;
+
+    void runTier(TierJob& job, size_t begin, size_t end) {
+        uint32_t evaluated = 0, bonesSkipped = 0;
+        for (size_t k = begin; k < end; ++k) {
+            const size_t i = (*job.indices)[k];
+            if (updateEntry(entries[i], i, job.tier, job.interval, job.deltaTime)) {
+                ++evaluated;
+                if (entries[i].state->skippedBones) {
+                    bonesSkipped += entries[i].skippedCount;
+                }
+            }
+        }
+        job.evaluated += evaluated;
+        job.bonesSkipped += bonesSkipped;
+    }
+
+    static bool clockOnly(AnimationLodTier tier) {
+        return tier == AnimationLodTier::Baked || tier == AnimationLodTier::Offscreen;
+    }
+
+    // Devuelve true si se evaluo la paleta
+    bool updateEntry(Entry& entry, size_t index, AnimationLodTier tier, uint32_t interval, float deltaTime) {
+        AnimationState& state = *entry.state;
+        state.advance(deltaTime);
+        if (clockOnly(tier)) {
+            entry.hasPalette = false;
+            return false;
+        }
+        state.skippedBones = tier == AnimationLodTier::Far ? entry.lowDetailBones : nullptr;
+        if (tier == AnimationLodTier::Full || interval <= 1) {
+            state.evaluate();
+            entry.hasPalette = false;
+            return true;
+        }
+
+        // Cada personaje evalua en un frame distinto del intervalo (segun su indice)
+        ++entry.framesSinceEvaluation;
+        const bool due = (frame + index) % interval == 0 || entry.framesSinceEvaluation >= interval;
+        if (!entry.hasPalette || due) {
+            state.evaluate();
+            if (!entry.hasPalette) {
+                entry.from = state.boneTransforms;
+                entry.to = state.boneTransforms;
+                entry.hasPalette = true;
+            } else {
+                entry.from.swap(entry.to);
+                entry.to = state.boneTransforms;
+            }
+            entry.framesSinceEvaluation = 0;
+        }
+        float t = std::min(1.0f, static_cast<float>(entry.framesSinceEvaluation + 1) / interval);
+        blendPalettes(entry.from.data(), entry.to.data(), std::min(entry.to.size(), state.boneTransforms.size()), t,
+                      state.boneTransforms.data());
+        return entry.framesSinceEvaluation == 0;
+    }
+
+    // Reduced y Far alargan su intervalo si se pasan del presupuesto y lo recuperan con margen
+    void adaptInterval(size_t t) {
+        AnimationLodTierStats& s = stats[t];
+        if (s.milliseconds <= settings.budgetMs[t]) {
+            if (s.milliseconds < 0.5 * settings.budgetMs[t] && s.interval > settings.interval[t]) {
+                --s.interval;
+            }
+            return;
+        }
+        ++s.overBudgetFrames;
+        const AnimationLodTier tier = static_cast<AnimationLodTier>(t);
+        if ((tier == AnimationLodTier::Reduced || tier == AnimationLodTier::Far) && s.interval < settings.maxInterval) {
+            ++s.interval;
+        }
+    }
+};
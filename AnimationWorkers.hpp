@@ -0,0 +1,154 @@
+
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Actualizacion de animaciones de muchos personajes en paralelo, sin llamadas a OpenGL.
+// Cada AnimationState escribe solo en sus propios buffers, asi que no hace falta
+// sincronizar nada mas que el inicio y el final del lote.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Animation.hpp"
+
+// Pool de hilos persistente. El hilo que llama a parallelFor tambien trabaja,
+// asi que con threadCount = 1 no se crea ningun hilo extra.
+class AnimationWorkerPool {
+public:
+    explicit AnimationWorkerPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~AnimationWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startCondition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    AnimationWorkerPool(const AnimationWorkerPool&) = delete;
+    AnimationWorkerPool& operator=(const AnimationWorkerPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Ejecuta fn(begin, end) sobre [0, count) en bloques de chunkSize, repartidos entre todos los hilos.
+    // Vuelve cuando todos los bloques han terminado.
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) {
+            return;
+        }
+        chunkSize = std::max<size_t>(1, chunkSize);
+        if (workers.empty() || count <= chunkSize) {
+            fn(0, count);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            jobChunk = chunkSize;
+            nextIndex.store(0, std::memory_order_relaxed);
+            activeWorkers = static_cast<unsigned>(workers.size());
+            ++generation;
+        }
+        startCondition.notify_all();
+
+        runChunks(fn, count, chunkSize);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+        job = nullptr;
+    }
+
+    // Avanza el reloj y calcula la paleta de huesos de todos los estados
+    void updateAnimations(AnimationState* const* states, size_t count, float deltaTime) {
+        // Bloques pequeños para repartir bien la carga cuando los esqueletos tienen tamaños distintos
+        parallelFor(count, 4, [states, deltaTime](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                states[i]->update(deltaTime);
+            }
+        });
+    }
+
+    void updateAnimations(const std::vector<AnimationState*>& states, float deltaTime) {
+        updateAnimations(states.data(), states.size(), deltaTime);
+    }
+
+private:
+    void runChunks(const std::function<void(size_t, size_t)>& fn, size_t count, size_t chunkSize) {
+        while (true) {
+            size_t begin = nextIndex.fetch_add(chunkSize, std::memory_order_relaxed);
+            if (begin >= count) {
+                break;
+            }
+            fn(begin, std::min(begin + chunkSize, count));
+        }
+    }
+
+    void workerLoop() {
+        unsigned long long seenGeneration = 0;
+        while (true) {
+            const std::function<void(size_t, size_t)>* currentJob;
+            size_t count, chunkSize;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                currentJob = job;
+                count = jobCount;
+                chunkSize = jobChunk;
+            }
+
+            runChunks(*currentJob, count, chunkSize);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activeWorkers == 0) {
+                doneCondition.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    bool stopping = false;
+    unsigned long long generation = 0;
+    unsigned activeWorkers = 0;
+
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunk = 1;
+    std::atomic<size_t> nextIndex{0};
+};
@@ -0,0 +1,414 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Formato binario "horneado" de un modelo (ver bake.cpp). Guarda los buffers de vertices
+// e indices tal como se suben a la GPU, el esqueleto aplanado y las pistas de animacion,
+// para que en tiempo de ejecucion baste con mapear el archivo en memoria sin pasar por Assimp.
+//
+// Estructura (little-endian, floats y glm en el layout nativo del compilador):
+//   BakedModelHeader
+//   por cada mesh:      texto(textura) arreglo(vertices) arreglo(indices) arreglo(pesos) arreglo(IDs)
+//   esqueleto:          arreglo(parents) arreglo(bindLocal) arreglo(boneIds) arreglo(boneOffsets) nombres
+//   por cada animacion: texto(nombre) duracion tps arreglo(tracks) arreglo(pos) arreglo(rot) arreglo(escala)
+//   poses horneadas:    huesos fps arreglo(rangos por clip) arreglo(texels) (PoseBaking.hpp)
+// Cada arreglo es un uint64 con la cantidad de elementos seguido de los datos alineados a 16 bytes.
+// Un texto es un uint64 con la longitud seguido de los caracteres (sin '\0').
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Animation.hpp"
+#include "AnimationCompression.hpp"
+#include "MappedFile.hpp"
+#include "ModelImport.hpp"
+#include "PoseBaking.hpp"
+
+// Cambiar al modificar el layout o cualquiera de los tipos que se guardan tal cual
+// (CompressedTrack, PackedVectorKey, PackedQuatKey, BakedPoseRange, MeshData), o lo que importModel
+// deja en los meshes (4: soldados y reordenados por optimizeMesh)
+constexpr uint32_t kBakedModelVersion = 4;
+constexpr char kBakedModelMagic[4] = {'P', 'T', 'M', 'B'};
+constexpr size_t kBakedModelAlignment = 16;
+
+struct BakedModelHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;        // Tamano y fecha de modificacion del archivo original,
+    int64_t sourceModifiedTime; // para detectar cuando hay que volver a hornear
+    uint32_t meshCount;
+    uint32_t animationCount;
+    glm::vec3 modelCenter;
+    glm::mat4 globalInverseTransform;
+};
+
+static_assert(std::is_trivially_copyable<BakedModelHeader>::value, "BakedModelHeader se escribe con memcpy");
+static_assert(std::is_trivially_copyable<PackedVectorKey>::value && std::is_trivially_copyable<PackedQuatKey>::value &&
+              std::is_trivially_copyable<CompressedTrack>::value, "Las claves se escriben con memcpy");
+static_assert(std::is_trivially_copyable<BakedPoseRange>::value, "Los rangos de poses se escriben con memcpy");
+
+// Archivo horneado que corresponde a un modelo
+inline std::string bakedModelPath(const std::string& sourcePath) {
+    return sourcePath + ".baked";
+}
+
+// --- Escritura ---
+
+class BakedModelWriter {
+public:
+    explicit BakedModelWriter(std::ofstream& out) : out(out) {}
+
+    template <typename T>
+    void value(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "Solo tipos triviales");
+        write(&v, sizeof(T));
+    }
+
+    template <typename T>
+    void array(const std::vector<T>& items) {
+        static_assert(std::is_trivially_copyable<T>::value, "Solo tipos triviales");
+        value<uint64_t>(items.size());
+        pad();
+        write(items.data(), items.size() * sizeof(T));
+        pad();
+    }
+
+    void text(const std::string& s) {
+        value<uint64_t>(s.size());
+        write(s.data(), s.size());
+        pad();
+    }
+
+private:
+    void write(const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), size);
+        offset += size;
+    }
+
+    void pad() {
+        static const char zeros[kBakedModelAlignment] = {};
+        size_t padding = (kBakedModelAlignment - offset % kBakedModelAlignment) % kBakedModelAlignment;
+        write(zeros, padding);
+    }
+
+    std::ofstream& out;
+    size_t offset = 0;
+};
+
+// Escribe el modelo en bakedPath. Se escribe a un temporal y se renombra al final,
+// para que el juego nunca vea un archivo a medias. Los clips se guardan comprimidos
+// (AnimationCompression.hpp); si clips es nullptr se comprimen aqui con la configuracion por defecto.
+// Lo mismo con las paletas horneadas: si poses es nullptr se muestrean aqui a partir de los clips comprimidos.
+inline bool writeBakedModel(const std::string& bakedPath, const std::string& sourcePath, const ModelData& model,
+                            const std::vector<CompressedAnimation>* clips = nullptr, const BakedPoses* poses = nullptr) {
+    BakedModelHeader header = {};
+    std::memcpy(header.magic, kBakedModelMagic, sizeof(header.magic));
+    header.version = kBakedModelVersion;
+    if (!bakedSourceStamp(sourcePath, header.sourceSize, header.sourceModifiedTime)) {
+        std::cerr << "Bake: source file not found: " << sourcePath << std::endl;
+        return false;
+    }
+    header.meshCount = static_cast<uint32_t>(model.meshes.size());
+    header.animationCount = static_cast<uint32_t>(clips ? clips->size() : model.animations.size());
+    header.modelCenter = model.modelCenter;
+    header.globalInverseTransform = model.globalInverseTransform;
+
+    std::string tempPath = bakedPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Bake: cannot write " << tempPath << std::endl;
+            return false;
+        }
+        BakedModelWriter writer(out);
+        writer.value(header);
+
+        for (const ModelMeshData& mesh : model.meshes) {
+            writer.text(mesh.textureFile);
+            writer.array(mesh.data.vertices);
+            writer.array(mesh.data.indices);
+            writer.array(mesh.data.boneWeightsData);
+            writer.array(mesh.data.boneIDsData);
+        }
+
+        const Skeleton& skeleton = model.skeleton;
+        writer.array(skeleton.parents);
+        writer.array(skeleton.bindLocal);
+        writer.array(skeleton.boneIds);
+        writer.array(skeleton.boneOffsets);
+        writer.value<uint64_t>(skeleton.names.size());
+        for (const std::string& name : skeleton.names) {
+            writer.text(name);
+        }
+
+        std::vector<CompressedAnimation> compressed;
+        if (!clips) {
+            for (const Animation& animation : model.animations) {
+                compressed.push_back(compressAnimation(animation));
+            }
+            clips = &compressed;
+        }
+        for (const CompressedAnimation& clip : *clips) {
+            writer.text(clip.name);
+            writer.value(clip.duration);
+            writer.value(clip.ticksPerSecond);
+            writer.value(clip.sourceKeyCount);
+            writer.array(clip.tracks);
+            writer.array(clip.positionKeys);
+            writer.array(clip.rotationKeys);
+            writer.array(clip.scaleKeys);
+        }
+
+        BakedPoses sampled;
+        if (!poses) {
+            sampled = bakePoses(skeleton, *clips);
+            poses = &sampled;
+        }
+        writer.value(poses->boneCount);
+        writer.value(poses->framesPerSecond);
+        writer.array(poses->clips);
+        writer.array(poses->texels);
+
+        if (!out) {
+            std::cerr << "Bake: error writing " << tempPath << std::endl;
+            return false;
+        }
+    }
+    std::remove(bakedPath.c_str());
+    if (std::rename(tempPath.c_str(), bakedPath.c_str()) != 0) {
+        std::cerr << "Bake: cannot rename " << tempPath << " to " << bakedPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --- Lectura ---
+
+// Un mesh horneado. Los punteros apuntan directamente al archivo mapeado,
+// asi que solo son validos mientras viva el BakedModel del que salen.
+struct BakedMeshView {
+    std::string textureFile;
+    const float* vertices = nullptr;
+    size_t vertexFloatCount = 0;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    const float* boneWeights = nullptr;
+    size_t boneWeightCount = 0;
+    const int* boneIDs = nullptr;
+    size_t boneIDCount = 0;
+};
+
+// El esqueleto y los clips comprimidos son pequeños y se copian a sus estructuras normales;
+// los buffers de vertices se quedan en el mapeo hasta que se suben a la GPU.
+struct BakedModel {
+    MappedFile file;
+    std::vector<BakedMeshView> meshes;
+    Skeleton skeleton;
+    std::vector<CompressedAnimation> animations;
+    BakedPoses poses;
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    glm::mat4 globalInverseTransform = glm::mat4(1.0f);
+};
+
+// Que un mesh leido del archivo se pueda usar sin salirse de sus arreglos: vertices de 8 floats,
+// indices dentro de los vertices y 4 pesos e IDs de hueso (-1 o menores que boneCount) por vertice
+inline bool bakedMeshConsistent(const BakedMeshView& mesh, size_t boneCount) {
+    if (mesh.vertexFloatCount % 8 != 0) {
+        return false;
+    }
+    const size_t vertexCount = mesh.vertexFloatCount / 8;
+    if (mesh.boneWeightCount != vertexCount * 4 || mesh.boneIDCount != vertexCount * 4) {
+        return false;
+    }
+    for (size_t i = 0; i < mesh.indexCount; ++i) {
+        if (mesh.indices[i] >= vertexCount) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < mesh.boneIDCount; ++i) {
+        if (mesh.boneIDs[i] < -1 || (mesh.boneIDs[i] >= 0 && static_cast<size_t>(mesh.boneIDs[i]) >= boneCount)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class BakedModelReader {
+public:
+    BakedModelReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+    bool ok() const { return valid; }
+
+    template <typename T>
+    T value() {
+        T v{};
+        if (take(sizeof(T))) {
+            std::memcpy(&v, data + offset - sizeof(T), sizeof(T));
+        }
+        return v;
+    }
+
+    // Devuelve un puntero dentro del archivo (sin copiar)
+    template <typename T>
+    const T* array(size_t& count) {
+        uint64_t n = value<uint64_t>();
+        pad();
+        count = 0;
+        if (!valid || n > (size - offset) / sizeof(T)) {
+            valid = false;
+            return nullptr;
+        }
+        const T* items = reinterpret_cast<const T*>(data + offset);
+        offset += n * sizeof(T);
+        pad();
+        count = static_cast<size_t>(n);
+        return items;
+    }
+
+    template <typename T>
+    void array(std::vector<T>& out) {
+        size_t count;
+        const T* items = array<T>(count);
+        out.assign(items, items + count);
+    }
+
+    std::string text() {
+        uint64_t n = value<uint64_t>();
+        std::string s;
+        if (valid && n <= size - offset) {
+            s.assign(reinterpret_cast<const char*>(data + offset), static_cast<size_t>(n));
+            offset += n;
+        } else {
+            valid = false;
+        }
+        pad();
+        return s;
+    }
+
+private:
+    bool take(size_t n) {
+        if (!valid || n > size - offset) {
+            valid = false;
+            return false;
+        }
+        offset += n;
+        return true;
+    }
+
+    void pad() {
+        take((kBakedModelAlignment - offset % kBakedModelAlignment) % kBakedModelAlignment);
+    }
+
+    const unsigned char* data;
+    size_t size;
+    size_t offset = 0;
+    bool valid = true;
+};
+
+// Carga bakedPath si existe, es de esta version y corresponde a sourcePath tal como esta ahora.
+// Si el original no existe se acepta el horneado igualmente (distribucion sin los .dae).
+inline bool loadBakedModel(const std::string& bakedPath, const std::string& sourcePath, BakedModel& out) {
+    if (!out.file.open(bakedPath)) {
+        return false;
+    }
+
+    BakedModelReader reader(out.file.data(), out.file.size());
+    BakedModelHeader header = reader.value<BakedModelHeader>();
+    if (!reader.ok() || std::memcmp(header.magic, kBakedModelMagic, sizeof(header.magic)) != 0 ||
+        header.version != kBakedModelVersion) {
+        std::cerr << "Baked model " << bakedPath << " has an unknown format, ignoring it." << std::endl;
+        out.file.close();
+        return false;
+    }
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if (bakedSourceStamp(sourcePath, sourceSize, sourceModifiedTime) &&
+        (sourceSize != header.sourceSize || sourceModifiedTime != header.sourceModifiedTime)) {
+        std::cout << "Baked model " << bakedPath << " is stale, loading " << sourcePath << " instead." << std::endl;
+        out.file.close();
+        return false;
+    }
+
+    out.meshes.resize(header.meshCount);
+    for (BakedMeshView& mesh : out.meshes) {
+        mesh.textureFile = reader.text();
+        mesh.vertices = reader.array<float>(mesh.vertexFloatCount);
+        mesh.indices = reader.array<unsigned int>(mesh.indexCount);
+        mesh.boneWeights = reader.array<float>(mesh.boneWeightCount);
+        mesh.boneIDs = reader.array<int>(mesh.boneIDCount);
+    }
+
+    Skeleton& skeleton = out.skeleton;
+    reader.array(skeleton.parents);
+    reader.array(skeleton.bindLocal);
+    reader.array(skeleton.boneIds);
+    reader.array(skeleton.boneOffsets);
+    uint64_t nameCount = reader.value<uint64_t>();
+    if (reader.ok() && nameCount == skeleton.parents.size()) {
+        skeleton.names.resize(static_cast<size_t>(nameCount));
+        for (std::string& name : skeleton.names) {
+            name = reader.text();
+        }
+    }
+
+    out.animations.resize(header.animationCount);
+    for (CompressedAnimation& clip : out.animations) {
+        clip.name = reader.text();
+        clip.duration = reader.value<float>();
+        clip.ticksPerSecond = reader.value<float>();
+        clip.sourceKeyCount = reader.value<uint32_t>();
+        reader.array(clip.tracks);
+        reader.array(clip.positionKeys);
+        reader.array(clip.rotationKeys);
+        reader.array(clip.scaleKeys);
+    }
+
+    out.poses.boneCount = reader.value<uint32_t>();
+    out.poses.framesPerSecond = reader.value<float>();
+    reader.array(out.poses.clips);
+    reader.array(out.poses.texels);
+
+    bool consistent = reader.ok() && skeleton.names.size() == skeleton.parents.size() && skeletonConsistent(skeleton) &&
+                      bakedPosesConsistent(out.poses, skeleton.boneCount(), out.animations.size());
+    for (const BakedMeshView& mesh : out.meshes) {
+        consistent = consistent && bakedMeshConsistent(mesh, skeleton.boneCount());
+    }
+    for (const CompressedAnimation& clip : out.animations) {
+        consistent = consistent && compressedAnimationConsistent(clip);
+    }
+    if (!consistent) {
+        std::cerr << "Baked model " << bakedPath << " is truncated or corrupt, ignoring it." << std::endl;
+        out.meshes.clear();
+        out.skeleton = Skeleton();
+        out.animations.clear();
+        out.poses = BakedPoses();
+        out.file.close();
+        return false;
+    }
+
+    out.modelCenter = header.modelCenter;
+    out.globalInverseTransform = header.globalInverseTransform;
+    return true;
+}
@@ -0,0 +1,237 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Jerarquia de cajas (BVH) de los objetos de la escena, para descartar los que quedan fuera
+// del frustum antes de emitir ningun draw (sin OpenGL).
+//
+// Se construye de arriba abajo partiendo por la mediana del eje mas largo. Los objetos que se
+// mueven no reconstruyen el arbol: guardan una caja con margen y, si se salen de ella, solo se
+// reajustan los nodos de su hoja hasta la raiz. El arbol completo se reconstruye cuando hay
+// objetos nuevos o cuando los reajustes lo han degradado demasiado.
+#pragma once
+
+#include "Frustum.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class Bvh {
+public:
+    static constexpr uint32_t kInvalid = 0xffffffffu;
+    static constexpr uint32_t kLeafSize = 4;
+
+    // Reconstruir cuando el area de todos los nodos supere esta proporcion de la de la ultima construccion
+    float rebuildRatio = 1.5f;
+
+    // Registra un objeto y devuelve su proxy (indice estable). userData es lo que devuelve cull().
+    // margin > 0 para objetos que se mueven: su caja en el arbol se agranda en margin por cada lado.
+    uint32_t add(const Aabb& box, uint32_t userData, float margin = 0.0f) {
+        Proxy proxy;
+        proxy.box = box;
+        proxy.fatBox = fatten(box, margin);
+        proxy.userData = userData;
+        proxy.margin = margin;
+        proxies.push_back(proxy);
+        dirty = true;
+        return static_cast<uint32_t>(proxies.size() - 1);
+    }
+
+    // Nueva caja de un objeto. Mientras quepa en su caja con margen el arbol no se toca.
+    void update(uint32_t proxyId, const Aabb& box) {
+        Proxy& proxy = proxies[proxyId];
+        proxy.box = box;
+        if (proxy.fatBox.contains(box)) {
+            return;
+        }
+        proxy.fatBox = fatten(box, proxy.margin);
+        if (proxy.leaf != kInvalid) {
+            refit(proxy.leaf);
+        }
+    }
+
+    // Llamar una vez por frame antes de cull()
+    void refresh() {
+        if (dirty || (builtArea > 0.0f && totalArea > builtArea * rebuildRatio)) {
+            build();
+        }
+    }
+
+    void build() {
+        nodes.clear();
+        order.resize(proxies.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        if (!proxies.empty()) {
+            nodes.reserve(2 * (proxies.size() / kLeafSize + 1));
+            buildNode(0, static_cast<uint32_t>(proxies.size()), kInvalid);
+        }
+        totalArea = 0.0f;
+        for (const Node& node : nodes) {
+            totalArea += node.box.surfaceArea();
+        }
+        builtArea = totalArea;
+        dirty = false;
+        ++rebuilds;
+    }
+
+    // Agrega a visible el userData de cada objeto cuya caja toca el frustum (no borra visible)
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+        nodesTested = 0;
+        if (nodes.empty()) {
+            return;
+        }
+        // Profundidad maxima ~log2(n / kLeafSize): 64 niveles sobran
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            ++nodesTested;
+            FrustumTest test = frustum.classify(node.box);
+            if (test == FrustumTest::Outside) {
+                continue;
+            }
+            if (test == FrustumTest::Inside) {
+                // Todo el subarbol es visible: sus objetos son un rango contiguo de order
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    visible.push_back(proxies[order[i]].userData);
+                }
+                continue;
+            }
+            if (node.left == kInvalid) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    const Proxy& proxy = proxies[order[i]];
+                    if (frustum.intersects(proxy.box)) {
+                        visible.push_back(proxy.userData);
+                    }
+                }
+                continue;
+            }
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+
+    size_t size() const { return proxies.size(); }
+    size_t nodeCount() const { return nodes.size(); }
+    const Aabb& bounds(uint32_t proxyId) const { return proxies[proxyId].box; }
+
+    // Estadisticas
+    size_t lastNodesTested() const { return nodesTested; }
+    size_t refitCount() const { return refits; }
+    size_t rebuildCount() const { return rebuilds; }
+
+private:
+    struct Proxy {
+        Aabb box;     // Caja real, la que se prueba contra el frustum
+        Aabb fatBox;  // Caja con margen, la que usan los nodos
+        uint32_t userData = 0;
+        float margin = 0.0f;
+        uint32_t leaf = kInvalid;
+    };
+
+    // Cada nodo cubre los objetos order[first, first + count). Las hojas tienen left == kInvalid.
+    struct Node {
+        Aabb box;
+        uint32_t parent = kInvalid;
+        uint32_t left = kInvalid;
+        uint32_t right = kInvalid;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    std::vector<Proxy> proxies;
+    std::vector<uint32_t> order;
+    std::vector<Node> nodes;
+    bool dirty = false;
+    float builtArea = 0.0f;
+    float totalArea = 0.0f;
+    size_t refits = 0;
+    size_t rebuilds = 0;
+    mutable size_t nodesTested = 0;
+
+    static Aabb fatten(const Aabb& box, float margin) {
+        Aabb fat = box;
+        if (margin > 0.0f && !box.empty()) {
+            fat.min -= glm::vec3(margin);
+            fat.max += glm::vec3(margin);
+        }
+        return fat;
+    }
+
+    uint32_t buildNode(uint32_t first, uint32_t count, uint32_t parent) {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+        Aabb box, centroids;
+        for (uint32_t i = first; i < first + count; ++i) {
+            const Proxy& proxy = proxies[order[i]];
+            box.expand(proxy.fatBox);
+            if (!proxy.fatBox.empty()) {
+                centroids.expand(proxy.fatBox.center());
+            }
+        }
+        nodes[index].box = box;
+        nodes[index].parent = parent;
+        nodes[index].first = first;
+        nodes[index].count = count;
+
+        if (count <= kLeafSize || centroids.empty()) {
+            for (uint32_t i = first; i < first + count; ++i) {
+                proxies[order[i]].leaf = index;
+            }
+            return index;
+        }
+
+        // Mediana por el centro de las cajas en el eje en que mas se reparten
+        glm::vec3 extent = centroids.max - centroids.min;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        uint32_t half = count / 2;
+        std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                         [&](uint32_t a, uint32_t b) {
+                             return proxies[a].fatBox.center()[axis] < proxies[b].fatBox.center()[axis];
+                         });
+        // nodes puede crecer dentro de las llamadas: se escribe por indice despues de cada una
+        uint32_t left = buildNode(first, half, index);
+        nodes[index].left = left;
+        uint32_t right = buildNode(first + half, count - half, index);
+        nodes[index].right = right;
+        return index;
+    }
+
+    // Recalcula la caja de la hoja y de sus antecesores
+    void refit(uint32_t nodeIndex) {
+        ++refits;
+        Node& leaf = nodes[nodeIndex];
+        Aabb box;
+        for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) {
+            box.expand(proxies[order[i]].fatBox);
+        }
+        setNodeBox(nodeIndex, box);
+        for (uint32_t i = leaf.parent; i != kInvalid; i = nodes[i].parent) {
+            Aabb merged = nodes[nodes[i].left].box;
+            merged.expand(nodes[nodes[i].right].box);
+            setNodeBox(i, merged);
+        }
+    }
+
+    void setNodeBox(uint32_t nodeIndex, const Aabb& box) {
+        totalArea += box.surfaceArea() - nodes[nodeIndex].box.surfaceArea();
+        nodes[nodeIndex].box = box;
+    }
+};
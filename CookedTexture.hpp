@@ -0,0 +1,473 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Texturas "cocinadas" (ver cooktex.cpp): la cadena completa de mipmaps ya generada y, salvo que
+// se pida RGBA8, comprimida en BC1 (sin alfa) o BC3 (con alfa) con un codificador en CPU.
+// En tiempo de ejecucion se mapea el archivo y cada nivel se sube tal cual (TextureManager.hpp),
+// sin decodificar el PNG ni llamar a glGenerateMipmap. Sin OpenGL.
+//
+// Estructura (little-endian):
+//   CookedTextureHeader
+//   CookedTextureLevel x levelCount   (nivel 0 = resolucion completa)
+//   datos de cada nivel, alineados a 16 bytes; los bloques BC van por filas de bloques de 4x4
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "stb_image.h"
+
+constexpr uint32_t kCookedTextureVersion = 1;
+constexpr char kCookedTextureMagic[4] = {'P', 'T', 'T', 'X'};
+constexpr size_t kCookedTextureAlignment = 16;
+
+enum class CookedTextureFormat : uint32_t { RGBA8 = 0, BC1 = 1, BC3 = 2 };
+
+struct CookedTextureHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;        // Marca del PNG original (ver bakedSourceStamp)
+    int64_t sourceModifiedTime;
+    uint32_t width, height;
+    CookedTextureFormat format;
+    uint32_t levelCount;
+};
+
+struct CookedTextureLevel {
+    uint32_t width, height;
+    uint64_t offset;  // Desde el principio del archivo
+    uint64_t size;
+};
+
+static_assert(std::is_trivially_copyable<CookedTextureHeader>::value, "CookedTextureHeader se escribe con memcpy");
+
+// Archivo cocinado que corresponde a una imagen
+inline std::string cookedTexturePath(const std::string& sourcePath) {
+    return sourcePath + ".ctex";
+}
+
+inline const char* cookedTextureFormatName(CookedTextureFormat format) {
+    switch (format) {
+        case CookedTextureFormat::BC1: return "BC1";
+        case CookedTextureFormat::BC3: return "BC3";
+        default: return "RGBA8";
+    }
+}
+
+inline size_t cookedLevelSize(CookedTextureFormat format, uint32_t width, uint32_t height) {
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case CookedTextureFormat::BC1: return blocks * 8;
+        case CookedTextureFormat::BC3: return blocks * 16;
+        default: return static_cast<size_t>(width) * height * 4;
+    }
+}
+
+// --- Mipmaps ---
+
+// Siguiente nivel con un filtro de caja de 2x2 (las dimensiones impares repiten el ultimo texel)
+inline void downsampleRgba8(const std::vector<uint8_t>& src, uint32_t width, uint32_t height,
+                            std::vector<uint8_t>& dst, uint32_t& outWidth, uint32_t& outHeight) {
+    outWidth = std::max(1u, width / 2);
+    outHeight = std::max(1u, height / 2);
+    dst.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+    for (uint32_t y = 0; y < outHeight; ++y) {
+        uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+        for (uint32_t x = 0; x < outWidth; ++x) {
+            uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; ++c) {
+                int sum = src[(static_cast<size_t>(y0) * width + x0) * 4 + c] + src[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                          src[(static_cast<size_t>(y1) * width + x0) * 4 + c] + src[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                dst[(static_cast<size_t>(y) * outWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// --- Codificador BC1/BC3 ---
+// Por bloque: eje principal de los colores (iteracion de potencias sobre la covarianza), extremos
+// = proyecciones minima y maxima recortadas 1/16 hacia dentro, y cada texel al color mas cercano
+// de la paleta. La calidad es la de un codificador rapido "range fit", suficiente para albedo.
+
+inline uint16_t packRgb565(const float rgb[3]) {
+    int r = std::min(31, std::max(0, static_cast<int>(rgb[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::min(63, std::max(0, static_cast<int>(rgb[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::min(31, std::max(0, static_cast<int>(rgb[2] * 31.0f / 255.0f + 0.5f)));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRgb565(uint16_t c, int rgb[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Paleta de 4 colores de BC1 (modo sin alfa, c0 > c1)
+inline void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int k = 0; k < 3; ++k) {
+        palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+        palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    }
+}
+
+// block: 16 texels RGBA8 por filas. out: 8 bytes.
+inline void encodeBc1Block(const uint8_t* block, uint8_t* out) {
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 3; ++k) mean[k] += block[i * 4 + k];
+    }
+    for (int k = 0; k < 3; ++k) mean[k] /= 16.0f;
+
+    float cov[6] = {}; // xx xy xz yy yz zz
+    for (int i = 0; i < 16; ++i) {
+        float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = {0.577f, 0.577f, 0.577f};
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                         cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                         cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f) break; // Bloque de un solo color
+        for (int k = 0; k < 3; ++k) axis[k] = next[k] / length;
+    }
+
+    float minProj = 1e9f, maxProj = -1e9f;
+    for (int i = 0; i < 16; ++i) {
+        float p = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] + (block[i * 4 + 2] - mean[2]) * axis[2];
+        minProj = std::min(minProj, p);
+        maxProj = std::max(maxProj, p);
+    }
+    float inset = (maxProj - minProj) / 16.0f;
+    minProj += inset;
+    maxProj -= inset;
+    float hi[3], lo[3];
+    for (int k = 0; k < 3; ++k) {
+        hi[k] = mean[k] + axis[k] * maxProj;
+        lo[k] = mean[k] + axis[k] * minProj;
+    }
+    uint16_t c0 = packRgb565(hi), c1 = packRgb565(lo);
+    if (c0 < c1) std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        bc1Palette(c0, c1, palette);
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int dr = block[i * 4] - palette[p][0], dg = block[i * 4 + 1] - palette[p][1], db = block[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+    for (int b = 0; b < 4; ++b) out[4 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+// Bloque de alfa de BC3 (modo de 8 valores, a0 > a1). out: 8 bytes.
+inline void encodeBc3AlphaBlock(const uint8_t* block, uint8_t* out) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, static_cast<int>(block[i * 4 + 3]));
+        a1 = std::min(a1, static_cast<int>(block[i * 4 + 3]));
+    }
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        int palette[8] = {a0, a1};
+        for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = 256;
+            for (int p = 0; p < 8; ++p) {
+                int error = std::abs(block[i * 4 + 3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    out[0] = static_cast<uint8_t>(a0);
+    out[1] = static_cast<uint8_t>(a1);
+    for (int b = 0; b < 6; ++b) out[2 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+// Decodificadores, para cuando el driver no soporta S3TC: el nivel se sube como RGBA8
+inline void decodeBc1Block(const uint8_t* in, uint8_t* rgba, bool forceFourColors) {
+    uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    bool threeColors = c0 <= c1 && !forceFourColors;
+    if (threeColors) {
+        for (int k = 0; k < 3; ++k) {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+    }
+    uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        int p = (indices >> (2 * i)) & 3;
+        for (int k = 0; k < 3; ++k) rgba[i * 4 + k] = static_cast<uint8_t>(palette[p][k]);
+        rgba[i * 4 + 3] = (threeColors && p == 3) ? 0 : 255;
+    }
+}
+
+inline void decodeBc3AlphaBlock(const uint8_t* in, uint8_t* rgba) {
+    int a0 = in[0], a1 = in[1];
+    int palette[8] = {a0, a1};
+    if (a0 > a1) {
+        for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7;
+    } else {
+        for (int p = 2; p < 6; ++p) palette[p] = ((6 - p) * a0 + (p - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; ++b) indices |= static_cast<uint64_t>(in[2 + b]) << (8 * b);
+    for (int i = 0; i < 16; ++i) {
+        rgba[i * 4 + 3] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+// Codifica o decodifica un nivel completo, bloque a bloque. Los bordes que no llenan un bloque
+// repiten el ultimo texel al codificar y se descartan al decodificar.
+inline void encodeBcLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, CookedTextureFormat format,
+                          std::vector<uint8_t>& out) {
+    const size_t blockBytes = format == CookedTextureFormat::BC3 ? 16 : 8;
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    out.resize(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            for (int i = 0; i < 16; ++i) {
+                uint32_t x = std::min(bx * 4 + i % 4, width - 1), y = std::min(by * 4 + i / 4, height - 1);
+                std::memcpy(block + i * 4, &rgba[(static_cast<size_t>(y) * width + x) * 4], 4);
+            }
+            uint8_t* dst = &out[(static_cast<size_t>(by) * blocksX + bx) * blockBytes];
+            if (format == CookedTextureFormat::BC3) {
+                encodeBc3AlphaBlock(block, dst);
+                dst += 8;
+            }
+            encodeBc1Block(block, dst);
+        }
+    }
+}
+
+inline void decodeBcLevel(const uint8_t* data, uint32_t width, uint32_t height, CookedTextureFormat format,
+                          std::vector<uint8_t>& rgba) {
+    const size_t blockBytes = format == CookedTextureFormat::BC3 ? 16 : 8;
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            const uint8_t* src = data + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+            if (format == CookedTextureFormat::BC3) {
+                decodeBc1Block(src + 8, block, true);
+                decodeBc3AlphaBlock(src, block);
+            } else {
+                decodeBc1Block(src, block, false);
+            }
+            for (int i = 0; i < 16; ++i) {
+                uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < width && y < height) {
+                    std::memcpy(&rgba[(static_cast<size_t>(y) * width + x) * 4], block + i * 4, 4);
+                }
+            }
+        }
+    }
+}
+
+// --- Cocinado ---
+
+struct CookTextureResult {
+    CookedTextureFormat format = CookedTextureFormat::RGBA8;
+    uint32_t width = 0, height = 0, levelCount = 0;
+    size_t cookedBytes = 0;    // Todos los niveles, como quedan en la GPU
+    size_t uncompressedBytes = 0; // Lo mismo en RGBA8 (lo que ocupaba antes con glGenerateMipmap)
+};
+
+// Lee sourcePath, genera los mipmaps y escribe cookedPath (a un temporal que se renombra al final).
+// BC3 si algun texel tiene alfa < 255, BC1 si no; RGBA8 sin comprimir si forceRgba8.
+inline bool cookTexture(const std::string& sourcePath, const std::string& cookedPath, bool forceRgba8, CookTextureResult& result) {
+    CookedTextureHeader header = {};
+    std::memcpy(header.magic, kCookedTextureMagic, sizeof(header.magic));
+    header.version = kCookedTextureVersion;
+    if (!bakedSourceStamp(sourcePath, header.sourceSize, header.sourceModifiedTime)) {
+        std::cerr << "Cook: source file not found: " << sourcePath << std::endl;
+        return false;
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cerr << "Cook: cannot decode " << sourcePath << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < level.size() && !hasAlpha; i += 4) {
+        hasAlpha = level[i] != 255;
+    }
+    header.format = forceRgba8 ? CookedTextureFormat::RGBA8 : (hasAlpha ? CookedTextureFormat::BC3 : CookedTextureFormat::BC1);
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+
+    // Todos los niveles hasta 1x1, ya en el formato final
+    std::vector<CookedTextureLevel> levels;
+    std::vector<std::vector<uint8_t>> levelData;
+    uint32_t levelWidth = header.width, levelHeight = header.height;
+    std::vector<uint8_t> next;
+    result.uncompressedBytes = 0;
+    while (true) {
+        CookedTextureLevel info = {levelWidth, levelHeight, 0, 0};
+        levelData.emplace_back();
+        if (header.format == CookedTextureFormat::RGBA8) {
+            levelData.back() = level;
+        } else {
+            encodeBcLevel(level, levelWidth, levelHeight, header.format, levelData.back());
+        }
+        info.size = levelData.back().size();
+        levels.push_back(info);
+        result.uncompressedBytes += level.size();
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        downsampleRgba8(level, levelWidth, levelHeight, next, levelWidth, levelHeight);
+        level.swap(next);
+    }
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    auto align = [](uint64_t offset) { return (offset + kCookedTextureAlignment - 1) / kCookedTextureAlignment * kCookedTextureAlignment; };
+    uint64_t offset = align(sizeof(CookedTextureHeader) + levels.size() * sizeof(CookedTextureLevel));
+    for (CookedTextureLevel& info : levels) {
+        info.offset = offset;
+        offset = align(offset + info.size);
+    }
+
+    std::string tempPath = cookedPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Cook: cannot write " << tempPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(CookedTextureLevel));
+        static const char zeros[kCookedTextureAlignment] = {};
+        for (size_t i = 0; i < levels.size(); ++i) {
+            out.write(zeros, levels[i].offset - static_cast<uint64_t>(out.tellp()));
+            out.write(reinterpret_cast<const char*>(levelData[i].data()), levelData[i].size());
+        }
+        if (!out) {
+            std::cerr << "Cook: error writing " << tempPath << std::endl;
+            return false;
+        }
+    }
+    std::remove(cookedPath.c_str());
+    if (std::rename(tempPath.c_str(), cookedPath.c_str()) != 0) {
+        std::cerr << "Cook: cannot rename " << tempPath << " to " << cookedPath << std::endl;
+        return false;
+    }
+
+    result.format = header.format;
+    result.width = header.width;
+    result.height = header.height;
+    result.levelCount = header.levelCount;
+    result.cookedBytes = 0;
+    for (const CookedTextureLevel& info : levels) {
+        result.cookedBytes += info.size;
+    }
+    return true;
+}
+
+// --- Lectura ---
+
+// Los datos de cada nivel apuntan al archivo mapeado: solo validos mientras viva el CookedTexture
+struct CookedTexture {
+    MappedFile file;
+    CookedTextureHeader header = {};
+    std::vector<CookedTextureLevel> levels;
+
+    const uint8_t* levelData(size_t level) const { return file.data() + levels[level].offset; }
+};
+
+// Carga cookedPath si existe, es de esta version y corresponde a sourcePath tal como esta ahora.
+// Si el original no existe se acepta igualmente (distribucion solo con los .ctex).
+inline bool loadCookedTexture(const std::string& cookedPath, const std::string& sourcePath, CookedTexture& out) {
+    if (!out.file.open(cookedPath)) {
+        return false;
+    }
+    const size_t size = out.file.size();
+    if (size < sizeof(CookedTextureHeader)) {
+        out.file.close();
+        return false;
+    }
+    std::memcpy(&out.header, out.file.data(), sizeof(CookedTextureHeader));
+    const CookedTextureHeader& header = out.header;
+    if (std::memcmp(header.magic, kCookedTextureMagic, sizeof(header.magic)) != 0 || header.version != kCookedTextureVersion ||
+        header.format > CookedTextureFormat::BC3 || header.levelCount == 0 || header.levelCount > 32 ||
+        size < sizeof(CookedTextureHeader) + header.levelCount * sizeof(CookedTextureLevel)) {
+        std::cerr << "Cooked texture " << cookedPath << " has an unknown format, ignoring it." << std::endl;
+        out.file.close();
+        return false;
+    }
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if (bakedSourceStamp(sourcePath, sourceSize, sourceModifiedTime) &&
+        (sourceSize != header.sourceSize || sourceModifiedTime != header.sourceModifiedTime)) {
+        std::cout << "Cooked texture " << cookedPath << " is stale, loading " << sourcePath << " instead." << std::endl;
+        out.file.close();
+        return false;
+    }
+
+    out.levels.resize(header.levelCount);
+    std::memcpy(out.levels.data(), out.file.data() + sizeof(CookedTextureHeader), header.levelCount * sizeof(CookedTextureLevel));
+    for (const CookedTextureLevel& level : out.levels) {
+        if (level.offset > size || level.size > size - level.offset ||
+            level.size != cookedLevelSize(header.format, level.width, level.height)) {
+            std::cerr << "Cooked texture " << cookedPath << " is truncated, ignoring it." << std::endl;
+            out.file.close();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,204 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Skinning lineal en CPU, sin OpenGL: hace lo mismo que el vertex shader de skinning sobre los
+// buffers de buildMeshData (8 floats por vertice, 4 IDs y 4 pesos). Sirve para colisiones, picking
+// o servidores sin GPU, y como camino de dibujo alternativo cuando la GPU es el cuello de botella
+// (AnimatedModel sube el resultado a un VBO dinamico).
+//
+// Con AVX2 se procesan 8 vertices a la vez: las posiciones, normales, IDs, pesos y las filas de
+// las matrices de hueso se leen con gather. Sin AVX2 (o para el resto de < 8 vertices) se usa la
+// version escalar.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "AnimationWorkers.hpp"
+
+// Salida: posicion (3) y normal (3) por vertice, en espacio del modelo. La normal no se normaliza
+// (igual que en el shader, donde se normaliza en el fragment shader).
+constexpr size_t kCpuSkinnedVertexFloats = 6;
+
+// Mesh de entrada. vertices tiene stride floats por vertice con la posicion y la normal al principio.
+struct SkinningSource {
+    const float* vertices = nullptr;
+    size_t stride = 8;
+    const int* boneIDs = nullptr;      // 4 por vertice (-1 = sin hueso)
+    const float* boneWeights = nullptr; // 4 por vertice
+    size_t vertexCount = 0;
+};
+
+// Vertices [begin, end) de source, escritos en out + begin * kCpuSkinnedVertexFloats
+inline void skinVerticesScalar(const glm::mat4* palette, size_t boneCount, const SkinningSource& source,
+                               size_t begin, size_t end, float* out) {
+    for (size_t v = begin; v < end; ++v) {
+        const float* in = source.vertices + v * source.stride;
+        const int* ids = source.boneIDs + v * 4;
+        const float* weights = source.boneWeights + v * 4;
+
+        // Mismo umbral que el shader: sin pesos el vertice no se mueve
+        glm::mat4 skin(1.0f);
+        float weightDot = weights[0] * weights[0] + weights[1] * weights[1] + weights[2] * weights[2] + weights[3] * weights[3];
+        if (weightDot > 0.0001f) {
+            skin = glm::mat4(0.0f);
+            for (int k = 0; k < 4; ++k) {
+                if (ids[k] >= 0 && static_cast<size_t>(ids[k]) < boneCount) {
+                    skin += palette[ids[k]] * weights[k];
+                }
+            }
+        }
+        glm::vec4 position = skin * glm::vec4(in[0], in[1], in[2], 1.0f);
+        glm::vec4 normal = skin * glm::vec4(in[3], in[4], in[5], 0.0f);
+        float* o = out + v * kCpuSkinnedVertexFloats;
+        o[0] = position.x; o[1] = position.y; o[2] = position.z;
+        o[3] = normal.x; o[4] = normal.y; o[5] = normal.z;
+    }
+}
+
+#if defined(__AVX2__)
+// a * b + c (FMA solo si el compilador lo tiene activado: -mavx2 no lo incluye, -march=native si)
+inline __m256 skinMultiplyAdd(__m256 a, __m256 b, __m256 c) {
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+// (end - begin) debe ser multiplo de 8
+inline void skinVerticesAvx2(const glm::mat4* palette, size_t boneCount, const SkinningSource& source,
+                             size_t begin, size_t end, float* out) {
+    const float* paletteFloats = glm::value_ptr(palette[0]);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i stride = _mm256_set1_epi32(static_cast<int>(source.stride));
+    const __m256i maxBone = _mm256_set1_epi32(static_cast<int>(boneCount) - 1);
+    const __m256i zeroi = _mm256_setzero_si256();
+    const __m256 zero = _mm256_setzero_ps();
+    alignas(32) float result[kCpuSkinnedVertexFloats][8];
+
+    for (size_t v = begin; v < end; v += 8) {
+        // Los indices se cuentan desde el primer vertice del grupo para no desbordar int32
+        const float* in = source.vertices + v * source.stride;
+        const int* idsBase = source.boneIDs + v * 4;
+        const float* weightsBase = source.boneWeights + v * 4;
+        __m256i vertexIndex = _mm256_mullo_epi32(lane, stride);
+        __m256 px = _mm256_i32gather_ps(in, vertexIndex, 4);
+        __m256 py = _mm256_i32gather_ps(in + 1, vertexIndex, 4);
+        __m256 pz = _mm256_i32gather_ps(in + 2, vertexIndex, 4);
+        __m256 nx = _mm256_i32gather_ps(in + 3, vertexIndex, 4);
+        __m256 ny = _mm256_i32gather_ps(in + 4, vertexIndex, 4);
+        __m256 nz = _mm256_i32gather_ps(in + 5, vertexIndex, 4);
+
+        // Matriz mezclada: m[c][r] para las columnas 0-3 y las filas 0-2 (la fila 3 no hace falta)
+        __m256 m[4][3];
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                m[c][r] = zero;
+            }
+        }
+        __m256 weightDot = zero;
+        const __m256i influenceIndex = _mm256_slli_epi32(lane, 2);
+        for (int k = 0; k < 4; ++k) {
+            __m256i ids = _mm256_i32gather_epi32(idsBase + k, influenceIndex, 4);
+            __m256 weights = _mm256_i32gather_ps(weightsBase + k, influenceIndex, 4);
+            weightDot = skinMultiplyAdd(weights, weights, weightDot);
+            // IDs fuera de la paleta (-1) no aportan nada; se fijan a 0 para que el gather sea valido
+            __m256i valid = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zeroi, ids), _mm256_cmpgt_epi32(ids, maxBone)),
+                                                _mm256_set1_epi32(-1));
+            weights = _mm256_and_ps(weights, _mm256_castsi256_ps(valid));
+            __m256i base = _mm256_slli_epi32(_mm256_and_si256(ids, valid), 4); // 16 floats por matriz
+            for (int c = 0; c < 4; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    __m256 element = _mm256_i32gather_ps(paletteFloats + c * 4 + r, base, 4);
+                    m[c][r] = skinMultiplyAdd(element, weights, m[c][r]);
+                }
+            }
+        }
+
+        // Vertices sin pesos: identidad
+        __m256 unskinned = _mm256_cmp_ps(weightDot, _mm256_set1_ps(0.0001f), _CMP_LE_OQ);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                m[c][r] = _mm256_blendv_ps(m[c][r], c == r ? one : zero, unskinned);
+            }
+        }
+
+        for (int r = 0; r < 3; ++r) {
+            __m256 p = skinMultiplyAdd(m[0][r], px, skinMultiplyAdd(m[1][r], py, skinMultiplyAdd(m[2][r], pz, m[3][r])));
+            __m256 n = skinMultiplyAdd(m[0][r], nx, skinMultiplyAdd(m[1][r], ny, _mm256_mul_ps(m[2][r], nz)));
+            _mm256_store_ps(result[r], p);
+            _mm256_store_ps(result[3 + r], n);
+        }
+        float* o = out + v * kCpuSkinnedVertexFloats;
+        for (int i = 0; i < 8; ++i, o += kCpuSkinnedVertexFloats) {
+            for (size_t f = 0; f < kCpuSkinnedVertexFloats; ++f) {
+                o[f] = result[f][i];
+            }
+        }
+    }
+}
+#endif
+
+// Version mas rapida disponible para [begin, end)
+inline void skinVertices(const glm::mat4* palette, size_t boneCount, const SkinningSource& source,
+                         size_t begin, size_t end, float* out) {
+    if (boneCount == 0) {
+        return;
+    }
+#if defined(__AVX2__)
+    size_t vectorEnd = begin + (end - begin) / 8 * 8;
+    skinVerticesAvx2(palette, boneCount, source, begin, vectorEnd, out);
+    begin = vectorEnd;
+#endif
+    skinVerticesScalar(palette, boneCount, source, begin, end, out);
+}
+
+// Un mesh de un personaje: su paleta, sus vertices de entrada y donde escribir el resultado
+// (source.vertexCount * kCpuSkinnedVertexFloats floats)
+struct SkinningJob {
+    const glm::mat4* palette = nullptr;
+    size_t boneCount = 0;
+    SkinningSource source;
+    float* out = nullptr;
+};
+
+// Reparte todos los meshes de todos los personajes entre los hilos, en bloques de chunkVertices
+// vertices (los meshes grandes se parten, los pequeños no dejan hilos sin trabajo).
+inline void skinMeshes(AnimationWorkerPool& pool, const std::vector<SkinningJob>& jobs, size_t chunkVertices = 2048) {
+    std::vector<size_t> firstChunk(jobs.size() + 1, 0);
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        firstChunk[j + 1] = firstChunk[j] + (jobs[j].source.vertexCount + chunkVertices - 1) / chunkVertices;
+    }
+    pool.parallelFor(firstChunk.back(), 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            size_t j = std::upper_bound(firstChunk.begin(), firstChunk.end(), chunk) - firstChunk.begin() - 1;
+            const SkinningJob& job = jobs[j];
+            size_t vertexBegin = (chunk - firstChunk[j]) * chunkVertices;
+            size_t vertexEnd = std::min(vertexBegin + chunkVertices, job.source.vertexCount);
+            skinVertices(job.palette, job.boneCount, job.source, vertexBegin, vertexEnd, job.out);
+        }
+    });
+}
@@ -0,0 +1,153 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cajas alineadas a los ejes y frustum de la camara, para descartar lo que no se ve (sin OpenGL).
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    bool empty() const { return min.x > max.x; }
+
+    void expand(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void expand(const Aabb& other) {
+        if (!other.empty()) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+    }
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    bool contains(const Aabb& other) const {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+    }
+
+    // Area de la superficie, para medir la calidad de una jerarquia de cajas
+    float surfaceArea() const {
+        if (empty()) {
+            return 0.0f;
+        }
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    // Distancia de p a la caja (0 si p esta dentro)
+    float distance(const glm::vec3& p) const {
+        glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+        return glm::length(d);
+    }
+};
+
+// Caja que contiene a box transformada por m (Arvo): conservadora, no hace falta transformar las 8 esquinas
+inline Aabb transformAabb(const glm::mat4& m, const Aabb& box) {
+    if (box.empty()) {
+        return box;
+    }
+    Aabb result;
+    result.min = result.max = glm::vec3(m[3]);
+    for (int column = 0; column < 3; ++column) {
+        glm::vec3 a = glm::vec3(m[column]) * box.min[column];
+        glm::vec3 b = glm::vec3(m[column]) * box.max[column];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+enum class FrustumTest { Outside, Intersects, Inside };
+
+// Los 6 planos de la piramide de vision, extraidos de projection * view (Gribb/Hartmann).
+// Las normales apuntan hacia dentro: un punto es visible si dot(n, p) + d >= 0 en los 6.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection) {
+        // glm guarda por columnas: la fila i es (m[0][i], m[1][i], m[2][i], m[3][i])
+        auto row = [&](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+        Frustum f;
+        f.planes[0] = r3 + r0; // Izquierda
+        f.planes[1] = r3 - r0; // Derecha
+        f.planes[2] = r3 + r1; // Abajo
+        f.planes[3] = r3 - r1; // Arriba
+        f.planes[4] = r3 + r2; // Cerca
+        f.planes[5] = r3 - r2; // Lejos
+        for (glm::vec4& p : f.planes) {
+            float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            p = p * (1.0f / length);
+        }
+        return f;
+    }
+
+    // false solo si la caja queda entera fuera de algun plano (conservador)
+    bool intersects(const Aabb& box) const {
+        for (const glm::vec4& p : planes) {
+            // Esquina de la caja mas adentro segun la normal del plano
+            glm::vec3 positive(p.x >= 0.0f ? box.max.x : box.min.x,
+                               p.y >= 0.0f ? box.max.y : box.min.y,
+                               p.z >= 0.0f ? box.max.z : box.min.z);
+            if (p.x * positive.x + p.y * positive.y + p.z * positive.z + p.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Como intersects, pero distingue las cajas enteras dentro: sus hijos ya no hace falta probarlos
+    FrustumTest classify(const Aabb& box) const {
+        FrustumTest result = FrustumTest::Inside;
+        for (const glm::vec4& p : planes) {
+            glm::vec3 positive(p.x >= 0.0f ? box.max.x : box.min.x,
+                               p.y >= 0.0f ? box.max.y : box.min.y,
+                               p.z >= 0.0f ? box.max.z : box.min.z);
+            if (p.x * positive.x + p.y * positive.y + p.z * positive.z + p.w < 0.0f) {
+                return FrustumTest::Outside;
+            }
+            // Esquina mas afuera: si tambien esta dentro, la caja no cruza este plano
+            glm::vec3 negative(p.x >= 0.0f ? box.min.x : box.max.x,
+                               p.y >= 0.0f ? box.min.y : box.max.y,
+                               p.z >= 0.0f ? box.min.z : box.max.z);
+            if (p.x * negative.x + p.y * negative.y + p.z * negative.z + p.w < 0.0f) {
+                result = FrustumTest::Intersects;
+            }
+        }
+        return result;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const {
+        for (const glm::vec4& p : planes) {
+            if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
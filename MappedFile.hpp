@@ -0,0 +1,128 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Utilidades de archivo compartidas por los formatos horneados (BakedModel.hpp, CookedTexture.hpp):
+// mapeo de solo lectura y la marca del archivo original para detectar cuando hay que regenerarlos.
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Tamano y fecha del archivo original. Devuelve false si no existe.
+inline bool bakedSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& modifiedTime) {
+    struct stat info;
+    if (stat(sourcePath.c_str(), &info) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+    modifiedTime = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+// Archivo de solo lectura mapeado en memoria. En Windows se lee completo a un buffer.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Al mover, el mapeo (o el buffer) no cambia de direccion: los punteros a data() siguen valiendo
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+#ifdef _WIN32
+            buffer = std::move(other.buffer);
+#endif
+            other.bytes = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) {
+            return false;
+        }
+        buffer.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        bytes = buffer.data();
+        length = buffer.size();
+        return static_cast<bool>(in);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // El mapeo sigue valido sin el descriptor
+        if (mapping == MAP_FAILED) {
+            length = 0;
+            return false;
+        }
+        madvise(mapping, length, MADV_WILLNEED);
+        bytes = static_cast<const unsigned char*>(mapping);
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (bytes) {
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<unsigned char> buffer;
+#endif
+};
@@ -0,0 +1,98 @@
+ 
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Conversion de un aiMesh a los arreglos de vertices que se suben a la GPU.
+// Separado de AnimatedModel::processMesh para poder medirlo sin contexto GL.
+#pragma once
+
+#include <assimp/scene.h>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+
+#include "Animation.hpp"
+
+// Datos de un mesh en memoria de CPU, listos para glBufferData
+struct MeshData {
+    std::vector<float> vertices;          // 8 floats por vertice: posicion (3), normal (3), UV (2)
+    std::vector<unsigned int> indices;
+    std::vector<float> boneWeightsData;   // 4 pesos por vertice
+    std::vector<int> boneIDsData;         // 4 IDs de hueso por vertice (-1 = sin hueso)
+};
+
+inline void buildMeshData(const aiMesh* mesh, const std::map<std::string, Bone>& bones, MeshData& out) {
+    out.vertices.clear();
+    out.indices.clear();
+    out.boneWeightsData.clear();
+    out.boneIDsData.clear();
+
+    out.boneWeightsData.resize(mesh->mNumVertices * 4, 0.0f);
+    out.boneIDsData.resize(mesh->mNumVertices * 4, -1);
+
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        out.vertices.push_back(mesh->mVertices[i].x);
+        out.vertices.push_back(mesh->mVertices[i].y);
+        out.vertices.push_back(mesh->mVertices[i].z);
+        out.vertices.push_back(mesh->mNormals[i].x);
+        out.vertices.push_back(mesh->mNormals[i].y);
+        out.vertices.push_back(mesh->mNormals[i].z);
+        if (mesh->mTextureCoords[0]) {
+            out.vertices.push_back(mesh->mTextureCoords[0][i].x);
+            out.vertices.push_back(mesh->mTextureCoords[0][i].y);
+        } else {
+            out.vertices.push_back(0.0f);
+            out.vertices.push_back(0.0f);
+        }
+    }
+
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        aiFace face = mesh->mFaces[i];
+        for (unsigned int j = 0; j < face.mNumIndices; j++) {
+            out.indices.push_back(face.mIndices[j]);
+        }
+    }
+
+    for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+        aiBone* bone = mesh->mBones[i];
+        std::string boneName = bone->mName.C_Str();
+
+        int boneIndex = -1;
+        auto it = bones.find(boneName);
+        if (it != bones.end()) {
+            boneIndex = it->second.id;
+        } else {
+            std::cerr << "Warning: Bone '" << boneName << "' not found in bone map during mesh processing. This bone will not influence vertices." << std::endl;
+            continue;
+        }
+
+        // CORRECTED LINE: Loop through bone->mNumWeights, not mWeights[j].mNumWeights
+        for (unsigned int j = 0; j < bone->mNumWeights; j++) {
+            aiVertexWeight weight = bone->mWeights[j];
+            unsigned int vertexID = weight.mVertexId;
+
+            for (int k = 0; k < 4; k++) {
+                if (out.boneWeightsData[vertexID * 4 + k] == 0.0f) {
+                    out.boneWeightsData[vertexID * 4 + k] = weight.mWeight;
+                    out.boneIDsData[vertexID * 4 + k] = boneIndex;
+                    break;
+                }
+            }
+        }
+    }
+}
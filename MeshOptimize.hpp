@@ -0,0 +1,151 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Optimizacion de meshes al importar, sin llamadas a OpenGL:
+//   1. weldMeshVertices: junta los vertices identicos (Assimp los entrega repetidos por cara)
+//   2. optimizeVertexCache: ordena los triangulos para la cache de vertices (VertexCache.hpp)
+//   3. optimizeOverdraw: dibuja primero los grupos de triangulos que miran hacia fuera del modelo
+//   4. optimizeVertexFetch: renumera los vertices en el orden en que los piden los indices
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "MeshData.hpp"
+#include "VertexCache.hpp"
+
+// Junta los vertices con todos los atributos iguales bit a bit (posicion, normal, UV, huesos y
+// pesos) y reescribe los indices. Devuelve cuantos vertices quedan.
+inline size_t weldMeshVertices(MeshData& mesh) {
+    const size_t vertexCount = mesh.vertices.size() / 8;
+    const bool skinned = mesh.boneIDsData.size() >= vertexCount * 4 && mesh.boneWeightsData.size() >= vertexCount * 4;
+    auto same = [&](size_t a, size_t b) {
+        return std::memcmp(&mesh.vertices[a * 8], &mesh.vertices[b * 8], 8 * sizeof(float)) == 0 &&
+               (!skinned || (std::memcmp(&mesh.boneIDsData[a * 4], &mesh.boneIDsData[b * 4], 4 * sizeof(int)) == 0 &&
+                             std::memcmp(&mesh.boneWeightsData[a * 4], &mesh.boneWeightsData[b * 4], 4 * sizeof(float)) == 0));
+    };
+    auto hash = [&](size_t v) {
+        uint32_t h = 2166136261u; // FNV-1a de los bytes de posicion, normal y UV
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&mesh.vertices[v * 8]);
+        for (size_t i = 0; i < 8 * sizeof(float); ++i) {
+            h = (h ^ bytes[i]) * 16777619u;
+        }
+        return h;
+    };
+
+    // Tabla abierta de potencia de 2 con al menos el doble de huecos que vertices
+    size_t buckets = 1;
+    while (buckets < vertexCount * 2) {
+        buckets <<= 1;
+    }
+    const uint32_t kEmpty = 0xffffffffu;
+    std::vector<uint32_t> table(buckets, kEmpty);
+    std::vector<uint32_t> remap(vertexCount);
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        size_t slot = hash(v) & (buckets - 1);
+        while (table[slot] != kEmpty && !same(table[slot], v)) {
+            slot = (slot + 1) & (buckets - 1);
+        }
+        if (table[slot] == kEmpty) {
+            // El vertice se queda en la posicion unique (siempre <= v, asi que se puede copiar encima)
+            table[slot] = static_cast<uint32_t>(unique);
+            if (unique != v) {
+                std::memcpy(&mesh.vertices[unique * 8], &mesh.vertices[v * 8], 8 * sizeof(float));
+                if (skinned) {
+                    std::memcpy(&mesh.boneIDsData[unique * 4], &mesh.boneIDsData[v * 4], 4 * sizeof(int));
+                    std::memcpy(&mesh.boneWeightsData[unique * 4], &mesh.boneWeightsData[v * 4], 4 * sizeof(float));
+                }
+            }
+            ++unique;
+        }
+        remap[v] = table[slot];
+    }
+    for (unsigned int& index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices.resize(unique * 8);
+    if (skinned) {
+        mesh.boneIDsData.resize(unique * 4);
+        mesh.boneWeightsData.resize(unique * 4);
+    }
+    return unique;
+}
+
+// Renumera los vertices por orden de primer uso en los indices; los que no usa ningun indice se quitan
+inline size_t optimizeVertexFetch(MeshData& mesh) {
+    const size_t vertexCount = mesh.vertices.size() / 8;
+    const bool skinned = mesh.boneIDsData.size() >= vertexCount * 4 && mesh.boneWeightsData.size() >= vertexCount * 4;
+    const uint32_t kUnused = 0xffffffffu;
+    std::vector<uint32_t> remap(vertexCount, kUnused);
+    std::vector<float> vertices;
+    std::vector<int> boneIDs;
+    std::vector<float> boneWeights;
+    vertices.reserve(mesh.vertices.size());
+    for (unsigned int& index : mesh.indices) {
+        if (remap[index] == kUnused) {
+            remap[index] = static_cast<uint32_t>(vertices.size() / 8);
+            vertices.insert(vertices.end(), mesh.vertices.begin() + index * 8, mesh.vertices.begin() + index * 8 + 8);
+            if (skinned) {
+                boneIDs.insert(boneIDs.end(), mesh.boneIDsData.begin() + index * 4, mesh.boneIDsData.begin() + index * 4 + 4);
+                boneWeights.insert(boneWeights.end(), mesh.boneWeightsData.begin() + index * 4,
+                                   mesh.boneWeightsData.begin() + index * 4 + 4);
+            }
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+    if (skinned) {
+        mesh.boneIDsData.swap(boneIDs);
+        mesh.boneWeightsData.swap(boneWeights);
+    }
+    return mesh.vertices.size() / 8;
+}
+
+// Lo que cambio la optimizacion en un juego de meshes
+struct MeshOptimizeReport {
+    size_t meshes = 0;
+    size_t verticesBefore = 0, verticesAfter = 0;
+    VertexCacheStats before, after;
+
+    void add(size_t vertexCountBefore, size_t vertexCountAfter, const VertexCacheStats& statsBefore, const VertexCacheStats& statsAfter) {
+        ++meshes;
+        verticesBefore += vertexCountBefore;
+        verticesAfter += vertexCountAfter;
+        before.add(statsBefore);
+        after.add(statsAfter);
+    }
+};
+
+// Las cuatro pasadas sobre un mesh importado (lista de triangulos, 8 floats por vertice)
+inline void optimizeMesh(MeshData& mesh, MeshOptimizeReport& report) {
+    if (mesh.indices.size() < 3 || mesh.vertices.empty()) {
+        return;
+    }
+    const size_t vertexCountBefore = mesh.vertices.size() / 8;
+    const VertexCacheStats statsBefore = analyzeVertexCache(mesh.indices.data(), mesh.indices.size());
+
+    weldMeshVertices(mesh);
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), &clusters);
+    optimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), 8, clusters);
+    optimizeVertexFetch(mesh);
+
+    report.add(vertexCountBefore, mesh.vertices.size() / 8, statsBefore,
+               analyzeVertexCache(mesh.indices.data(), mesh.indices.size()));
+}
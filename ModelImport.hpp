@@ -0,0 +1,165 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Importacion de un modelo con Assimp a estructuras de CPU (sin llamadas a OpenGL).
+// La usan ModelAsset cuando no hay modelo horneado y la herramienta bake.
+#pragma once
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Animation.hpp"
+#include "MeshData.hpp"
+#include "MeshOptimize.hpp"
+
+// Un mesh listo para subir a la GPU y el nombre de su textura difusa tal como aparece
+// en el material ("" = sin textura). Se resuelve con resolveTexturePath al cargarla.
+struct ModelMeshData {
+    MeshData data;
+    std::string textureFile;
+};
+
+// Todo lo que necesita un ModelAsset, ya sin aiScene
+struct ModelData {
+    std::vector<ModelMeshData> meshes;
+    Skeleton skeleton;
+    std::vector<Animation> animations;
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    glm::mat4 globalInverseTransform = glm::mat4(1.0f);
+};
+
+inline std::string modelDirectory(const std::string& path) {
+    size_t lastSlash = path.find_last_of("/\\");
+    if (lastSlash != std::string::npos) {
+        return path.substr(0, lastSlash);
+    }
+    return "."; // If no path, assume current directory
+}
+
+inline std::string resolveTexturePath(const std::string& directory, const std::string& filename) {
+    // Check if the filename from Assimp is already an absolute path
+    // (e.g., starts with C:/ or /home/)
+    if (filename.length() > 2 && filename[1] == ':' && (filename[0] >= 'A' && filename[0] <= 'Z')) { // Windows absolute path
+        return filename;
+    } else if (filename.length() > 0 && (filename[0] == '/' || filename.find(":/") != std::string::npos)) { // Linux/macOS absolute path or general absolute path
+        return filename;
+    }
+    // Otherwise, assume it's relative to the model's directory
+    return directory + "/" + filename;
+}
+
+inline glm::vec3 calculateModelCenter(const aiScene* scene) {
+    glm::vec3 minBounds(std::numeric_limits<float>::max()), maxBounds(std::numeric_limits<float>::lowest());
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        aiMesh* mesh = scene->mMeshes[i];
+        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
+            aiVector3D pos = mesh->mVertices[j];
+            minBounds.x = std::min(minBounds.x, pos.x);
+            minBounds.y = std::min(minBounds.y, pos.y);
+            minBounds.z = std::min(minBounds.z, pos.z);
+            maxBounds.x = std::max(maxBounds.x, pos.x);
+            maxBounds.y = std::max(maxBounds.y, pos.y);
+            maxBounds.z = std::max(maxBounds.z, pos.z);
+        }
+    }
+    return (minBounds + maxBounds) * 0.5f;
+}
+
+// Asigna IDs consecutivos a los huesos en el orden en que aparecen en los meshes
+inline void collectBones(const aiScene* scene, std::map<std::string, Bone>& bones) {
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[i];
+        for (unsigned int j = 0; j < mesh->mNumBones; j++) {
+            aiBone* bone = mesh->mBones[j];
+            std::string boneName = bone->mName.C_Str();
+
+            if (bones.find(boneName) == bones.end()) {
+                Bone b;
+                b.name = boneName;
+                b.offsetMatrix = convertMatrix(bone->mOffsetMatrix);
+                b.id = static_cast<int>(bones.size());
+                bones[boneName] = b;
+            }
+        }
+    }
+}
+
+// report != nullptr: cada mesh pasa por optimizeMesh (MeshOptimize.hpp)
+inline void collectNodeMeshes(const aiNode* node, const aiScene* scene, const std::map<std::string, Bone>& bones,
+                              ModelData& out, MeshOptimizeReport* report = nullptr) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        ModelMeshData meshData;
+        buildMeshData(mesh, bones, meshData.data);
+        if (report) {
+            optimizeMesh(meshData.data, *report);
+        }
+
+        aiString str;
+        if (scene->mMaterials[mesh->mMaterialIndex]->GetTexture(aiTextureType_DIFFUSE, 0, &str) == AI_SUCCESS) {
+            meshData.textureFile = str.C_Str();
+        }
+        out.meshes.push_back(std::move(meshData));
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        collectNodeMeshes(node->mChildren[i], scene, bones, out, report);
+    }
+}
+
+// Lee el archivo con Assimp y lo convierte a ModelData. El aiScene se libera al volver.
+// Con optimize los meshes se sueldan y se reordenan para la cache de vertices, el overdraw y la
+// lectura de vertices; como bake tambien importa por aqui, el .baked ya guarda el resultado.
+inline bool importModel(const std::string& path, ModelData& out, bool optimize = true) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs |
+                                             aiProcess_CalcTangentSpace | aiProcess_ValidateDataStructure);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    std::cout << "Model loaded successfully. Meshes: " << scene->mNumMeshes
+                << ", Animations: " << scene->mNumAnimations << std::endl;
+
+    std::map<std::string, Bone> bones;
+    collectBones(scene, bones);
+
+    out = ModelData();
+    MeshOptimizeReport report;
+    collectNodeMeshes(scene->mRootNode, scene, bones, out, optimize ? &report : nullptr);
+    if (optimize && report.meshes > 0) {
+        std::cout << "Mesh optimization: " << report.meshes << " meshes, " << report.verticesBefore << " -> "
+                  << report.verticesAfter << " vertices, ACMR " << report.before.acmr() << " -> " << report.after.acmr()
+                  << ", ATVR " << report.before.atvr() << " -> " << report.after.atvr() << " (FIFO " << kVertexCacheSize
+                  << ")" << std::endl;
+    }
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+        out.animations.push_back(convertAnimation(scene->mAnimations[i], bones));
+    }
+    out.skeleton = buildSkeleton(scene->mRootNode, bones);
+    out.globalInverseTransform = glm::inverse(convertMatrix(scene->mRootNode->mTransformation));
+    out.modelCenter = calculateModelCenter(scene);
+    return true;
+}
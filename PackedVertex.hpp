@@ -0,0 +1,231 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Formato compacto de vertice con skinning, sin llamadas a OpenGL.
+//
+// buildMeshData deja 8 floats por vertice (posicion, normal, UV) mas 4 IDs int y 4 pesos float en
+// otros dos buffers: 64 bytes por vertice. PackedSkinnedVertex guarda lo mismo en 24 bytes en un
+// solo stream intercalado:
+//   posicion  3 x unorm16 dentro de la caja del modelo (+ 2 bytes de relleno)
+//   normal    2 x snorm16, codificacion octaedrica
+//   UV        2 x half float
+//   huesos    4 x uint8 (kPackedNoBone = sin hueso, asi que como mucho 255 huesos)
+//   pesos     4 x unorm8, renormalizados para que sumen exactamente 255
+// El vertex shader decodifica la posicion con la caja (uniforms) y la normal con octDecode; el resto
+// lo convierte el propio glVertexAttribPointer. Los indices pasan a 16 bits si el mesh tiene como
+// mucho 65536 vertices.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct PackedSkinnedVertex {
+    uint16_t position[4]; // El cuarto es relleno para alinear la normal a 4 bytes
+    int16_t normal[2];
+    uint16_t uv[2];
+    uint8_t boneIds[4];
+    uint8_t weights[4];
+};
+static_assert(sizeof(PackedSkinnedVertex) == 24, "PackedSkinnedVertex debe ocupar 24 bytes");
+
+constexpr uint8_t kPackedNoBone = 255;
+constexpr size_t kPackedMaxBones = 255;
+
+// Bytes por vertice del formato de buildMeshData (tres buffers)
+constexpr size_t kFloatSkinnedVertexBytes = 8 * sizeof(float) + 4 * sizeof(int) + 4 * sizeof(float);
+
+// Caja de cuantizacion de las posiciones: posicion = min + q / 65535 * extent
+struct PackedVertexBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 extent = glm::vec3(1.0f);
+};
+
+// Caja de todos los vertices (stride floats por vertice, la posicion al principio). Un eje sin
+// extension se deja en 1 para no dividir por cero.
+inline void expandPackedVertexBounds(const float* vertices, size_t vertexCount, size_t stride, glm::vec3& lo, glm::vec3& hi) {
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const float* p = vertices + v * stride;
+        lo = glm::min(lo, glm::vec3(p[0], p[1], p[2]));
+        hi = glm::max(hi, glm::vec3(p[0], p[1], p[2]));
+    }
+}
+
+inline PackedVertexBounds packedVertexBounds(const glm::vec3& lo, const glm::vec3& hi) {
+    PackedVertexBounds bounds;
+    if (lo.x > hi.x) {
+        return bounds;
+    }
+    bounds.min = lo;
+    for (int a = 0; a < 3; ++a) {
+        bounds.extent[a] = hi[a] > lo[a] ? hi[a] - lo[a] : 1.0f;
+    }
+    return bounds;
+}
+
+// float -> half (IEEE 754 binary16) redondeando al mas cercano; los valores fuera de rango se
+// saturan a infinito y los muy pequeños pasan a subnormales o cero
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t absBits = bits & 0x7fffffffu;
+    if (absBits >= 0x7f800000u) { // Inf o NaN
+        return static_cast<uint16_t>(sign | 0x7c00u | (absBits > 0x7f800000u ? 0x200u : 0u));
+    }
+    if (absBits >= 0x477ff000u) { // >= 65520: fuera de rango
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (absBits < 0x38800000u) { // < 2^-14: subnormal
+        float magnitude;
+        std::memcpy(&magnitude, &absBits, sizeof(magnitude));
+        return static_cast<uint16_t>(sign | static_cast<uint16_t>(std::lround(magnitude * 16777216.0f))); // 2^24
+    }
+    uint32_t half = ((absBits - 0x38000000u) >> 13);
+    uint32_t remainder = absBits & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+inline float halfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1fu;
+    const uint32_t mantissa = half & 0x3ffu;
+    if (exponent == 0) {
+        float magnitude = mantissa / 16777216.0f;
+        return sign ? -magnitude : magnitude;
+    }
+    uint32_t bits = sign | ((exponent == 31 ? 255u : exponent + 112u) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Normal unitaria -> dos componentes en [-1, 1] (octaedro desplegado sobre el plano)
+inline glm::vec2 octEncode(const glm::vec3& n) {
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (sum <= 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 e(n.x / sum, n.y / sum);
+    if (n.z < 0.0f) {
+        glm::vec2 folded((1.0f - std::fabs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::fabs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+        e = folded;
+    }
+    return e;
+}
+
+// Igual que octDecode en el shader
+inline glm::vec3 octDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f) {
+        float x = (1.0f - std::fabs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+        float y = (1.0f - std::fabs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+        n.x = x;
+        n.y = y;
+    }
+    return glm::normalize(n);
+}
+
+inline int16_t packSnorm16(float v) {
+    return static_cast<int16_t>(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+}
+
+inline uint16_t packUnorm16(float v) {
+    return static_cast<uint16_t>(std::lround(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f));
+}
+
+// Pesos a unorm8 que suman 255: se reparten por redondeo y el resto va al peso mayor. Sin pesos
+// (o sin huesos validos) todo queda a 0 y el shader deja el vertice sin deformar.
+inline void packBoneInfluences(const int* ids, const float* weights, uint8_t* packedIds, uint8_t* packedWeights) {
+    float total = 0.0f;
+    for (int k = 0; k < 4; ++k) {
+        if (ids[k] >= 0 && weights[k] > 0.0f) {
+            total += weights[k];
+        }
+    }
+    int sum = 0, largest = 0;
+    for (int k = 0; k < 4; ++k) {
+        const bool used = total > 0.0f && ids[k] >= 0 && weights[k] > 0.0f;
+        packedIds[k] = used ? static_cast<uint8_t>(ids[k]) : kPackedNoBone;
+        packedWeights[k] = used ? static_cast<uint8_t>(std::lround(weights[k] / total * 255.0f)) : 0;
+        sum += packedWeights[k];
+        if (packedWeights[k] > packedWeights[largest]) {
+            largest = k;
+        }
+    }
+    if (sum > 0) {
+        packedWeights[largest] = static_cast<uint8_t>(packedWeights[largest] + 255 - sum);
+    }
+}
+
+// vertices: 8 floats por vertice como en buildMeshData. Los IDs deben ser < kPackedMaxBones.
+inline void packSkinnedVertices(const float* vertices, size_t vertexCount, const int* boneIds, const float* boneWeights,
+                                const PackedVertexBounds& bounds, std::vector<PackedSkinnedVertex>& out) {
+    out.resize(vertexCount);
+    const glm::vec3 inverseExtent(1.0f / bounds.extent.x, 1.0f / bounds.extent.y, 1.0f / bounds.extent.z);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const float* in = vertices + v * 8;
+        PackedSkinnedVertex& p = out[v];
+        for (int a = 0; a < 3; ++a) {
+            p.position[a] = packUnorm16((in[a] - bounds.min[a]) * inverseExtent[a]);
+        }
+        p.position[3] = 0;
+        glm::vec2 octahedral = octEncode(glm::vec3(in[3], in[4], in[5]));
+        p.normal[0] = packSnorm16(octahedral.x);
+        p.normal[1] = packSnorm16(octahedral.y);
+        p.uv[0] = floatToHalf(in[6]);
+        p.uv[1] = floatToHalf(in[7]);
+        packBoneInfluences(boneIds + v * 4, boneWeights + v * 4, p.boneIds, p.weights);
+    }
+}
+
+// Indices de 16 bits si todos caben
+inline bool narrowIndices(const unsigned int* indices, size_t count, size_t vertexCount, std::vector<uint16_t>& out) {
+    if (vertexCount > 65536) {
+        return false;
+    }
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint16_t>(indices[i]);
+    }
+    return true;
+}
+
+// Bytes de vertices e indices que lee la GPU por dibujo, antes y despues de empaquetar
+struct VertexBandwidthReport {
+    size_t vertices = 0, indices = 0;
+    size_t meshes = 0, shortIndexMeshes = 0;
+    size_t floatBytes = 0;  // 64 bytes por vertice, indices de 32 bits
+    size_t packedBytes = 0; // Formato que se subio
+
+    void add(size_t vertexCount, size_t indexCount, bool packed, bool shortIndices) {
+        vertices += vertexCount;
+        indices += indexCount;
+        ++meshes;
+        shortIndexMeshes += shortIndices ? 1 : 0;
+        floatBytes += vertexCount * kFloatSkinnedVertexBytes + indexCount * sizeof(uint32_t);
+        packedBytes += vertexCount * (packed ? sizeof(PackedSkinnedVertex) : kFloatSkinnedVertexBytes) +
+                       indexCount * (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t));
+    }
+};
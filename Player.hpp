@@ -32,95 +32,505 @@
 #include <string>
 #include <algorithm> // For std::min/max
 #include <limits>    // For std::numeric_limits
+#include <cstddef>   // For offsetof
 #include <memory>    // For std::unique_ptr
 
 // Necessary for stb_image.h
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h" // Make sure this file is in your project
 
-// Bone structure
-struct Bone {
-    std::string name;
-    int id; // Unique ID for the bone, used as an index in boneTransforms
-    glm::mat4 offsetMatrix;
-    glm::mat4 finalTransformation;
-};
-
-// Animation information structure
-struct Animation {
-    std::string name;
-    double duration;
-    double ticksPerSecond;
-    std::map<std::string, std::vector<aiVectorKey>> positionKeyframes;
-    std::map<std::string, std::vector<aiQuatKey>> rotationKeyframes;
-    std::map<std::string, std::vector<aiVectorKey>> scalingKeyframes;
-};
+#include "Animation.hpp"
+#include "AnimationCompression.hpp"
+#include "MeshData.hpp"
+#include "ModelImport.hpp"
+#include "BakedModel.hpp"
+#include "AnimationWorkers.hpp"
+#include "AnimationLod.hpp"
+#include "SkinnedBounds.hpp"
+#include "ShaderProgram.hpp"
+#include "RenderQueue.hpp"
+#include "TextureManager.hpp"
+#include "CpuSkinning.hpp"
+#include "SkinnedInstancing.hpp"
+#include "PackedVertex.hpp"
 
 // Mesh data structure
 struct Mesh {
     GLuint VAO, VBO, EBO;
-    GLuint boneIDVBO;    // VBO for bone IDs
+    GLuint boneIDVBO;    // VBO for bone IDs (0 con vertices empaquetados: todo va en VBO)
     GLuint boneWeightVBO; // VBO for bone weights
     unsigned int indexCount;
+    size_t vertexCount;
     GLuint textureID; // Texture ID for this mesh
+    bool packed = false; // VBO con PackedSkinnedVertex en vez de 8 floats por vertice
+    GLenum indexType = GL_UNSIGNED_INT;
 };
 
-// Animated model class
-class AnimatedModel {
+// Atributo de UV (location 4) desde el VBO del mesh, en el formato en que se subio
+inline void bindMeshTexCoords(const Mesh& mesh) {
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    if (mesh.packed) {
+        glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedSkinnedVertex), (void*)offsetof(PackedSkinnedVertex, uv));
+    } else {
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    }
+    glEnableVertexAttribArray(4);
+}
+
+// Atributos de un mesh para el skinning en CPU (CpuSkinning.hpp). Apuntan al archivo horneado
+// mapeado o a los MeshData importados, que el ModelAsset mantiene vivos: no se copian.
+struct MeshSkinningData {
+    const float* vertices = nullptr;    // 8 floats por vertice, igual que el VBO
+    const int* boneIDs = nullptr;       // 4 por vertice
+    const float* boneWeights = nullptr; // 4 por vertice
+};
+
+// Programa de skinning y sus uniforms, resueltos una vez al enlazar (ver ModelAssetCache).
+// La matriz de modelo y la paleta de cada instancia se leen del texture buffer de SkinnedInstancing.hpp.
+struct SkinnedShader {
+    ShaderProgram program;
+    Uniform view, projection;
+    Uniform lightPos, viewPos, lightColor, ambientStrength, diffuseStrength;
+    Uniform paletteBase, boneCount; // Primer texel del dibujo y huesos por instancia
+    Uniform preskinned; // Los vertices ya vienen deformados desde la CPU (AnimatedModel::setCpuSkinning)
+    Uniform bakedPoses; // Las instancias leen la paleta de su frame horneado (AnimatedModel::setBakedPlayback)
+    Uniform packedVertices, positionMin, positionExtent; // Formato de PackedVertex.hpp y su caja de cuantizacion
+
+    bool build(const char* vertexSource, const char* fragmentSource) {
+        if (!program.build(vertexSource, fragmentSource, "skinned")) {
+            return false;
+        }
+        view = program.uniform("view");
+        projection = program.uniform("projection");
+        lightPos = program.uniform("lightPos");
+        viewPos = program.uniform("viewPos");
+        lightColor = program.uniform("lightColor");
+        ambientStrength = program.uniform("ambientStrength");
+        diffuseStrength = program.uniform("diffuseStrength");
+        paletteBase = program.uniform("paletteBase");
+        boneCount = program.uniform("boneCount");
+        preskinned = program.uniform("preskinned");
+        bakedPoses = program.uniform("bakedPoses");
+        packedVertices = program.uniform("packedVertices");
+        positionMin = program.uniform("positionMin");
+        positionExtent = program.uniform("positionExtent");
+        program.setSampler("ourTexture", 0);
+        program.setSampler("bonePalettes", kBonePaletteTextureUnit);
+        program.setSampler("bakedPalettes", kBakedPoseTextureUnit);
+        return true;
+    }
+};
+
+// Datos inmutables de un modelo: meshes en la GPU, texturas, esqueleto y animaciones.
+// Se carga una sola vez por archivo (ver ModelAssetCache) y lo comparten todas sus instancias.
+class ModelAsset {
 private:
-    Assimp::Importer importer; 
+    std::string directory; // Base directory of the model for loading textures.
+    TextureManager* textureManager = nullptr;
+    std::vector<TextureHandle> textures; // Mantiene vivas en el gestor las texturas de los meshes
+    SkinBindBounds bindBounds; // Cajas por hueso de todos los meshes, para calcular clipBounds
+    std::vector<MeshSkinningData> skinningData; // Mismo orden que meshes
+    MappedFile bakedFile;                // Archivo horneado del que leen skinningData (si se cargo de ahi)
+    std::vector<MeshData> importedMeshes; // O los meshes importados con Assimp
+    mutable AnimationClipLibrary clips; // Comprimidos; se descomprimen al reproducirlos (acquireClip)
+    std::vector<float> boneInfluence;   // Suma de pesos de skinning por Bone::id (normalizada al terminar la carga)
+    std::vector<uint8_t> lowInfluence;  // Huesos que el LOD lejano deja en la pose de enlace (lowInfluenceBones)
+    BakedPoses poses;                   // Paletas de cada clip a frecuencia fija, para las multitudes lejanas
+    bool packedVertices = false;        // Meshes con PackedSkinnedVertex (ver uploadMeshes)
+    PackedVertexBounds packedBounds;    // Caja de cuantizacion de las posiciones de todos los meshes
+
+    // Sube los meshes a la GPU. Los punteros pueden venir de un MeshData o directamente del archivo
+    // horneado mapeado en memoria. Con pack los vertices se empaquetan a PackedSkinnedVertex (si el
+    // esqueleto cabe en IDs de 8 bits), todos con la misma caja de cuantizacion para que un solo
+    // juego de uniforms sirva para todos los meshes del modelo.
+    void uploadMeshes(const std::vector<BakedMeshView>& views, bool pack) {
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+        int maxBone = -1;
+        for (const BakedMeshView& view : views) {
+            expandPackedVertexBounds(view.vertices, view.vertexFloatCount / 8, 8, lo, hi);
+            // El empaquetado lee 4 influencias por vertice
+            pack = pack && view.boneIDCount >= view.vertexFloatCount / 2 && view.boneWeightCount >= view.vertexFloatCount / 2;
+            for (size_t i = 0; i < view.boneIDCount; ++i) {
+                maxBone = std::max(maxBone, view.boneIDs[i]);
+            }
+        }
+        if (pack && maxBone >= static_cast<int>(kPackedMaxBones)) {
+            std::cerr << "Warning: bone IDs up to " << maxBone << " do not fit in 8 bits; keeping float vertices." << std::endl;
+            pack = false;
+        }
+        packedVertices = pack;
+        packedBounds = packedVertexBounds(lo, hi);
 
-    std::map<std::string, Bone> bones;
-    std::vector<glm::mat4> boneTransforms;
-    std::vector<Animation> animations;
-    const aiScene* scene;
+        VertexBandwidthReport report;
+        for (const BakedMeshView& view : views) {
+            uploadMesh(view, report);
+        }
+        std::cout << "Vertex format: " << (packedVertices ? "packed" : "float") << ", "
+                  << (packedVertices ? sizeof(PackedSkinnedVertex) : kFloatSkinnedVertexBytes) << " bytes per vertex, 16-bit indices in "
+                  << report.shortIndexMeshes << " of " << report.meshes << " meshes: " << (report.floatBytes >> 10) << " KiB -> "
+                  << (report.packedBytes >> 10) << " KiB of vertex and index data per draw" << std::endl;
+    }
+
+    void uploadMesh(const BakedMeshView& view, VertexBandwidthReport& report) {
+        const float* vertices = view.vertices;
+        const size_t vertexFloatCount = view.vertexFloatCount, vertexCount = vertexFloatCount / 8;
+        const unsigned int* indices = view.indices;
+        const size_t indexCount = view.indexCount;
+        const float* boneWeights = view.boneWeights;
+        const int* boneIDs = view.boneIDs;
+        const size_t boneWeightCount = view.boneWeightCount, boneIDCount = view.boneIDCount;
+
+        Mesh m;
+        m.packed = packedVertices;
+        glGenVertexArrays(1, &m.VAO);
+        glGenBuffers(1, &m.VBO);
+        glGenBuffers(1, &m.EBO);
+        m.boneIDVBO = m.boneWeightVBO = 0;
+
+        glBindVertexArray(m.VAO);
+        std::vector<uint16_t> shortIndices;
+        const bool narrow = packedVertices && narrowIndices(indices, indexCount, vertexCount, shortIndices);
+        m.indexType = narrow ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
+        if (narrow) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+        }
+
+        if (m.packed) {
+            // Un solo stream: posicion (unorm16), normal octaedrica (snorm16), UV (half), IDs (uint8), pesos (unorm8)
+            std::vector<PackedSkinnedVertex> packed;
+            packSkinnedVertices(vertices, vertexCount, boneIDs, boneWeights, packedBounds, packed);
+            glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedSkinnedVertex), packed.data(), GL_STATIC_DRAW);
+            const GLsizei stride = sizeof(PackedSkinnedVertex);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedSkinnedVertex, position));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(5, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedSkinnedVertex, normal));
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(PackedSkinnedVertex, boneIds));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedSkinnedVertex, weights));
+            glEnableVertexAttribArray(3);
+            bindMeshTexCoords(m);
+        } else {
+            glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
+            glBufferData(GL_ARRAY_BUFFER, vertexFloatCount * sizeof(float), vertices, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            bindMeshTexCoords(m);
+
+            glGenBuffers(1, &m.boneIDVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, m.boneIDVBO);
+            glBufferData(GL_ARRAY_BUFFER, boneIDCount * sizeof(int), boneIDs, GL_STATIC_DRAW);
+            glVertexAttribIPointer(2, 4, GL_INT, 4 * sizeof(int), (void*)0);
+            glEnableVertexAttribArray(2);
+
+            glGenBuffers(1, &m.boneWeightVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, m.boneWeightVBO);
+            glBufferData(GL_ARRAY_BUFFER, boneWeightCount * sizeof(float), boneWeights, GL_STATIC_DRAW);
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(3);
+        }
+
+        glBindVertexArray(0);
+        report.add(vertexCount, indexCount, m.packed, narrow);
+
+        accumulateSkinBindBounds(vertices, vertexFloatCount / 8, 8, boneIDs, boneWeights, bindBounds);
+        for (size_t i = 0; i < boneIDCount && i < boneWeightCount; ++i) {
+            if (boneIDs[i] >= 0) {
+                if (static_cast<size_t>(boneIDs[i]) >= boneInfluence.size()) {
+                    boneInfluence.resize(boneIDs[i] + 1, 0.0f);
+                }
+                boneInfluence[boneIDs[i]] += boneWeights[i];
+            }
+        }
+
+        m.indexCount = indexCount;
+        m.vertexCount = vertexCount;
+        m.textureID = 0;
+        if (!view.textureFile.empty() && textureManager) {
+            // Varios meshes suelen compartir el mismo material: el gestor devuelve la misma textura
+            if (TextureHandle texture = textureManager->load(resolveTexturePath(directory, view.textureFile))) {
+                m.textureID = texture->id;
+                textures.push_back(std::move(texture));
+            }
+        }
+
+        meshes.push_back(m);
+        skinningData.push_back({vertices, boneIDs, boneWeights});
+    }
+
+public:
+    const SkinnedShader* shader = nullptr; // Compartido por todos los modelos (pertenece a ModelAssetCache)
+    Skeleton skeleton;
     std::vector<Mesh> meshes;
-    float animationTime = 0.0f;
+    glm::vec3 modelCenter;
     glm::mat4 globalInverseTransform;
+    Aabb bindPoseBounds;            // Caja en espacio del modelo sin animacion
+    std::vector<Aabb> clipBounds;   // Caja conservadora de cada clip (mismo orden que los clips)
+    bool loaded = false;
+
+    // Usa el modelo horneado (<path>.baked, ver bake.cpp) si existe y esta al dia;
+    // si no, importa el archivo con Assimp. packVertices: formato compacto de PackedVertex.hpp.
+    ModelAsset(const std::string& path, const SkinnedShader* skinnedShader, TextureManager* textureManager, bool packVertices = true)
+        : directory(modelDirectory(path)), textureManager(textureManager), shader(skinnedShader) {
+        BakedModel baked;
+        if (loadBakedModel(bakedModelPath(path), path, baked)) {
+            std::cout << "Baked model loaded: " << bakedModelPath(path) << ". Meshes: " << baked.meshes.size()
+                      << ", Animations: " << baked.animations.size() << std::endl;
+            uploadMeshes(baked.meshes, packVertices);
+            bakedFile = std::move(baked.file);
+            skeleton = std::move(baked.skeleton);
+            clips.assign(std::move(baked.animations));
+            poses = std::move(baked.poses);
+            modelCenter = baked.modelCenter;
+            globalInverseTransform = baked.globalInverseTransform;
+        } else {
+            ModelData model;
+            if (!importModel(path, model)) {
+                return;
+            }
+            std::vector<BakedMeshView> views(model.meshes.size());
+            for (size_t i = 0; i < model.meshes.size(); ++i) {
+                const MeshData& data = model.meshes[i].data;
+                BakedMeshView& view = views[i];
+                view.textureFile = model.meshes[i].textureFile;
+                view.vertices = data.vertices.data();
+                view.vertexFloatCount = data.vertices.size();
+                view.indices = data.indices.data();
+                view.indexCount = data.indices.size();
+                view.boneWeights = data.boneWeightsData.data();
+                view.boneWeightCount = data.boneWeightsData.size();
+                view.boneIDs = data.boneIDsData.data();
+                view.boneIDCount = data.boneIDsData.size();
+            }
+            uploadMeshes(views, packVertices);
+            importedMeshes.reserve(model.meshes.size());
+            for (ModelMeshData& mesh : model.meshes) {
+                importedMeshes.push_back(std::move(mesh.data)); // Los vectores se mueven sin cambiar de direccion
+            }
+            skeleton = std::move(model.skeleton);
+            std::vector<CompressedAnimation> compressed;
+            for (const Animation& animation : model.animations) {
+                compressed.push_back(compressAnimation(animation));
+            }
+            clips.assign(std::move(compressed));
+            modelCenter = model.modelCenter;
+            globalInverseTransform = model.globalInverseTransform;
+        }
 
-    int boneCounter = 0; // Counter to assign unique bone IDs
-    std::string directory; // Base directory of the model for loading textures.
-    std::vector<GLuint> textures_loaded; // To avoid loading the same texture multiple times.
+        // Las cajas por clip solo dependen del esqueleto y de los clips: se calculan una vez por modelo,
+        // con cada clip descomprimido solo mientras tanto. Sin archivo horneado, las paletas horneadas
+        // se muestrean en el mismo recorrido.
+        bindPoseBounds = computeClipBounds(skeleton, nullptr, bindBounds);
+        const bool samplePoses = poses.empty();
+        if (samplePoses) {
+            beginBakedPoses(skeleton, kBakedPoseFramesPerSecond, poses);
+        }
+        for (size_t i = 0; i < clips.size(); ++i) {
+            Animation animation = decompressAnimation(clips.compressed(i));
+            clipBounds.push_back(computeClipBounds(skeleton, &animation, bindBounds));
+            if (samplePoses) {
+                appendBakedPoseClip(skeleton, animation, poses);
+            }
+        }
+        bindBounds = SkinBindBounds();
+
+        size_t sourceKeys = 0, keptKeys = 0, decompressedBytes = 0;
+        for (const AnimationClipMemory& clip : clips.memoryReport()) {
+            sourceKeys += clip.sourceKeys;
+            keptKeys += clip.keptKeys;
+            decompressedBytes += clip.decompressedBytes;
+        }
+        std::cout << "Animations: " << clips.size() << " clips, " << keptKeys << " of " << sourceKeys << " keys kept, "
+                  << (clips.compressedBytes() >> 10) << " KiB compressed (" << (decompressedBytes >> 10)
+                  << " KiB decompressed)" << std::endl;
+        std::cout << "Baked poses: " << poses.frameCount() << " frames at " << poses.framesPerSecond << " fps, "
+                  << (poses.bytes() >> 10) << " KiB" << (samplePoses ? " (sampled at load)" : "") << std::endl;
+
+        // Peso de cada hueso como fraccion del total, para el LOD de animacion
+        float totalInfluence = 0.0f;
+        for (float influence : boneInfluence) {
+            totalInfluence += influence;
+        }
+        for (float& influence : boneInfluence) {
+            influence = totalInfluence > 0.0f ? influence / totalInfluence : 0.0f;
+        }
+        boneInfluence.resize(skeleton.boneCount(), 0.0f);
+        lowInfluence = lowInfluenceBones(skeleton, boneInfluence, AnimationLodSettings().boneInfluenceThreshold);
+
+        std::cout << "Skeleton: " << skeleton.nodeCount() << " nodes, " << skeleton.boneCount() << " bones ("
+                  << std::count(lowInfluence.begin(), lowInfluence.end(), 1) << " skipped at far LOD)." << std::endl;
+        std::cout << "Model center: (" << modelCenter.x << ", " << modelCenter.y << ", " << modelCenter.z << ")" << std::endl;
+        loaded = true;
+    }
+
+
+    // Destructor to free OpenGL resources
+    ~ModelAsset() {
+        for (const auto& mesh : meshes) {
+            glDeleteVertexArrays(1, &mesh.VAO);
+            glDeleteBuffers(1, &mesh.VBO);
+            glDeleteBuffers(1, &mesh.EBO);
+            glDeleteBuffers(1, &mesh.boneIDVBO);
+            glDeleteBuffers(1, &mesh.boneWeightVBO);
+        }
+    }
+
+    ModelAsset(const ModelAsset&) = delete;
+    ModelAsset& operator=(const ModelAsset&) = delete;
+
+    // Caja en espacio del modelo mientras se reproduce el clip (-1 = pose de enlace)
+    const Aabb& boundsFor(int clip) const {
+        if (clip >= 0 && static_cast<size_t>(clip) < clipBounds.size()) {
+            return clipBounds[clip];
+        }
+        return bindPoseBounds;
+    }
+
+    size_t clipCount() const {
+        return clips.size();
+    }
+
+    // Clip descomprimido; sigue valido mientras se tenga el puntero aunque salga de la LRU.
+    // Solo desde el hilo principal.
+    std::shared_ptr<const Animation> acquireClip(int clip) const {
+        return clip >= 0 ? clips.acquire(static_cast<size_t>(clip)) : nullptr;
+    }
+
+    const AnimationClipLibrary& clipLibrary() const {
+        return clips;
+    }
+
+    // Entrada del skinning en CPU para el mesh i
+    SkinningSource skinningSource(size_t i) const {
+        const MeshSkinningData& data = skinningData[i];
+        SkinningSource source;
+        source.vertices = data.vertices;
+        source.boneIDs = data.boneIDs;
+        source.boneWeights = data.boneWeights;
+        source.vertexCount = meshes[i].vertexCount;
+        return source;
+    }
+
+    // Fraccion del peso de skinning de cada hueso (por Bone::id)
+    const std::vector<float>& boneInfluences() const {
+        return boneInfluence;
+    }
+
+    // Los VBO de los meshes usan PackedSkinnedVertex; las posiciones se decodifican con vertexBounds()
+    bool usesPackedVertices() const {
+        return packedVertices;
+    }
+
+    const PackedVertexBounds& vertexBounds() const {
+        return packedBounds;
+    }
+
+    // Paletas horneadas de los clips (frame 0 = pose de enlace)
+    const BakedPoses& bakedPoses() const {
+        return poses;
+    }
+
+    // Huesos de poca influencia, para AnimationLodScheduler::add
+    const std::vector<uint8_t>& lowInfluenceBoneMask() const {
+        return lowInfluence;
+    }
+
+    // Clip que reproducen las instancias por defecto (-1 si no hay ninguno)
+    int defaultClip() const {
+        return clips.size() == 0 ? -1 : 0;
+    }
+};
+
+// Cache de modelos por ruta (las texturas las comparte el TextureManager). Tambien compila una sola vez el programa de shaders de skinning.
+class ModelAssetCache {
+private:
+    std::map<std::string, std::shared_ptr<ModelAsset>> assets;
+    SkinnedShader skinnedShader;
+    TextureManager& textureManager;
 
     // Vertex Shader (for Animated Model - UNCHANGED)
-    const char* vertexShaderSource = R"(
+    static constexpr const char* vertexShaderSource = R"(
         #version 330 core
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aNormal;
         layout (location = 2) in ivec4 boneIDs;
         layout (location = 3) in vec4 boneWeights;
         layout (location = 4) in vec2 aTexCoords; // Texture coordinates
+        layout (location = 5) in vec2 aOctNormal; // Normal octaedrica (vertices empaquetados)
 
-        uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
-        uniform mat4 bones[100]; // Max 100 bones
+        uniform samplerBuffer bonePalettes; // Por instancia: modelo y paleta, 3 filas por matriz
+        uniform int paletteBase; // Texel de la primera instancia de este dibujo
+        uniform int boneCount;   // Huesos por instancia
+        uniform bool preskinned; // aPos y aNormal ya vienen deformados (skinning en CPU)
+        uniform samplerBuffer bakedPalettes; // Frames horneados de todos los modelos (BakedPoseAtlas)
+        uniform bool bakedPoses; // Por instancia solo el modelo y el primer texel de su frame horneado
+        uniform bool packedVertices; // aPos cuantizada en [0, 1] dentro de la caja y normal en aOctNormal
+        uniform vec3 positionMin;
+        uniform vec3 positionExtent;
 
         out vec3 Normal;
         out vec3 FragPos;
         out vec2 TexCoords; // Pass to Fragment Shader
 
+        mat4 paletteMatrix(samplerBuffer palettes, int texel) {
+            return transpose(mat4(texelFetch(palettes, texel), texelFetch(palettes, texel + 1),
+                                  texelFetch(palettes, texel + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+        }
+
+        // IDs fuera de la paleta (-1 = sin hueso) no aportan nada. boneTexel: primer hueso de la
+        // instancia en bonePalettes, o de su frame en bakedPalettes.
+        mat4 boneMatrix(int boneTexel, int id) {
+            if (id < 0 || id >= boneCount) {
+                return mat4(0.0);
+            }
+            return bakedPoses ? paletteMatrix(bakedPalettes, boneTexel + 3 * id)
+                              : paletteMatrix(bonePalettes, boneTexel + 3 * id);
+        }
+
+        vec3 octDecode(vec2 e) {
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            if (n.z < 0.0) {
+                n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+            }
+            return normalize(n);
+        }
+
         void main() {
+            // Con skinning en CPU los vertices vienen de su propio VBO en floats
+            bool decode = packedVertices && !preskinned;
+            vec3 position = decode ? positionMin + aPos * positionExtent : aPos;
+            vec3 normal = decode ? octDecode(aOctNormal) : aNormal;
+            int instanceTexel = paletteBase + gl_InstanceID * (bakedPoses ? 4 : 3 * (boneCount + 1));
+            mat4 model = paletteMatrix(bonePalettes, instanceTexel);
+            int boneTexel = bakedPoses ? int(texelFetch(bonePalettes, instanceTexel + 3).x) : instanceTexel + 3;
             mat4 boneTransform = mat4(1.0); // Default to identity matrix (no bone influence)
             
             // Only apply bone transformation if there are significant bone weights
-            if (dot(boneWeights, boneWeights) > 0.0001) { 
-                boneTransform = bones[boneIDs[0]] * boneWeights[0];
-                boneTransform += bones[boneIDs[1]] * boneWeights[1];
-                boneTransform += bones[boneIDs[2]] * boneWeights[2];
-                boneTransform += bones[boneIDs[3]] * boneWeights[3];
+            if (!preskinned && dot(boneWeights, boneWeights) > 0.0001) {
+                boneTransform = boneMatrix(boneTexel, boneIDs[0]) * boneWeights[0];
+                boneTransform += boneMatrix(boneTexel, boneIDs[1]) * boneWeights[1];
+                boneTransform += boneMatrix(boneTexel, boneIDs[2]) * boneWeights[2];
+                boneTransform += boneMatrix(boneTexel, boneIDs[3]) * boneWeights[3];
             }
 
-            vec4 pos = boneTransform * vec4(aPos, 1.0);
+            vec4 pos = boneTransform * vec4(position, 1.0);
             gl_Position = projection * view * model * pos;
             FragPos = vec3(model * pos);
-            Normal = mat3(transpose(inverse(model))) * (boneTransform * vec4(aNormal, 0.0)).xyz;
+            Normal = mat3(transpose(inverse(model))) * (boneTransform * vec4(normal, 0.0)).xyz;
             TexCoords = aTexCoords; // Assign texture coordinates
         }
     )";
 
     // Fragment Shader (for Animated Model - REVERTED TO TEXTURE SAMPLING AND LIGHTING)
-    const char* fragmentShaderSource = R"(
+    static constexpr const char* fragmentShaderSource = R"(
         #version 330 core
         out vec4 FragColor;
         in vec3 Normal;
@@ -149,506 +559,405 @@ private:
         }
     )";
 
-    glm::mat4 convertMatrix(const aiMatrix4x4& from) {
-        glm::mat4 to;
-        to[0][0] = from.a1; to[0][1] = from.b1; to[0][2] = from.c1; to[0][3] = from.d1;
-        to[1][0] = from.a2; to[1][1] = from.b2; to[1][2] = from.c2; to[1][3] = from.d2;
-        to[2][0] = from.a3; to[2][1] = from.b3; to[2][2] = from.c3; to[2][3] = from.d3;
-        to[3][0] = from.a4; to[3][1] = from.b4; to[3][2] = from.c4; to[3][3] = from.d4;
-        return to;
-    }
-
-    void processNode(aiNode* node, const aiScene* scene) {
-        for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            processMesh(mesh);
-        }
-        for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            processNode(node->mChildren[i], scene);
-        }
-    }
+public:
+    // Formato compacto de vertices (PackedVertex.hpp) para los modelos que se carguen a partir de ahora
+    bool packVertices = true;
 
-    void processMesh(aiMesh* mesh) {
-        std::vector<float> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<float> boneWeightsData;
-        std::vector<int> boneIDsData;
+    explicit ModelAssetCache(TextureManager& textureManager) : textureManager(textureManager) {}
+    ModelAssetCache(const ModelAssetCache&) = delete;
+    ModelAssetCache& operator=(const ModelAssetCache&) = delete;
 
-        boneWeightsData.resize(mesh->mNumVertices * 4, 0.0f);
-        boneIDsData.resize(mesh->mNumVertices * 4, -1);
+    ~ModelAssetCache() {
+        assets.clear();
+    }
 
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-            vertices.push_back(mesh->mVertices[i].x);
-            vertices.push_back(mesh->mVertices[i].y);
-            vertices.push_back(mesh->mVertices[i].z);
-            vertices.push_back(mesh->mNormals[i].x);
-            vertices.push_back(mesh->mNormals[i].y);
-            vertices.push_back(mesh->mNormals[i].z);
-            if (mesh->mTextureCoords[0]) {
-                vertices.push_back(mesh->mTextureCoords[0][i].x);
-                vertices.push_back(mesh->mTextureCoords[0][i].y);
-            } else {
-                vertices.push_back(0.0f);
-                vertices.push_back(0.0f);
-            }
+    // Devuelve el modelo ya cargado o lo carga ahora. nullptr si el archivo no se pudo leer.
+    std::shared_ptr<ModelAsset> load(const std::string& path) {
+        auto it = assets.find(path);
+        if (it != assets.end()) {
+            return it->second;
         }
-
-        for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; j++) {
-                indices.push_back(face.mIndices[j]);
-            }
+        if (!skinnedShader.program.valid() && !skinnedShader.build(vertexShaderSource, fragmentShaderSource)) {
+            return nullptr;
         }
+        auto asset = std::make_shared<ModelAsset>(path, &skinnedShader, &textureManager, packVertices);
+        if (!asset->loaded) {
+            return nullptr;
+        }
+        assets[path] = asset;
+        return asset;
+    }
 
-        for (unsigned int i = 0; i < mesh->mNumBones; i++) {
-            aiBone* bone = mesh->mBones[i];
-            std::string boneName = bone->mName.C_Str();
-
-            int boneIndex = -1;
-            auto it = bones.find(boneName);
-            if (it != bones.end()) {
-                boneIndex = it->second.id;
+    // Libera los modelos que ya no usa ninguna instancia
+    void releaseUnused() {
+        for (auto it = assets.begin(); it != assets.end();) {
+            if (it->second.use_count() == 1) {
+                it = assets.erase(it);
             } else {
-                std::cerr << "Warning: Bone '" << boneName << "' not found in bone map during mesh processing. This bone will not influence vertices." << std::endl;
-                continue;
-            }
-
-            // CORRECTED LINE: Loop through bone->mNumWeights, not mWeights[j].mNumWeights
-            for (unsigned int j = 0; j < bone->mNumWeights; j++) {
-                aiVertexWeight weight = bone->mWeights[j];
-                unsigned int vertexID = weight.mVertexId;
-
-                for (int k = 0; k < 4; k++) {
-                    if (boneWeightsData[vertexID * 4 + k] == 0.0f) {
-                        boneWeightsData[vertexID * 4 + k] = weight.mWeight;
-                        boneIDsData[vertexID * 4 + k] = boneIndex;
-                        break;
-                    }
-                }
+                ++it;
             }
         }
-
-        Mesh m;
-        glGenVertexArrays(1, &m.VAO);
-        glGenBuffers(1, &m.VBO);
-        glGenBuffers(1, &m.EBO);
-
-        glBindVertexArray(m.VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(4);
-
-        glGenBuffers(1, &m.boneIDVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, m.boneIDVBO);
-        glBufferData(GL_ARRAY_BUFFER, boneIDsData.size() * sizeof(int), boneIDsData.data(), GL_STATIC_DRAW);
-        glVertexAttribIPointer(2, 4, GL_INT, 4 * sizeof(int), (void*)0);
-        glEnableVertexAttribArray(2);
-
-        glGenBuffers(1, &m.boneWeightVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, m.boneWeightVBO);
-        glBufferData(GL_ARRAY_BUFFER, boneWeightsData.size() * sizeof(float), boneWeightsData.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(3);
-
-        glBindVertexArray(0);
-
-        m.indexCount = indices.size();
-        
-        if (mesh->mMaterialIndex >= 0) {
-            aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-            m.textureID = loadMaterialTextures(material, aiTextureType_DIFFUSE);
-        } else {
-            m.textureID = 0;
-        }
-
-        meshes.push_back(m);
     }
 
-    GLuint loadMaterialTextures(aiMaterial *mat, aiTextureType type) {
-        aiString str;
-        mat->GetTexture(type, 0, &str);
-        std::string filename = std::string(str.C_Str());
-        std::string fullPath;
-
-        // Check if the filename from Assimp is already an absolute path
-        // (e.g., starts with C:/ or /home/)
-        if (filename.length() > 2 && filename[1] == ':' && (filename[0] >= 'A' && filename[0] <= 'Z')) { // Windows absolute path
-            fullPath = filename;
-        } else if (filename.length() > 0 && (filename[0] == '/' || filename.find(":/") != std::string::npos)) { // Linux/macOS absolute path or general absolute path
-            fullPath = filename;
-        } else {
-            // Otherwise, assume it's relative to the model's directory
-            fullPath = directory + "/" + filename;
-        }
-
-        GLuint textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char *data = stbi_load(fullPath.c_str(), &width, &height, &nrComponents, 0);
-        if (data) {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-            else {
-                std::cerr << "Unsupported texture format for: " << fullPath << std::endl;
-                stbi_image_free(data);
-                glDeleteTextures(1, &textureID);
-                return 0;
-            }
+    size_t size() const { return assets.size(); }
+};
 
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
+// Instancia de un personaje: solo su transformacion, su reloj de animacion y su paleta de huesos.
+// Crear muchas instancias del mismo ModelAsset no vuelve a leer el archivo ni a subir nada a la GPU.
+class AnimatedModel {
+private:
+    std::shared_ptr<const ModelAsset> asset;
+    AnimationState animationState; // Tiempo, cursores y paleta de huesos
+    std::shared_ptr<const Animation> clip; // Mantiene vivo el clip descomprimido que se reproduce
+    int clipIndex = -1;
+    std::vector<std::shared_ptr<const Animation>> layerClips; // Clips de la mezcla de locomocion
+    std::vector<int> layerClipIndices;
+    std::vector<float> locomotionSpeeds;
+    std::vector<float> locomotionTargets;
+    Aabb locomotionBounds; // Union de las cajas de los clips de la mezcla
+
+    // Skinning en CPU: por mesh, los vertices deformados (posicion y normal) y un VBO dinamico
+    // donde se suben. El VAO lee las UV del VBO estatico del mesh y usa su EBO.
+    struct CpuSkinnedMesh {
+        GLuint VAO = 0, VBO = 0;
+        std::vector<float> vertices; // vertexCount * kCpuSkinnedVertexFloats
+    };
+    std::vector<CpuSkinnedMesh> cpuMeshes;
+    bool cpuSkinning = false;
+    bool bakedPlayback = false;
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+public:
+    glm::vec3 position = glm::vec3(0.0f);
+    float rotationY = 0.0f;
+    glm::vec3 scale = glm::vec3(1.0f);
 
-            stbi_image_free(data);
-            std::cout << "Texture loaded: " << fullPath << std::endl;
-            textures_loaded.push_back(textureID);
-            return textureID;
-        } else {
-            std::cerr << "Texture failed to load at path: " << fullPath << std::endl;
-            // Optionally try to load a default texture if a specific one fails
-            // Or ensure a valid 0 is returned to indicate no texture.
-            glDeleteTextures(1, &textureID); // Clean up the texture ID
-            return 0; // Return 0 to indicate no texture loaded
-        }
+    explicit AnimatedModel(std::shared_ptr<const ModelAsset> modelAsset) : asset(std::move(modelAsset)) {
+        playClip(asset->defaultClip());
     }
 
-
-    void loadBones(aiMesh* mesh) {
-        for (unsigned int i = 0; i < mesh->mNumBones; i++) {
-            aiBone* bone = mesh->mBones[i];
-            std::string boneName = bone->mName.C_Str();
-
-            if (bones.find(boneName) == bones.end()) {
-                Bone b;
-                b.name = boneName;
-                b.offsetMatrix = convertMatrix(bone->mOffsetMatrix);
-                b.id = boneCounter++;
-                bones[boneName] = b;
-                // std::cout << "Loaded bone: " << b.name << " with ID: " << b.id << std::endl; // Too verbose
-            }
+    ~AnimatedModel() {
+        for (const CpuSkinnedMesh& mesh : cpuMeshes) {
+            glDeleteVertexArrays(1, &mesh.VAO);
+            glDeleteBuffers(1, &mesh.VBO);
         }
     }
 
-    void loadAnimations() {
-        for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
-            aiAnimation* anim = scene->mAnimations[i];
-            Animation animation;
-            animation.name = anim->mName.C_Str();
-            animation.duration = anim->mDuration;
-            animation.ticksPerSecond = anim->mTicksPerSecond ? anim->mTicksPerSecond : 25.0f;
+    AnimatedModel(const AnimatedModel&) = delete;
+    AnimatedModel& operator=(const AnimatedModel&) = delete;
 
-            for (unsigned int j = 0; j < anim->mNumChannels; j++) { 
-                aiNodeAnim* channel = anim->mChannels[j];
-                std::string boneName = channel->mNodeName.C_Str();
+    const ModelAsset& getAsset() const {
+        return *asset;
+    }
 
-                std::vector<aiVectorKey> posKeys;
-                for (unsigned int k = 0; k < channel->mNumPositionKeys; k++) {
-                    posKeys.push_back(channel->mPositionKeys[k]);
-                }
-                animation.positionKeyframes[boneName] = posKeys;
+    const SkinnedShader& getShader() const {
+        return *asset->shader;
+    }
 
-                std::vector<aiQuatKey> rotKeys;
-                for (unsigned int k = 0; k < channel->mNumRotationKeys; k++) {
-                    rotKeys.push_back(channel->mRotationKeys[k]);
-                }
-                animation.rotationKeyframes[boneName] = rotKeys;
+    glm::mat4 getModelMatrix() const {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, rotationY, glm::vec3(0.0f, 1.0f, 0.0f));
+        return glm::scale(model, scale);
+    }
 
-                std::vector<aiVectorKey> scaleKeys;
-                for (unsigned int k = 0; k < channel->mNumScalingKeys; k++) {
-                    scaleKeys.push_back(channel->mScalingKeys[k]);
-                }
-                animation.scalingKeyframes[boneName] = scaleKeys;
-            }
-            animations.push_back(animation);
-        }
+    // Caja en espacio del mundo que contiene al personaje en cualquier instante del clip actual
+    Aabb getWorldBounds() const {
+        return transformAabb(getModelMatrix(), locomotionSpeeds.empty() ? asset->boundsFor(clipIndex) : locomotionBounds);
     }
 
-    glm::mat4 getInterpolatedBoneTransform(const Animation& anim, const std::string& boneName, float animTime) {
-        glm::mat4 translationMatrix = glm::mat4(1.0f);
-        glm::mat4 rotationMatrix = glm::mat4(1.0f);
-        glm::mat4 scaleMatrix = glm::mat4(1.0f);
+    // Cambia de clip (-1 = pose de enlace) y vuelve a empezar. Descomprime el clip si no estaba en uso.
+    void playClip(int index) {
+        clip = asset->acquireClip(index);
+        clipIndex = clip ? index : -1;
+        layerClips.clear();
+        layerClipIndices.clear();
+        locomotionSpeeds.clear();
+        animationState.init(asset->skeleton, clip.get());
+    }
 
-        auto posItr = anim.positionKeyframes.find(boneName);
-        if (posItr != anim.positionKeyframes.end() && !posItr->second.empty()) {
-            const auto& positionKeys = posItr->second;
-            if (positionKeys.size() == 1) {
-                translationMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(positionKeys[0].mValue.x, positionKeys[0].mValue.y, positionKeys[0].mValue.z));
-            } else {
-                int frame = 0;
-                for (int i = 0; i < positionKeys.size() - 1; ++i) {
-                    if (animTime < positionKeys[i + 1].mTime) {
-                        frame = i;
-                        break;
-                    }
-                }
-                int nextFrame = (frame + 1) % positionKeys.size();
-                // Ensure nextFrame is not out of bounds or same as current frame
-                if (positionKeys[nextFrame].mTime == positionKeys[frame].mTime || positionKeys.size() < 2) {
-                    translationMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(positionKeys[frame].mValue.x, positionKeys[frame].mValue.y, positionKeys[frame].mValue.z));
-                } else {
-                    float t = (animTime - positionKeys[frame].mTime) / (positionKeys[nextFrame].mTime - positionKeys[frame].mTime);
-                    glm::vec3 startPos(positionKeys[frame].mValue.x, positionKeys[frame].mValue.y, positionKeys[frame].mValue.z);
-                    glm::vec3 endPos(positionKeys[nextFrame].mValue.x, positionKeys[nextFrame].mValue.y, positionKeys[nextFrame].mValue.z);
-                    translationMatrix = glm::translate(glm::mat4(1.0f), glm::mix(startPos, endPos, t));
-                }
-            }
+    // Mezcla de locomocion: clips[i] (-1 = pose de enlace) se ve natural a speeds[i] (en orden
+    // creciente). setMovementSpeed reparte el peso entre los dos vecinos y el cambio se funde en
+    // fadeSeconds. Los ciclos van sincronizados, asi que andar y correr pueden mezclarse a la vez.
+    void setLocomotion(const std::vector<int>& clips, const std::vector<float>& speeds, float fadeSeconds = 0.25f) {
+        layerClips.clear();
+        std::vector<const Animation*> animations;
+        for (int index : clips) {
+            layerClips.push_back(asset->acquireClip(index));
+            animations.push_back(layerClips.back().get());
         }
-
-        auto rotItr = anim.rotationKeyframes.find(boneName);
-        if (rotItr != anim.rotationKeyframes.end() && !rotItr->second.empty()) {
-            const auto& rotationKeys = rotItr->second;
-            if (rotationKeys.size() == 1) {
-                rotationMatrix = glm::mat4_cast(glm::quat(rotationKeys[0].mValue.w, rotationKeys[0].mValue.x, rotationKeys[0].mValue.y, rotationKeys[0].mValue.z));
-            } else {
-                int frame = 0;
-                for (int i = 0; i < rotationKeys.size() - 1; ++i) {
-                    if (animTime < rotationKeys[i + 1].mTime) {
-                        frame = i;
-                        break;
-                    }
-                }
-                int nextFrame = (frame + 1) % rotationKeys.size();
-                 if (rotationKeys[nextFrame].mTime == rotationKeys[frame].mTime || rotationKeys.size() < 2) {
-                    rotationMatrix = glm::mat4_cast(glm::quat(rotationKeys[frame].mValue.w, rotationKeys[frame].mValue.x, rotationKeys[frame].mValue.y, rotationKeys[frame].mValue.z));
-                } else {
-                    float t = (animTime - rotationKeys[frame].mTime) / (rotationKeys[nextFrame].mTime - rotationKeys[frame].mTime);
-                    glm::quat startRot(rotationKeys[frame].mValue.w, rotationKeys[frame].mValue.x, rotationKeys[frame].mValue.y, rotationKeys[frame].mValue.z);
-                    glm::quat endRot(rotationKeys[nextFrame].mValue.w, rotationKeys[nextFrame].mValue.x, rotationKeys[nextFrame].mValue.y, rotationKeys[nextFrame].mValue.z);
-                    rotationMatrix = glm::mat4_cast(glm::slerp(startRot, endRot, t));
-                }
-            }
+        layerClipIndices = clips;
+        locomotionSpeeds = speeds;
+        locomotionSpeeds.resize(clips.size(), locomotionSpeeds.empty() ? 0.0f : locomotionSpeeds.back());
+        locomotionTargets.assign(clips.size(), 0.0f);
+        animationState.initLayers(asset->skeleton, animations, 0);
+        animationState.fadeSeconds = fadeSeconds;
+        locomotionBounds = Aabb();
+        for (int index : clips) {
+            locomotionBounds.expand(asset->boundsFor(index));
         }
+        clip = nullptr;
+        clipIndex = -1;
+    }
 
-        auto scaleItr = anim.scalingKeyframes.find(boneName);
-        if (scaleItr != anim.scalingKeyframes.end() && !scaleItr->second.empty()) {
-            const auto& scaleKeys = scaleItr->second;
-            if (scaleKeys.size() == 1) {
-                scaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(scaleKeys[0].mValue.x, scaleKeys[0].mValue.y, scaleKeys[0].mValue.z));
-            } else {
-                int frame = 0;
-                for (int i = 0; i < scaleKeys.size() - 1; ++i) {
-                    if (animTime < scaleKeys[i + 1].mTime) {
-                        frame = i;
-                        break;
-                    }
-                }
-                int nextFrame = (frame + 1) % scaleKeys.size();
-                if (scaleKeys[nextFrame].mTime == scaleKeys[frame].mTime || scaleKeys.size() < 2) {
-                    scaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(scaleKeys[frame].mValue.x, scaleKeys[frame].mValue.y, scaleKeys[frame].mValue.z));
-                } else {
-                    float t = (animTime - scaleKeys[frame].mTime) / (scaleKeys[nextFrame].mTime - scaleKeys[frame].mTime);
-                    glm::vec3 startScale(scaleKeys[frame].mValue.x, scaleKeys[frame].mValue.y, scaleKeys[frame].mValue.z);
-                    glm::vec3 endScale(scaleKeys[nextFrame].mValue.x, scaleKeys[nextFrame].mValue.y, scaleKeys[nextFrame].mValue.z);
-                    scaleMatrix = glm::scale(glm::mat4(1.0f), glm::mix(startScale, endScale, t));
-                }
-            }
+    // Velocidad actual del personaje (unidades/s) para la mezcla de setLocomotion
+    void setMovementSpeed(float speed) {
+        if (locomotionSpeeds.empty()) {
+            return;
         }
-
-        return translationMatrix * rotationMatrix * scaleMatrix;
+        locomotionWeights(locomotionSpeeds.data(), locomotionSpeeds.size(), speed, locomotionTargets.data());
+        animationState.setLayerTargets(locomotionTargets.data());
     }
 
-    void calculateBoneTransformations(aiNode* node, glm::mat4 parentTransform) {
-        std::string nodeName = node->mName.C_Str();
-        glm::mat4 nodeTransformation = convertMatrix(node->mTransformation);
+    int currentClip() const {
+        return clipIndex;
+    }
 
-        if (bones.count(nodeName)) {
-            if (!animations.empty()) {
-                Animation& currentAnimation = animations[0]; // Assuming only one animation per model
-                glm::mat4 interpolatedLocalTransform = getInterpolatedBoneTransform(currentAnimation, nodeName, animationTime);
-                nodeTransformation = interpolatedLocalTransform;
-            }
-        }
+    // Avanza la animacion en el hilo que llama. Para muchos personajes a la vez, usar
+    // AnimationWorkerPool::updateAnimations con getAnimationState() de cada uno.
+    void updateAnimation(float deltaTime) {
+        animationState.update(deltaTime);
+    }
 
-        glm::mat4 globalTransformation = parentTransform * nodeTransformation;
+    AnimationState& getAnimationState() {
+        return animationState;
+    }
 
-        auto boneIt = bones.find(nodeName);
-        if (boneIt != bones.end()) {
-            Bone& bone = boneIt->second;
-            bone.finalTransformation = globalTransformation * bone.offsetMatrix;
-            
-            if (bone.id < boneTransforms.size()) {
-                boneTransforms[bone.id] = bone.finalTransformation;
-            } else {
-                std::cerr << "Error: bone.id " << bone.id << " out of bounds for boneTransforms (size " << boneTransforms.size() << ")" << std::endl;
-            }
+    // Deforma los vertices en la CPU y los dibuja desde un VBO dinamico en vez de hacerlo en el
+    // vertex shader. Util cuando el cuello de botella es la GPU, o si hacen falta los vertices
+    // deformados en la CPU (skinnedVertices). Los buffers se crean la primera vez que se activa.
+    void setCpuSkinning(bool enabled) {
+        cpuSkinning = enabled;
+        if (!enabled || !cpuMeshes.empty()) {
+            return;
         }
-
-        for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            calculateBoneTransformations(node->mChildren[i], globalTransformation);
+        cpuMeshes.resize(asset->meshes.size());
+        for (size_t i = 0; i < cpuMeshes.size(); ++i) {
+            const Mesh& mesh = asset->meshes[i];
+            CpuSkinnedMesh& cpu = cpuMeshes[i];
+            cpu.vertices.assign(mesh.vertexCount * kCpuSkinnedVertexFloats, 0.0f);
+            glGenVertexArrays(1, &cpu.VAO);
+            glGenBuffers(1, &cpu.VBO);
+            glBindVertexArray(cpu.VAO);
+
+            glBindBuffer(GL_ARRAY_BUFFER, cpu.VBO);
+            glBufferData(GL_ARRAY_BUFFER, cpu.vertices.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, kCpuSkinnedVertexFloats * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, kCpuSkinnedVertexFloats * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+
+            bindMeshTexCoords(mesh);
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+            glBindVertexArray(0);
         }
     }
 
-public:
-    GLuint shaderProgram;
-    glm::vec3 modelCenter;
+    bool usesCpuSkinning() const {
+        return cpuSkinning;
+    }
 
-    // Constructor
-    AnimatedModel(const std::string& path) : boneCounter(0) {
-        // Shader setup
-        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-        glCompileShader(vertexShader);
-
-        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-        glCompileShader(fragmentShader);
-
-        shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
-
-        GLint success;
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            GLchar infoLog[512];
-            glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-            std::cerr << "Vertex shader compilation failed: " << infoLog << std::endl;
-        }
-        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-        if (!success) {
-            GLchar infoLog[512];
-            glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-            std::cerr << "Shader program linking failed: " << infoLog << std::endl;
-        }
-
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-
-        // Get the directory of the model file
-        size_t lastSlash = path.find_last_of("/\\");
-        if (lastSlash != std::string::npos) {
-            directory = path.substr(0, lastSlash);
-        } else {
-            directory = "."; // If no path, assume current directory
-        }
-        
-        scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs |
-                                aiProcess_CalcTangentSpace | aiProcess_ValidateDataStructure);
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-            std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
-            return; 
-        }
+    // Dibuja el frame horneado mas cercano (ModelAsset::bakedPoses) en vez de la paleta propia: para
+    // multitudes lejanas, que asi no evaluan keys ni jerarquia. El reloj tiene que seguir avanzando
+    // (AnimationState::advance). No se combina con el skinning en CPU, que necesita la paleta.
+    void setBakedPlayback(bool enabled) {
+        bakedPlayback = enabled && !asset->bakedPoses().empty();
+    }
 
-        std::cout << "Model loaded successfully. Meshes: " << scene->mNumMeshes
-                    << ", Animations: " << scene->mNumAnimations << std::endl;
+    bool usesBakedPlayback() const {
+        return bakedPlayback && !cpuSkinning;
+    }
 
-        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-            loadBones(scene->mMeshes[i]);
+    // Primer texel del frame horneado que toca ahora. En una mezcla se usa la capa con mas peso.
+    size_t bakedPoseTexel() const {
+        const BakedPoses& poses = asset->bakedPoses();
+        if (!animationState.layers.empty()) {
+            size_t dominant = 0;
+            for (size_t i = 1; i < animationState.layers.size(); ++i) {
+                if (animationState.layers[i].weight > animationState.layers[dominant].weight) {
+                    dominant = i;
+                }
+            }
+            return poses.frameTexel(layerClipIndices[dominant], animationState.phase);
         }
-        
-        boneTransforms.resize(bones.size(), glm::mat4(1.0f));
-        std::cout << "Resized boneTransforms to " << boneTransforms.size() << " elements." << std::endl;
-
-        processNode(scene->mRootNode, scene);
-        loadAnimations();
-
-        globalInverseTransform = glm::inverse(convertMatrix(scene->mRootNode->mTransformation));
-
-        modelCenter = calculateModelCenter(scene);
-        std::cout << "Model center: (" << modelCenter.x << ", " << modelCenter.y << ", " << modelCenter.z << ")" << std::endl;
+        const Animation* animation = animationState.animation;
+        float phase = animation && animation->duration > 0.0f ? animationState.animationTime / animation->duration : 0.0f;
+        return poses.frameTexel(clipIndex, phase);
     }
 
-    // Destructor to free OpenGL resources
-    ~AnimatedModel() {
-        glDeleteProgram(shaderProgram);
-        for (const auto& mesh : meshes) {
-            glDeleteVertexArrays(1, &mesh.VAO);
-            glDeleteBuffers(1, &mesh.VBO);
-            glDeleteBuffers(1, &mesh.EBO);
-            glDeleteBuffers(1, &mesh.boneIDVBO);
-            glDeleteBuffers(1, &mesh.boneWeightVBO);
-            if (mesh.textureID != 0) {
-                glDeleteTextures(1, &mesh.textureID);
-            }
+    // Un trabajo por mesh para skinMeshes, que reparte los de todos los personajes entre los hilos.
+    // La paleta debe estar actualizada (updateAnimation) y no cambiar hasta que terminen.
+    void appendSkinningJobs(std::vector<SkinningJob>& jobs) {
+        const std::vector<glm::mat4>& palette = animationState.boneTransforms;
+        for (size_t i = 0; i < cpuMeshes.size(); ++i) {
+            SkinningJob job;
+            job.palette = palette.data();
+            job.boneCount = palette.size();
+            job.source = asset->skinningSource(i);
+            job.out = cpuMeshes[i].vertices.data();
+            jobs.push_back(job);
         }
     }
 
-    void updateAnimation(float deltaTime) {
-        if (animations.empty()) {
-            for (auto const& [name, bone] : bones) {
-                if (bone.id < boneTransforms.size()) {
-                    boneTransforms[bone.id] = bone.offsetMatrix;
-                }
-            }
-            return;
+    // Sube los vertices deformados (en el hilo del contexto GL). El buffer se huerfana antes de
+    // escribirlo para no esperar a que la GPU termine de dibujar el frame anterior.
+    void uploadSkinnedVertices() const {
+        for (const CpuSkinnedMesh& cpu : cpuMeshes) {
+            size_t bytes = cpu.vertices.size() * sizeof(float);
+            glBindBuffer(GL_ARRAY_BUFFER, cpu.VBO);
+            glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, cpu.vertices.data());
         }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
-        Animation& currentAnimation = animations[0];
-        animationTime += deltaTime * currentAnimation.ticksPerSecond;
-        animationTime = fmod(animationTime, (float)currentAnimation.duration);
+    // Posiciones y normales deformadas del mesh i en espacio del modelo, del ultimo skinMeshes
+    // (vacio si no se usa el skinning en CPU)
+    const std::vector<float>& skinnedVertices(size_t i) const {
+        static const std::vector<float> empty;
+        return i < cpuMeshes.size() ? cpuMeshes[i].vertices : empty;
+    }
 
-        calculateBoneTransformations(scene->mRootNode, glm::mat4(1.0f));
+    const std::vector<glm::mat4>& getBoneTransforms() const {
+        return animationState.boneTransforms;
     }
 
-    void Draw() {
-        // Uniforms for bones are set here, before drawing any mesh
-        for (size_t i = 0; i < boneTransforms.size(); ++i) {
-            std::string uniformName = "bones[" + std::to_string(i) + "]";
-            GLint uniformLoc = glGetUniformLocation(shaderProgram, uniformName.c_str());
-            // No need for a warning if uniformLoc is -1, as unused bones might be optimized out.
-            if (uniformLoc != -1) {
-                glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(boneTransforms[i]));
-            }
-        }
+    // VAO con el que se dibuja el mesh i: el del modelo compartido, o el propio si el skinning es en CPU
+    GLuint vertexArray(size_t i) const {
+        return cpuSkinning ? cpuMeshes[i].VAO : asset->meshes[i].VAO;
+    }
+};
 
-        for (const Mesh& mesh : meshes) {
-            if (mesh.textureID != 0) {
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, mesh.textureID);
-                glUniform1i(glGetUniformLocation(shaderProgram, "ourTexture"), 0); 
-            } else {
-                // If no texture, bind a default white texture or handle as needed
-                // For now, if no texture, it might appear black or default
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, 0); // Unbind any texture
-                // You might want to set a default color in the shader here if no texture is found
+// Dibuja los personajes visibles agrupados por modelo: sus paletas van juntas en un BonePaletteBuffer
+// y cada mesh de un ModelAsset se dibuja una sola vez para todas sus instancias (glDrawElementsInstanced).
+// Los personajes con skinning en CPU tienen su propio VBO, asi que van de uno en uno. Los que
+// reproducen poses horneadas van en su propio lote, con los frames de todos los modelos en BakedPoseAtlas.
+class SkinnedCharacterRenderer {
+public:
+    // Rellena las paletas del frame, las sube y agrega los dibujos a la cola. Los punteros a
+    // batches que guardan los DrawItem valen hasta la siguiente llamada.
+    void enqueue(const std::vector<const AnimatedModel*>& visible, const glm::vec3& cameraPos, RenderQueue& queue) {
+        palettes.clear();
+        batches.clear();
+        batches.reserve(visible.size()); // Nunca hay mas grupos que personajes: no se realoja
+        order.assign(visible.begin(), visible.end());
+        std::stable_sort(order.begin(), order.end(), [](const AnimatedModel* a, const AnimatedModel* b) {
+            if (&a->getAsset() != &b->getAsset()) {
+                return &a->getAsset() < &b->getAsset();
+            }
+            if (a->usesCpuSkinning() != b->usesCpuSkinning()) {
+                return a->usesCpuSkinning() < b->usesCpuSkinning();
+            }
+            return a->usesBakedPlayback() < b->usesBakedPlayback();
+        });
+
+        instances = bakedInstances = 0;
+        for (size_t i = 0; i < order.size();) {
+            const AnimatedModel& first = *order[i];
+            Batch batch;
+            batch.shader = &first.getShader();
+            batch.preskinned = first.usesCpuSkinning();
+            batch.baked = first.usesBakedPlayback();
+            batch.packed = first.getAsset().usesPackedVertices();
+            batch.vertexBounds = first.getAsset().vertexBounds();
+            batch.paletteBase = static_cast<GLint>(palettes.texelCount());
+            batch.boneCount = batch.preskinned ? 0 : static_cast<GLint>(first.getAsset().skeleton.boneCount());
+            const size_t poseBase = batch.baked ? poseAtlas.base(&first.getAsset(), first.getAsset().bakedPoses()) : 0;
+
+            // Las instancias que ya no caben en el texture buffer se quedan fuera del dibujo
+            const size_t instanceTexels = batch.baked ? kBakedPoseInstanceTexels : bonePaletteTexels(static_cast<size_t>(batch.boneCount));
+            size_t end = i, count = 0;
+            float nearest = std::numeric_limits<float>::max();
+            do {
+                const AnimatedModel& character = *order[end];
+                ++end;
+                if (!palettes.fits(instanceTexels)) {
+                    continue;
+                }
+                if (batch.baked) {
+                    palettes.appendBaked(character.getModelMatrix(), poseBase + character.bakedPoseTexel());
+                } else {
+                    const std::vector<glm::mat4>& palette = character.getBoneTransforms();
+                    palettes.append(character.getModelMatrix(), palette.data(), static_cast<size_t>(batch.boneCount));
+                }
+                nearest = std::min(nearest, glm::length(character.position - cameraPos));
+                ++count;
+            } while (!batch.preskinned && end < order.size() && &order[end]->getAsset() == &first.getAsset() &&
+                     !order[end]->usesCpuSkinning() && order[end]->usesBakedPlayback() == batch.baked);
+            if (count == 0) {
+                i = end;
+                continue;
             }
 
-            glBindVertexArray(mesh.VAO);
-            glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-
-            if (mesh.textureID != 0) {
-                glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture after use
+            batches.push_back(batch);
+            const ModelAsset& asset = first.getAsset();
+            for (size_t m = 0; m < asset.meshes.size(); ++m) {
+                DrawItem item;
+                item.program = batch.shader->program.id();
+                item.vao = first.vertexArray(m);
+                item.textures[0] = asset.meshes[m].textureID; // 0 si el mesh no tiene textura
+                item.textureCount = 1;
+                item.setup = &SkinnedCharacterRenderer::applyBatchUniforms;
+                item.context = &batches.back();
+                item.kind = DrawKind::ElementsInstanced;
+                item.count = static_cast<GLsizei>(asset.meshes[m].indexCount);
+                item.indexType = asset.meshes[m].indexType;
+                item.instanceCount = static_cast<GLsizei>(count);
+                queue.add(item, nearest);
+            }
+            instances += count;
+            if (batch.baked) {
+                bakedInstances += count;
             }
+            i = end;
         }
+        palettes.upload();
+        poseAtlas.upload();
     }
 
-    glm::vec3 calculateModelCenter(const aiScene* scene) {
-        glm::vec3 minBounds(std::numeric_limits<float>::max()), maxBounds(std::numeric_limits<float>::lowest());
-        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-            aiMesh* mesh = scene->mMeshes[i];
-            for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-                aiVector3D pos = mesh->mVertices[j];
-                minBounds.x = std::min(minBounds.x, pos.x);
-                minBounds.y = std::min(minBounds.y, pos.y);
-                minBounds.z = std::min(minBounds.z, pos.z);
-                maxBounds.x = std::max(maxBounds.x, pos.x);
-                maxBounds.y = std::max(maxBounds.y, pos.y);
-                maxBounds.z = std::max(maxBounds.z, pos.z);
-            }
-        }
-        return (minBounds + maxBounds) * 0.5f;
+    // Enlazar en kBonePaletteTextureUnit antes de RenderQueue::submit
+    GLuint paletteTexture() const { return palettes.texture(); }
+    // Enlazar en kBakedPoseTextureUnit
+    GLuint bakedPoseTexture() const { return poseAtlas.texture(); }
+    // Si los frames horneados de asset caben en el atlas (si no, sus personajes no pueden usarlos)
+    bool bakedPosesFit(const ModelAsset& asset) { return poseAtlas.fits(&asset, asset.bakedPoses()); }
+
+    size_t instanceCount() const { return instances; }
+    size_t bakedInstanceCount() const { return bakedInstances; }
+    size_t bakedPoseBytes() const { return poseAtlas.bytes(); }
+    size_t batchCount() const { return batches.size(); }
+    size_t paletteBytes() const { return palettes.bytes(); }
+
+    // Libera el texture buffer (con el contexto GL todavia vivo)
+    void release() {
+        palettes.release();
+        poseAtlas.release();
+    }
+
+private:
+    struct Batch {
+        const SkinnedShader* shader = nullptr;
+        GLint paletteBase = 0;
+        GLint boneCount = 0;
+        bool preskinned = false;
+        bool baked = false;
+        bool packed = false;
+        PackedVertexBounds vertexBounds;
+    };
+
+    BonePaletteBuffer palettes;
+    BakedPoseAtlas poseAtlas;
+    std::vector<Batch> batches;
+    std::vector<const AnimatedModel*> order;
+    size_t instances = 0, bakedInstances = 0;
+
+    static void applyBatchUniforms(const void* context) {
+        const Batch& batch = *static_cast<const Batch*>(context);
+        setUniform(batch.shader->paletteBase, batch.paletteBase);
+        setUniform(batch.shader->boneCount, batch.boneCount);
+        setUniform(batch.shader->preskinned, batch.preskinned);
+        setUniform(batch.shader->bakedPoses, batch.baked);
+        setUniform(batch.shader->packedVertices, batch.packed);
+        setUniform(batch.shader->positionMin, batch.vertexBounds.min);
+        setUniform(batch.shader->positionExtent, batch.vertexBounds.extent);
     }
 };
@@ -0,0 +1,132 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Paletas de huesos horneadas, sin llamadas a OpenGL: cada clip se muestrea a una frecuencia fija
+// y se guarda la paleta completa de cada frame, con el mismo layout que BonePaletteBuffer (3 filas
+// de cada matriz por hueso). Un personaje lejano no evalua keys ni jerarquia: solo elige el frame
+// segun su fase y el vertex shader lee la paleta de ese frame.
+//
+// Se guardan paletas y no posiciones ya deformadas (vertex animation textures): un frame ocupa
+// 48 bytes por hueso en vez de 12 por vertice, y los mismos frames sirven para todos los meshes.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Animation.hpp"
+#include "AnimationCompression.hpp"
+
+constexpr float kBakedPoseFramesPerSecond = 30.0f;
+
+// Frames de un clip dentro de BakedPoses
+struct BakedPoseRange {
+    uint32_t firstFrame = 0;
+    uint32_t frameCount = 0;
+};
+
+// Tres filas de m (la cuarta siempre es 0 0 0 1), como las lee paletteMatrix() en el shader
+inline void appendPaletteRows(const glm::mat4& m, std::vector<glm::vec4>& texels) {
+    for (int r = 0; r < 3; ++r) {
+        texels.push_back(glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]));
+    }
+}
+
+// Todos los clips de un modelo. El frame 0 es la pose de enlace (clip -1).
+struct BakedPoses {
+    uint32_t boneCount = 0;
+    float framesPerSecond = kBakedPoseFramesPerSecond;
+    std::vector<BakedPoseRange> clips; // Mismo orden que los clips del modelo
+    std::vector<glm::vec4> texels;     // 3 * boneCount por frame
+
+    bool empty() const { return texels.empty(); }
+    size_t texelsPerFrame() const { return 3 * static_cast<size_t>(boneCount); }
+    size_t frameCount() const { return boneCount ? texels.size() / texelsPerFrame() : 0; }
+    size_t bytes() const { return texels.size() * sizeof(glm::vec4); }
+
+    // Primer texel del frame mas cercano a phase ([0, 1) del ciclo) del clip
+    uint32_t frameTexel(int clip, float phase) const {
+        if (clip < 0 || static_cast<size_t>(clip) >= clips.size()) {
+            return 0;
+        }
+        const BakedPoseRange& range = clips[clip];
+        uint32_t frame = static_cast<uint32_t>(std::floor(phase * range.frameCount + 0.5f)) % std::max(1u, range.frameCount);
+        return static_cast<uint32_t>((range.firstFrame + frame) * texelsPerFrame());
+    }
+};
+
+// Empieza un juego de poses con la pose de enlace como frame 0
+inline void beginBakedPoses(const Skeleton& skeleton, float framesPerSecond, BakedPoses& out) {
+    out = BakedPoses();
+    out.boneCount = static_cast<uint32_t>(skeleton.boneCount());
+    out.framesPerSecond = framesPerSecond;
+    std::vector<glm::mat4> globalTransforms, boneTransforms;
+    calculateBoneTransformations(skeleton, nullptr, 0.0f, nullptr, globalTransforms, boneTransforms);
+    for (const glm::mat4& bone : boneTransforms) {
+        appendPaletteRows(bone, out.texels);
+    }
+}
+
+// Agrega los frames de anim: uno cada 1/framesPerSecond segundos, sin repetir el final del ciclo
+// (el frame siguiente al ultimo es el primero)
+inline void appendBakedPoseClip(const Skeleton& skeleton, const Animation& anim, BakedPoses& out) {
+    const float ticksPerSecond = anim.ticksPerSecond > 0.0f ? anim.ticksPerSecond : 25.0f;
+    const float seconds = anim.duration / ticksPerSecond;
+    BakedPoseRange range;
+    range.firstFrame = static_cast<uint32_t>(out.frameCount());
+    range.frameCount = std::max(1u, static_cast<uint32_t>(std::lround(seconds * out.framesPerSecond)));
+
+    std::vector<glm::mat4> globalTransforms, boneTransforms;
+    AnimationCursor cursor;
+    cursor.reset(anim.tracks.size());
+    out.texels.reserve(out.texels.size() + range.frameCount * out.texelsPerFrame());
+    for (uint32_t f = 0; f < range.frameCount; ++f) {
+        float time = anim.duration * f / range.frameCount;
+        calculateBoneTransformations(skeleton, &anim, time, &cursor, globalTransforms, boneTransforms);
+        for (const glm::mat4& bone : boneTransforms) {
+            appendPaletteRows(bone, out.texels);
+        }
+    }
+    out.clips.push_back(range);
+}
+
+inline BakedPoses bakePoses(const Skeleton& skeleton, const std::vector<CompressedAnimation>& clips,
+                            float framesPerSecond = kBakedPoseFramesPerSecond) {
+    BakedPoses poses;
+    beginBakedPoses(skeleton, framesPerSecond, poses);
+    for (const CompressedAnimation& clip : clips) {
+        appendBakedPoseClip(skeleton, decompressAnimation(clip), poses);
+    }
+    return poses;
+}
+
+// Las poses leidas de un archivo corresponden al esqueleto y a clipCount clips
+inline bool bakedPosesConsistent(const BakedPoses& poses, size_t boneCount, size_t clipCount) {
+    if (poses.boneCount != boneCount || poses.clips.size() != clipCount || poses.framesPerSecond <= 0.0f ||
+        poses.texels.size() % std::max<size_t>(1, poses.texelsPerFrame()) != 0) {
+        return false;
+    }
+    size_t frames = poses.frameCount();
+    for (const BakedPoseRange& range : poses.clips) {
+        if (range.frameCount == 0 || range.firstFrame + static_cast<size_t>(range.frameCount) > frames) {
+            return false;
+        }
+    }
+    return boneCount == 0 || frames >= 1;
+}
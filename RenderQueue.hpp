@@ -0,0 +1,290 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cola de dibujo ordenada y cache del estado de OpenGL.
+// Cada frame se recogen los DrawItem de todo lo visible, se ordenan por una clave de 64 bits
+// (transparencia, programa, juego de texturas, VAO, profundidad) y se envian a traves de
+// GlStateCache, que no repite un glUseProgram, glBindVertexArray, glBindTexture, cambio de
+// blending o de reinicio de primitiva que ya esta en efecto. Los contadores de RenderStateStats miden lo que se ahorra.
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+constexpr int kRenderMaxTextureUnits = 6;
+
+struct RenderStateStats {
+    uint32_t programChanges = 0, programSkipped = 0;
+    uint32_t vaoChanges = 0, vaoSkipped = 0;
+    uint32_t textureChanges = 0, textureSkipped = 0;
+    uint32_t blendChanges = 0, blendSkipped = 0;
+    uint32_t restartChanges = 0, restartSkipped = 0;
+    uint32_t uniformSetups = 0, uniformSetupsSkipped = 0;
+    uint32_t drawCalls = 0;
+
+    uint32_t changes() const { return programChanges + vaoChanges + textureChanges + blendChanges + restartChanges + uniformSetups; }
+    uint32_t avoided() const { return programSkipped + vaoSkipped + textureSkipped + blendSkipped + restartSkipped + uniformSetupsSkipped; }
+};
+
+// Lo ultimo que se envio a OpenGL. Todo el codigo del bucle principal debe cambiar estado a traves
+// de esta clase; si algo lo cambia por fuera (cargas, inicializacion), llamar a invalidate().
+class GlStateCache {
+public:
+    RenderStateStats stats;
+
+    GlStateCache() { invalidate(); }
+
+    // Olvida el estado conocido: el siguiente cambio de cada tipo se envia siempre
+    void invalidate() {
+        program = vao = activeUnit = kUnknown;
+        std::fill(std::begin(textures), std::end(textures), kUnknown);
+        blend = -1;
+        blendSrc = blendDst = kUnknown;
+        restart = -1;
+        restartIndex = -1;
+    }
+
+    void resetStats() { stats = RenderStateStats(); }
+
+    void useProgram(GLuint id) {
+        if (program == id) {
+            ++stats.programSkipped;
+            return;
+        }
+        glUseProgram(id);
+        program = id;
+        ++stats.programChanges;
+    }
+
+    void bindVertexArray(GLuint id) {
+        if (vao == id) {
+            ++stats.vaoSkipped;
+            return;
+        }
+        glBindVertexArray(id);
+        vao = id;
+        ++stats.vaoChanges;
+    }
+
+    void bindTexture2D(GLuint unit, GLuint texture) {
+        if (unit >= kTrackedUnits) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            ++stats.textureChanges;
+            return;
+        }
+        if (textures[unit] == texture) {
+            ++stats.textureSkipped;
+            return;
+        }
+        if (activeUnit != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        textures[unit] = texture;
+        ++stats.textureChanges;
+    }
+
+    // Texture buffer (GL_TEXTURE_BUFFER) en una unidad que no usan los materiales, p. ej. las paletas
+    // de huesos. No se registra en textures[], que solo sigue GL_TEXTURE_2D.
+    void bindTextureBuffer(GLuint unit, GLuint texture) {
+        if (activeUnit != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        ++stats.textureChanges;
+    }
+
+    void setBlend(bool enabled, GLenum src = GL_SRC_ALPHA, GLenum dst = GL_ONE_MINUS_SRC_ALPHA) {
+        bool changed = false;
+        if (blend != (enabled ? 1 : 0)) {
+            if (enabled) {
+                glEnable(GL_BLEND);
+            } else {
+                glDisable(GL_BLEND);
+            }
+            blend = enabled ? 1 : 0;
+            changed = true;
+        }
+        if (enabled && (blendSrc != src || blendDst != dst)) {
+            glBlendFunc(src, dst);
+            blendSrc = src;
+            blendDst = dst;
+            changed = true;
+        }
+        if (changed) {
+            ++stats.blendChanges;
+        } else {
+            ++stats.blendSkipped;
+        }
+    }
+
+    // Reinicio de primitiva con el indice maximo del tipo (el comportamiento fijo de GL 4.3, que en
+    // 3.3 hay que pedir con glPrimitiveRestartIndex). Solo activo en los dibujos que lo piden: con
+    // indices de 32 bits un 0xffff seria un vertice normal de otro mesh.
+    void setPrimitiveRestart(bool enabled, GLenum indexType = GL_UNSIGNED_SHORT) {
+        bool changed = false;
+        if (restart != (enabled ? 1 : 0)) {
+            if (enabled) {
+                glEnable(GL_PRIMITIVE_RESTART);
+            } else {
+                glDisable(GL_PRIMITIVE_RESTART);
+            }
+            restart = enabled ? 1 : 0;
+            changed = true;
+        }
+        GLuint index = indexType == GL_UNSIGNED_BYTE ? 0xffu : indexType == GL_UNSIGNED_SHORT ? 0xffffu : 0xffffffffu;
+        if (enabled && restartIndex != static_cast<int64_t>(index)) {
+            glPrimitiveRestartIndex(index);
+            restartIndex = index;
+            changed = true;
+        }
+        if (changed) {
+            ++stats.restartChanges;
+        } else {
+            ++stats.restartSkipped;
+        }
+    }
+
+private:
+    static constexpr GLuint kUnknown = 0xffffffffu;
+    static constexpr GLuint kTrackedUnits = 16;
+
+    GLuint program, vao, activeUnit;
+    GLuint textures[kTrackedUnits];
+    int blend; // -1 desconocido
+    GLenum blendSrc, blendDst;
+    int restart; // -1 desconocido
+    int64_t restartIndex; // -1 desconocido
+};
+
+enum class DrawKind { Elements, ElementsInstanced, ArraysInstanced };
+
+// Todo lo necesario para una llamada de dibujo, sin tocar OpenGL hasta RenderQueue::submit
+struct DrawItem {
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint textures[kRenderMaxTextureUnits] = {}; // Unidades 0..textureCount-1 (GL_TEXTURE_2D)
+    int textureCount = 0;
+    bool transparent = false;
+
+    // Uniforms propios del objeto (modelo, paleta...). setup(context) no se vuelve a llamar si el
+    // item anterior tenia el mismo programa, setup y context (p. ej. varios meshes del mismo personaje).
+    void (*setup)(const void* context) = nullptr;
+    const void* context = nullptr;
+
+    DrawKind kind = DrawKind::Elements;
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    bool primitiveRestart = false; // El indice maximo de indexType corta la tira (GlStateCache::setPrimitiveRestart)
+    size_t indexOffset = 0;  // En bytes
+    GLint baseVertex = 0;
+    GLint first = 0;
+    GLsizei instanceCount = 1;
+};
+
+// Clave de orden. Opacos primero, agrupados por programa, texturas y VAO, y de cerca a lejos;
+// los transparentes despues, de lejos a cerca. Los ids se truncan: una colision solo cambia el orden.
+//   opaco:        0 | programa (8) | texturas (16) | VAO (16) | profundidad (23)
+//   transparente: 1 | profundidad invertida (23) | programa (8) | texturas (16) | VAO (16)
+inline uint64_t makeDrawSortKey(bool transparent, GLuint program, uint32_t textureSet, GLuint vao, float depth01) {
+    uint64_t depth = static_cast<uint64_t>(std::min(std::max(depth01, 0.0f), 1.0f) * ((1u << 23) - 1));
+    uint64_t material = (static_cast<uint64_t>(program & 0xffu) << 32) | (static_cast<uint64_t>(textureSet & 0xffffu) << 16) | (vao & 0xffffu);
+    if (!transparent) {
+        return (material << 23) | depth;
+    }
+    return (1ull << 63) | ((((1u << 23) - 1) - depth) << 40) | material;
+}
+
+class RenderQueue {
+public:
+    float farPlane = 500.0f; // Profundidad que se mapea al final del rango de la clave
+
+    void clear() {
+        items.clear();
+        keys.clear();
+    }
+
+    // viewDepth: distancia a la camara (para el orden dentro del mismo material y entre transparentes)
+    void add(const DrawItem& item, float viewDepth) {
+        uint32_t textureSet = 2166136261u; // FNV-1a de los ids de textura
+        for (int i = 0; i < item.textureCount; ++i) {
+            textureSet = (textureSet ^ item.textures[i]) * 16777619u;
+        }
+        uint64_t key = makeDrawSortKey(item.transparent, item.program, textureSet ^ (textureSet >> 16), item.vao, viewDepth / farPlane);
+        keys.emplace_back(key, static_cast<uint32_t>(items.size()));
+        items.push_back(item);
+    }
+
+    void sort() {
+        std::stable_sort(keys.begin(), keys.end(),
+                         [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+    }
+
+    // Envia los items en el orden de sort(). No deshace nada al terminar: el estado queda en la cache.
+    void submit(GlStateCache& state) const {
+        const DrawItem* previous = nullptr;
+        for (const auto& entry : keys) {
+            const DrawItem& item = items[entry.second];
+            state.useProgram(item.program);
+            for (int unit = 0; unit < item.textureCount; ++unit) {
+                state.bindTexture2D(unit, item.textures[unit]);
+            }
+            state.bindVertexArray(item.vao);
+            state.setBlend(item.transparent);
+            state.setPrimitiveRestart(item.primitiveRestart, item.indexType);
+
+            if (item.setup) {
+                if (previous && previous->program == item.program && previous->setup == item.setup && previous->context == item.context) {
+                    ++state.stats.uniformSetupsSkipped;
+                } else {
+                    item.setup(item.context);
+                    ++state.stats.uniformSetups;
+                }
+            }
+
+            if (item.kind == DrawKind::Elements) {
+                if (item.baseVertex != 0) {
+                    glDrawElementsBaseVertex(item.mode, item.count, item.indexType, (void*)item.indexOffset, item.baseVertex);
+                } else {
+                    glDrawElements(item.mode, item.count, item.indexType, (void*)item.indexOffset);
+                }
+            } else if (item.kind == DrawKind::ElementsInstanced) {
+                glDrawElementsInstanced(item.mode, item.count, item.indexType, (void*)item.indexOffset, item.instanceCount);
+            } else {
+                glDrawArraysInstanced(item.mode, item.first, item.count, item.instanceCount);
+            }
+            ++state.stats.drawCalls;
+            previous = &item;
+        }
+    }
+
+    size_t size() const { return items.size(); }
+    const std::vector<DrawItem>& drawItems() const { return items; } // En el orden de add()
+
+private:
+    std::vector<DrawItem> items;
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+};
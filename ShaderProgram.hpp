@@ -0,0 +1,178 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Programa de shaders con reflexion de uniforms.
+// Al enlazar se leen todos los uniforms activos (nombre, tipo, tamaño y location) una sola vez;
+// despues el codigo de dibujo guarda los Uniform que necesita y nunca llama a glGetUniformLocation
+// en el bucle principal. Los samplers se asignan a su unidad de textura una sola vez al cargar.
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Uniform resuelto. location == -1 si el compilador lo elimino: los setUniform no hacen nada.
+// size > 1 para arreglos (numero de elementos activos).
+struct Uniform {
+    GLint location = -1;
+    GLint size = 0;
+    GLenum type = 0;
+
+    explicit operator bool() const { return location >= 0; }
+};
+
+inline bool isSamplerType(GLenum type) {
+    switch (type) {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_SHADOW:
+        case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ~ShaderProgram() { release(); }
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Compila, enlaza y refleja los uniforms. label solo se usa en los mensajes de error.
+    bool build(const char* vertexSource, const char* fragmentSource, const std::string& label) {
+        release();
+        GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource, label + " (vertex)");
+        GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource, label + " (fragment)");
+
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            GLchar infoLog[1024];
+            glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+            std::cerr << "ERROR::SHADER_PROGRAM_LINKING (" << label << ")\n" << infoLog << std::endl;
+            release();
+            return false;
+        }
+        reflect();
+        return true;
+    }
+
+    GLuint id() const { return program; }
+    bool valid() const { return program != 0; }
+    void use() const { glUseProgram(program); }
+
+    // Uniform por nombre (los arreglos sin "[0]"). Para usar al preparar el dibujo, no en cada frame.
+    Uniform uniform(const std::string& name) const {
+        auto it = uniforms.find(name);
+        return it != uniforms.end() ? it->second : Uniform();
+    }
+
+    // Fija la unidad de textura de un sampler. El valor queda en el programa: basta hacerlo una vez.
+    void setSampler(const std::string& name, GLint unit) const {
+        Uniform u = uniform(name);
+        if (u && isSamplerType(u.type)) {
+            glUseProgram(program);
+            glUniform1i(u.location, unit);
+        }
+    }
+
+    const std::map<std::string, Uniform>& activeUniforms() const { return uniforms; }
+    const std::vector<std::string>& samplers() const { return samplerNames; }
+
+    // Borra el programa. Llamar antes de destruir el contexto si el objeto vive mas que el.
+    void release() {
+        if (program != 0) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+        uniforms.clear();
+        samplerNames.clear();
+    }
+
+private:
+    GLuint program = 0;
+    std::map<std::string, Uniform> uniforms;
+    std::vector<std::string> samplerNames;
+
+    static GLuint compile(GLenum type, const char* source, const std::string& label) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            GLchar infoLog[1024];
+            glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+            std::cerr << "ERROR::SHADER_COMPILATION (" << label << ")\n" << infoLog << std::endl;
+        }
+        return shader;
+    }
+
+    void reflect() {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            Uniform u;
+            glGetActiveUniform(program, static_cast<GLuint>(i), maxLength, &length, &u.size, &u.type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            // Los arreglos se reportan como "bones[0]": se guardan con el nombre base
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+                name.resize(name.size() - 3);
+            }
+            u.location = glGetUniformLocation(program, name.c_str());
+            uniforms[name] = u;
+            if (isSamplerType(u.type)) {
+                samplerNames.push_back(name);
+            }
+        }
+    }
+};
+
+// --- Asignacion de uniforms a traves de los Uniform ya resueltos (el programa debe estar activo) ---
+inline void setUniform(const Uniform& u, float value) { if (u) glUniform1f(u.location, value); }
+inline void setUniform(const Uniform& u, int value) { if (u) glUniform1i(u.location, value); }
+inline void setUniform(const Uniform& u, bool value) { if (u) glUniform1i(u.location, value ? 1 : 0); }
+inline void setUniform(const Uniform& u, const glm::vec2& value) { if (u) glUniform2fv(u.location, 1, glm::value_ptr(value)); }
+inline void setUniform(const Uniform& u, const glm::vec3& value) { if (u) glUniform3fv(u.location, 1, glm::value_ptr(value)); }
+inline void setUniform(const Uniform& u, const glm::mat3& value) { if (u) glUniformMatrix3fv(u.location, 1, GL_FALSE, glm::value_ptr(value)); }
+inline void setUniform(const Uniform& u, const glm::mat4& value) { if (u) glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(value)); }
+
+// Sube count matrices consecutivas con una sola llamada (recorta al tamaño del arreglo en el shader)
+inline void setUniformArray(const Uniform& u, const glm::mat4* values, size_t count) {
+    if (u && count > 0) {
+        GLsizei n = static_cast<GLsizei>(std::min(count, static_cast<size_t>(u.size)));
+        glUniformMatrix4fv(u.location, n, GL_FALSE, glm::value_ptr(values[0]));
+    }
+}
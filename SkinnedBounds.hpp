@@ -0,0 +1,102 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cajas conservadoras de un mesh con skinning, una por clip, calculadas al cargar (sin OpenGL).
+//
+// Un vertice deformado es sum(w_i * bones[i] * v). Si v esta dentro de la caja del hueso i en
+// pose de enlace, bones[i] * v esta dentro de la caja transformada, y una combinacion convexa de
+// esos puntos queda dentro de la caja que los une a todos. Asi basta transformar una caja por
+// hueso en cada muestra del clip, sin tocar los vertices.
+#pragma once
+
+#include "Animation.hpp"
+#include "Frustum.hpp"
+
+#include <cmath>
+#include <vector>
+
+// Cajas en pose de enlace (espacio del mesh) de los vertices que influye cada hueso
+struct SkinBindBounds {
+    std::vector<Aabb> bones;   // Indexadas por Bone::id
+    Aabb unskinned;            // Vertices sin pesos: el shader los deja donde estan
+    bool partialWeights = false; // Algun vertice con pesos que no suman 1 (se acerca al origen del modelo)
+};
+
+// vertices: stride floats por vertice con la posicion al principio; 4 IDs y 4 pesos por vertice
+inline void accumulateSkinBindBounds(const float* vertices, size_t vertexCount, size_t stride,
+                                     const int* boneIDs, const float* boneWeights, SkinBindBounds& out) {
+    for (size_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 position(vertices[v * stride], vertices[v * stride + 1], vertices[v * stride + 2]);
+        const int* ids = boneIDs + v * 4;
+        const float* weights = boneWeights + v * 4;
+
+        // Mismo umbral que el vertex shader de skinning
+        float weightDot = weights[0] * weights[0] + weights[1] * weights[1] + weights[2] * weights[2] + weights[3] * weights[3];
+        if (weightDot <= 0.0001f) {
+            out.unskinned.expand(position);
+            continue;
+        }
+        float weightSum = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            if (weights[k] > 0.0f && ids[k] >= 0) {
+                if (ids[k] >= (int)out.bones.size()) {
+                    out.bones.resize(ids[k] + 1);
+                }
+                out.bones[ids[k]].expand(position);
+                weightSum += weights[k];
+            }
+        }
+        if (std::fabs(weightSum - 1.0f) > 0.001f) {
+            out.partialWeights = true;
+        }
+    }
+}
+
+// Caja del mesh deformado durante todo el clip, en espacio del modelo. El clip se muestrea
+// samplesPerSecond veces por segundo; padding (relativo al tamaño de la caja) cubre el
+// movimiento entre muestras. anim == nullptr da la caja de la pose de enlace.
+inline Aabb computeClipBounds(const Skeleton& skeleton, const Animation* anim, const SkinBindBounds& bind,
+                              float samplesPerSecond = 30.0f, float padding = 0.05f) {
+    Aabb result = bind.unskinned;
+    if (bind.partialWeights) {
+        result.expand(glm::vec3(0.0f));
+    }
+
+    int samples = 1;
+    if (anim && anim->duration > 0.0f && anim->ticksPerSecond > 0.0f) {
+        samples = std::max(2, static_cast<int>(std::ceil(anim->duration / anim->ticksPerSecond * samplesPerSecond)) + 1);
+    }
+
+    AnimationCursor cursor;
+    cursor.reset(anim ? anim->tracks.size() : 0);
+    std::vector<glm::mat4> globalTransforms, boneTransforms;
+    for (int s = 0; s < samples; ++s) {
+        float animTime = samples > 1 ? anim->duration * s / (samples - 1) : 0.0f;
+        calculateBoneTransformations(skeleton, anim, animTime, anim ? &cursor : nullptr, globalTransforms, boneTransforms);
+        size_t boneCount = std::min(bind.bones.size(), boneTransforms.size());
+        for (size_t b = 0; b < boneCount; ++b) {
+            result.expand(transformAabb(boneTransforms[b], bind.bones[b]));
+        }
+    }
+
+    if (!result.empty() && padding > 0.0f) {
+        glm::vec3 pad = (result.max - result.min) * padding;
+        result.min -= pad;
+        result.max += pad;
+    }
+    return result;
+}
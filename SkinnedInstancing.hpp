@@ -0,0 +1,250 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Paletas de huesos de todos los personajes visibles en un solo texture buffer (GL_RGBA32F).
+// Cada instancia ocupa 3 texels para su matriz de modelo y 3 por hueso: se guardan las tres
+// primeras filas de cada matriz (mat4x3, 48 bytes en vez de 64; la cuarta fila siempre es 0 0 0 1).
+// El shader lee su bloque con texelFetch a partir de paletteBase + gl_InstanceID * stride, asi que
+// todas las instancias de un mismo modelo se dibujan con un glDrawElementsInstanced por mesh y el
+// numero de huesos no tiene limite fijo (solo GL_MAX_TEXTURE_BUFFER_SIZE).
+//
+// Las instancias que reproducen poses horneadas (PoseBaking.hpp) solo guardan su matriz de modelo y
+// un texel con el indice de su frame dentro de BakedPoseAtlas, donde estan los frames de todos los modelos.
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "PoseBaking.hpp"
+
+// Unidad de textura de las paletas, fuera de las que usa RenderQueue para los materiales
+constexpr GLuint kBonePaletteTextureUnit = 7;
+constexpr GLuint kBakedPoseTextureUnit = 8;
+
+// Texels por instancia con pose horneada: la matriz de modelo y el primer texel de su frame
+constexpr size_t kBakedPoseInstanceTexels = 4;
+
+// Texels por instancia: la matriz de modelo y una matriz por hueso
+inline size_t bonePaletteTexels(size_t boneCount) {
+    return 3 * (1 + boneCount);
+}
+
+class BonePaletteBuffer {
+public:
+    BonePaletteBuffer() = default;
+    ~BonePaletteBuffer() { release(); }
+
+    BonePaletteBuffer(const BonePaletteBuffer&) = delete;
+    BonePaletteBuffer& operator=(const BonePaletteBuffer&) = delete;
+
+    // Empieza un frame nuevo
+    void clear() { texels.clear(); }
+
+    // Si caben texelCount texels mas sin pasar de GL_MAX_TEXTURE_BUFFER_SIZE. Las instancias que no
+    // caben no se agregan ni se dibujan (leerian fuera del buffer y quedarian aplastadas en el origen);
+    // se avisa una vez.
+    bool fits(size_t texelCount) {
+        if (texels.size() + texelCount <= static_cast<size_t>(limit())) {
+            return true;
+        }
+        if (!warnedOverflow) {
+            std::cerr << "Warning: bone palettes need more than GL_MAX_TEXTURE_BUFFER_SIZE (" << maxTexels
+                      << ") texels; some characters will not be drawn." << std::endl;
+            warnedOverflow = true;
+        }
+        return false;
+    }
+
+    // Agrega una instancia y devuelve el indice de su primer texel. Con boneCount == 0 solo se
+    // guarda la matriz de modelo (personajes con skinning en CPU).
+    GLint append(const glm::mat4& model, const glm::mat4* palette, size_t boneCount) {
+        GLint first = static_cast<GLint>(texels.size());
+        appendPaletteRows(model, texels);
+        for (size_t b = 0; b < boneCount; ++b) {
+            appendPaletteRows(palette[b], texels);
+        }
+        return first;
+    }
+
+    // Instancia con pose horneada: poseTexel es el primer texel de su frame en BakedPoseAtlas
+    // (se guarda como float, exacto hasta 2^24 texels)
+    GLint appendBaked(const glm::mat4& model, size_t poseTexel) {
+        GLint first = static_cast<GLint>(texels.size());
+        appendPaletteRows(model, texels);
+        texels.push_back(glm::vec4(static_cast<float>(poseTexel), 0.0f, 0.0f, 0.0f));
+        return first;
+    }
+
+    // Sube todo lo agregado desde clear(). El buffer solo crece (al doble) y se huerfana en cada
+    // frame para no esperar a que la GPU termine con el anterior.
+    void upload() {
+        if (buffer == 0) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &textureBuffer);
+        }
+        if (texels.empty()) {
+            return;
+        }
+        size_t bytes = texels.size() * sizeof(glm::vec4);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (bytes > capacity) {
+            capacity = std::max(bytes, capacity * 2);
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, textureBuffer);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        } else {
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, texels.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void release() {
+        if (buffer != 0) {
+            glDeleteTextures(1, &textureBuffer);
+            glDeleteBuffers(1, &buffer);
+            buffer = textureBuffer = 0;
+            capacity = 0;
+        }
+    }
+
+    // Textura para enlazar en kBonePaletteTextureUnit (GL_TEXTURE_BUFFER)
+    GLuint texture() const { return textureBuffer; }
+    size_t texelCount() const { return texels.size(); }
+    size_t bytes() const { return texels.size() * sizeof(glm::vec4); }
+
+private:
+    std::vector<glm::vec4> texels;
+    GLuint buffer = 0, textureBuffer = 0;
+    size_t capacity = 0;
+    GLint maxTexels = 0; // Se consulta una vez, la primera vez que hace falta
+    bool warnedOverflow = false;
+
+    GLint limit() {
+        if (maxTexels == 0) {
+            maxTexels = 65536; // Minimo que garantiza OpenGL 3.3
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        }
+        return maxTexels;
+    }
+};
+
+// Poses horneadas de todos los modelos en un texture buffer (GL_RGBA32F) que no cambia entre frames:
+// cada modelo se agrega la primera vez que se dibuja y el buffer solo se vuelve a subir entonces.
+class BakedPoseAtlas {
+public:
+    BakedPoseAtlas() = default;
+    ~BakedPoseAtlas() { release(); }
+
+    BakedPoseAtlas(const BakedPoseAtlas&) = delete;
+    BakedPoseAtlas& operator=(const BakedPoseAtlas&) = delete;
+
+    // Si las poses de owner estan (o caben) en el atlas; las agrega la primera vez. Un modelo cuyos
+    // frames pasarian de GL_MAX_TEXTURE_BUFFER_SIZE se rechaza (con un aviso) y no usa poses horneadas.
+    // owner tiene que vivir tanto como el atlas (los ModelAsset del ModelAssetCache).
+    bool fits(const void* owner, const BakedPoses& poses) {
+        for (const Entry& entry : entries) {
+            if (entry.owner == owner) {
+                return entry.resident;
+            }
+        }
+        Entry entry{owner, texels.size(), texels.size() + poses.texels.size() <= static_cast<size_t>(limit())};
+        if (entry.resident) {
+            texels.insert(texels.end(), poses.texels.begin(), poses.texels.end());
+            dirty = true;
+        } else {
+            std::cerr << "Warning: baked poses of a model need " << poses.texels.size() << " texels, the atlas has "
+                      << texels.size() << " of GL_MAX_TEXTURE_BUFFER_SIZE (" << maxTexels
+                      << "); the model will not use baked playback." << std::endl;
+        }
+        entries.push_back(entry);
+        return entry.resident;
+    }
+
+    // Primer texel de las poses de owner en el atlas (0 si no caben, ver fits)
+    size_t base(const void* owner, const BakedPoses& poses) {
+        if (fits(owner, poses)) {
+            for (const Entry& entry : entries) {
+                if (entry.owner == owner) {
+                    return entry.base;
+                }
+            }
+        }
+        return 0;
+    }
+
+    void upload() {
+        if (!dirty) {
+            return;
+        }
+        if (buffer == 0) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &textureBuffer);
+        }
+        if (static_cast<GLint>(texels.size()) > limit() && !warnedOverflow) {
+            std::cerr << "Warning: baked poses need " << texels.size() << " texels, over GL_MAX_TEXTURE_BUFFER_SIZE ("
+                      << maxTexels << ")." << std::endl;
+            warnedOverflow = true;
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textureBuffer);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        dirty = false;
+    }
+
+    void release() {
+        if (buffer != 0) {
+            glDeleteTextures(1, &textureBuffer);
+            glDeleteBuffers(1, &buffer);
+            buffer = textureBuffer = 0;
+            dirty = !texels.empty();
+        }
+    }
+
+    // Textura para enlazar en kBakedPoseTextureUnit (GL_TEXTURE_BUFFER)
+    GLuint texture() const { return textureBuffer; }
+    size_t bytes() const { return texels.size() * sizeof(glm::vec4); }
+
+private:
+    struct Entry {
+        const void* owner;
+        size_t base;
+        bool resident; // false: sus frames no cabian en el atlas
+    };
+    std::vector<Entry> entries;
+    std::vector<glm::vec4> texels;
+    GLuint buffer = 0, textureBuffer = 0;
+    GLint maxTexels = 0; // Se consulta una vez, la primera vez que hace falta
+    bool dirty = false;
+    bool warnedOverflow = false;
+
+    GLint limit() {
+        if (maxTexels == 0) {
+            maxTexels = 65536; // Minimo que garantiza OpenGL 3.3
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        }
+        return maxTexels;
+    }
+};
@@ -0,0 +1,148 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Billboards estaticos (arboles, cocos...) dibujados con instancing.
+// Las matrices de mundo se calculan una sola vez al cargar y se guardan en un VBO de instancias;
+// cada tipo se dibuja despues con una sola llamada glDrawArraysInstanced.
+// Con culling, el VBO solo guarda las instancias visibles y se vuelve a llenar cuando ese conjunto cambia.
+// Se dibujan a traves de la RenderQueue (drawItem), como transparentes.
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.hpp"
+#include "RenderQueue.hpp"
+
+// Atributo del vertex shader de objetos que recibe la matriz de cada instancia.
+// Un mat4 ocupa 4 locations seguidas (5, 6, 7 y 8).
+constexpr GLuint kBillboardInstanceMatrixLocation = 5;
+
+// Matriz de mundo de un billboard: posicion, giro opcional sobre X y escala uniforme
+inline glm::mat4 billboardMatrix(const glm::vec3& position, float rotationXDegrees, float scale) {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    if (rotationXDegrees != 0.0f) {
+        model = glm::rotate(model, glm::radians(rotationXDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+    }
+    return glm::scale(model, glm::vec3(scale));
+}
+
+// Caja en el mundo del quad unitario (de -0.5 a 0.5 en X e Y) transformado por model
+inline Aabb billboardBounds(const glm::mat4& model) {
+    Aabb quad;
+    quad.min = glm::vec3(-0.5f, -0.5f, 0.0f);
+    quad.max = glm::vec3(0.5f, 0.5f, 0.0f);
+    return transformAabb(model, quad);
+}
+
+// Un tipo de billboard: un quad (de 4 vertices, dibujado como GL_TRIANGLE_FAN), su textura
+// y las matrices de todas sus instancias.
+class StaticBillboardBatch {
+public:
+    // quadVBO: 4 vertices de 5 floats (posicion + UV), compartido entre tipos y no propiedad del lote
+    StaticBillboardBatch(GLuint quadVBO, GLuint texture) : textureID(texture) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &instanceVBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(4);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (GLuint column = 0; column < 4; ++column) {
+            GLuint location = kBillboardInstanceMatrixLocation + column;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    ~StaticBillboardBatch() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    StaticBillboardBatch(const StaticBillboardBatch&) = delete;
+    StaticBillboardBatch& operator=(const StaticBillboardBatch&) = delete;
+
+    // Guarda las matrices y las sube todas. Se puede volver a llamar si cambia la colocacion.
+    void setInstances(const std::vector<glm::mat4>& instanceMatrices) {
+        matrices = instanceMatrices;
+        uploadedIndices.clear();
+        allUploaded = true;
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        instanceCount = static_cast<GLsizei>(matrices.size());
+    }
+
+    // Deja en el VBO solo las instancias de visible (indices de setInstances, en orden creciente).
+    // Si la lista es la misma que en el frame anterior no se sube nada.
+    void setVisible(const std::vector<uint32_t>& visible) {
+        if (allUploaded || visible != uploadedIndices) {
+            scratch.clear();
+            for (uint32_t index : visible) {
+                scratch.push_back(matrices[index]);
+            }
+            if (!scratch.empty()) {
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, scratch.size() * sizeof(glm::mat4), scratch.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            uploadedIndices = visible;
+            allUploaded = false;
+            instanceCount = static_cast<GLsizei>(visible.size());
+        }
+    }
+
+    // Una sola llamada instanciada con lo que haya en el VBO. program es el de objetos
+    // (view/projection los pone main una vez por frame).
+    DrawItem drawItem(GLuint program) const {
+        DrawItem item;
+        item.program = program;
+        item.vao = VAO;
+        item.textures[0] = textureID;
+        item.textureCount = 1;
+        item.transparent = true;
+        item.kind = DrawKind::ArraysInstanced;
+        item.mode = GL_TRIANGLE_FAN;
+        item.count = 4;
+        item.instanceCount = instanceCount;
+        return item;
+    }
+
+    GLsizei size() const { return static_cast<GLsizei>(matrices.size()); }
+    GLsizei drawnCount() const { return instanceCount; }
+    const glm::mat4& instance(size_t index) const { return matrices[index]; }
+
+private:
+    GLuint VAO = 0;
+    GLuint instanceVBO = 0;
+    GLuint textureID = 0;
+    GLsizei instanceCount = 0;                // Instancias que hay ahora en instanceVBO
+    std::vector<glm::mat4> matrices;          // Todas las instancias
+    std::vector<uint32_t> uploadedIndices;    // Instancias subidas por el ultimo setVisible
+    std::vector<glm::mat4> scratch;
+    bool allUploaded = false;
+};
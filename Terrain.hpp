@@ -0,0 +1,533 @@
+
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Funciones de terreno sin dependencias de OpenGL (se usan tambien desde bench.cpp)
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "PackedVertex.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Funciones para generar la malla del terreno ---
+// Genera una cuadrícula de vértices para el terreno
+inline std::vector<float> generateTerrainGridVertices(int resolutionX, int resolutionZ, float terrainSizeX, float terrainSizeZ, float baseHeight) {
+    std::vector<float> vertices;
+    float stepX = terrainSizeX / (resolutionX - 1);
+    float stepZ = terrainSizeZ / (resolutionZ - 1);
+
+    for (int z = 0; z < resolutionZ; ++z) {
+        for (int x = 0; x < resolutionX; ++x) {
+            float posX = -terrainSizeX / 2.0f + x * stepX;
+            float posZ = -terrainSizeZ / 2.0f + z * stepZ;
+            float posY = baseHeight; // La altura Y será modificada por el heightmap en el shader
+
+            // Normal inicial (apuntando hacia arriba, se recalculará en el shader)
+            float normX = 0.0f;
+            float normY = 1.0f;
+            float normZ = 0.0f;
+
+            // Coordenadas de textura (UVs de 0.0 a 1.0 para el heightmap y la repetición de hierba)
+            float texU = (float)x / (resolutionX - 1);
+            float texV = (float)z / (resolutionZ - 1);
+
+            // Añadir los 8 floats por vértice: Posición (3), Normal (3), TexCoords (2)
+            vertices.push_back(posX);
+            vertices.push_back(posY);
+            vertices.push_back(posZ);
+            vertices.push_back(normX);
+            vertices.push_back(normY);
+            vertices.push_back(normZ);
+            vertices.push_back(texU);
+            vertices.push_back(texV);
+        }
+    }
+    return vertices;
+}
+
+// Genera los índices para una cuadrícula de terreno (para dibujar con EBO)
+inline std::vector<unsigned int> generateTerrainGridIndices(int resolutionX, int resolutionZ) {
+    std::vector<unsigned int> indices;
+    for (int z = 0; z < resolutionZ - 1; ++z) {
+        for (int x = 0; x < resolutionX - 1; ++x) {
+            unsigned int topLeft = z * resolutionX + x;
+            unsigned int topRight = z * resolutionX + x + 1;
+            unsigned int bottomLeft = (z + 1) * resolutionX + x;
+            unsigned int bottomRight = (z + 1) * resolutionX + x + 1;
+
+            // Primer triángulo del quad (Top-Left, Bottom-Left, Top-Right)
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
+
+            // Segundo triángulo del quad (Top-Right, Bottom-Left, Bottom-Right)
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
+        }
+    }
+    return indices;
+}
+
+// Campo de alturas del terreno en memoria de CPU. Guarda el canal rojo del heightmap ya
+// convertido a float (0.0-1.0) y responde consultas de altura, normal y pendiente en
+// coordenadas del mundo, una a una o por lotes (con AVX2 o SSE2 si el compilador lo permite).
+// Interpola igual que el shader del terreno: bilineal y con los bordes fijados (clamp).
+class TerrainHeightField {
+public:
+    TerrainHeightField() = default;
+
+    TerrainHeightField(float terrainWidth, float terrainDepth, float terrainYOffset, float heightScale)
+        : terrainWidth(terrainWidth), terrainDepth(terrainDepth), terrainYOffset(terrainYOffset), heightScale(heightScale) {
+        updateMapping();
+    }
+
+    // Convierte una imagen de 8 bits (tal como la devuelve stbi_load) a la rejilla de floats.
+    // Solo se usa el primer canal, igual que texture(heightmap, uv).r en el shader.
+    void loadFromImage(const unsigned char* data, int width, int height, int channels) {
+        grid.clear();
+        gridWidth = gridHeight = 0;
+        if (!data || width <= 0 || height <= 0 || channels <= 0) {
+            updateMapping();
+            return;
+        }
+        gridWidth = width;
+        gridHeight = height;
+        grid.resize(static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < grid.size(); ++i) {
+            grid[i] = static_cast<float>(data[i * channels]) / 255.0f;
+        }
+        updateMapping();
+    }
+
+    bool empty() const { return grid.empty(); }
+    int width() const { return gridWidth; }
+    int height() const { return gridHeight; }
+    float yOffset() const { return terrainYOffset; }
+    float scale() const { return heightScale; }
+
+    // Valor normalizado (0.0-1.0) de una celda de la rejilla
+    float sample(int x, int z) const { return grid[static_cast<size_t>(z) * gridWidth + x]; }
+
+    // Altura del terreno en (worldX, worldZ). Sin heightmap devuelve terrainYOffset.
+    float heightAt(float worldX, float worldZ) const {
+        if (grid.empty()) {
+            return terrainYOffset;
+        }
+        float px = std::min(std::max(worldX * toPixelX + pixelBiasX, 0.0f), maxPixelX);
+        float pz = std::min(std::max(worldZ * toPixelZ + pixelBiasZ, 0.0f), maxPixelZ);
+        int x1 = static_cast<int>(px);
+        int z1 = static_cast<int>(pz);
+        int x2 = std::min(x1 + 1, gridWidth - 1);
+        int z2 = std::min(z1 + 1, gridHeight - 1);
+        float tx = px - x1;
+        float tz = pz - z1;
+
+        const float* row1 = &grid[static_cast<size_t>(z1) * gridWidth];
+        const float* row2 = &grid[static_cast<size_t>(z2) * gridWidth];
+        float top = row1[x1] + (row1[x2] - row1[x1]) * tx;
+        float bottom = row2[x1] + (row2[x2] - row2[x1]) * tx;
+        return terrainYOffset + (top + (bottom - top) * tz) * heightScale;
+    }
+
+    // Normal por diferencias centrales, con una celda del heightmap de separacion
+    glm::vec3 normalAt(float worldX, float worldZ) const {
+        float gx = (heightAt(worldX - cellX, worldZ) - heightAt(worldX + cellX, worldZ)) * invTwoCellX;
+        float gz = (heightAt(worldX, worldZ - cellZ) - heightAt(worldX, worldZ + cellZ)) * invTwoCellZ;
+        float invLength = 1.0f / std::sqrt(gx * gx + 1.0f + gz * gz);
+        return glm::vec3(gx * invLength, invLength, gz * invLength);
+    }
+
+    // 0 = plano, 1 = vertical (igual que "slope" en el fragment shader del terreno)
+    float slopeAt(float worldX, float worldZ) const {
+        return 1.0f - normalAt(worldX, worldZ).y;
+    }
+
+    // --- Consultas por lotes sobre arreglos de posiciones X y Z ---
+
+    void heights(const float* xs, const float* zs, float* out, size_t count) const {
+        size_t i = 0;
+        if (!grid.empty()) {
+#if defined(__AVX2__)
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(out + i, heights8(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(zs + i)));
+            }
+#elif defined(__SSE2__)
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(out + i, heights4(_mm_loadu_ps(xs + i), _mm_loadu_ps(zs + i)));
+            }
+#endif
+        }
+        for (; i < count; ++i) {
+            out[i] = heightAt(xs[i], zs[i]);
+        }
+    }
+
+    void normals(const float* xs, const float* zs, glm::vec3* out, size_t count) const {
+        size_t i = 0;
+        if (!grid.empty()) {
+#if defined(__AVX2__)
+            alignas(32) float nx[8], ny[8], nz[8];
+            for (; i + 8 <= count; i += 8) {
+                __m256 x = _mm256_loadu_ps(xs + i), z = _mm256_loadu_ps(zs + i);
+                __m256 vx, vy, vz;
+                normals8(x, z, vx, vy, vz);
+                _mm256_store_ps(nx, vx);
+                _mm256_store_ps(ny, vy);
+                _mm256_store_ps(nz, vz);
+                for (int k = 0; k < 8; ++k) {
+                    out[i + k] = glm::vec3(nx[k], ny[k], nz[k]);
+                }
+            }
+#elif defined(__SSE2__)
+            alignas(16) float nx[4], ny[4], nz[4];
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(xs + i), z = _mm_loadu_ps(zs + i);
+                __m128 vx, vy, vz;
+                normals4(x, z, vx, vy, vz);
+                _mm_store_ps(nx, vx);
+                _mm_store_ps(ny, vy);
+                _mm_store_ps(nz, vz);
+                for (int k = 0; k < 4; ++k) {
+                    out[i + k] = glm::vec3(nx[k], ny[k], nz[k]);
+                }
+            }
+#endif
+        }
+        for (; i < count; ++i) {
+            out[i] = normalAt(xs[i], zs[i]);
+        }
+    }
+
+    void slopes(const float* xs, const float* zs, float* out, size_t count) const {
+        size_t i = 0;
+        if (!grid.empty()) {
+#if defined(__AVX2__)
+            for (; i + 8 <= count; i += 8) {
+                __m256 vx, vy, vz;
+                normals8(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(zs + i), vx, vy, vz);
+                _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_set1_ps(1.0f), vy));
+            }
+#elif defined(__SSE2__)
+            for (; i + 4 <= count; i += 4) {
+                __m128 vx, vy, vz;
+                normals4(_mm_loadu_ps(xs + i), _mm_loadu_ps(zs + i), vx, vy, vz);
+                _mm_storeu_ps(out + i, _mm_sub_ps(_mm_set1_ps(1.0f), vy));
+            }
+#endif
+        }
+        for (; i < count; ++i) {
+            out[i] = slopeAt(xs[i], zs[i]);
+        }
+    }
+
+private:
+    // Precalcula la transformacion mundo -> pixel: px = worldX * toPixelX + pixelBiasX
+    void updateMapping() {
+        int w = std::max(gridWidth, 1), h = std::max(gridHeight, 1);
+        toPixelX = (w - 1) / terrainWidth;
+        toPixelZ = (h - 1) / terrainDepth;
+        pixelBiasX = terrainWidth / 2.0f * toPixelX;
+        pixelBiasZ = terrainDepth / 2.0f * toPixelZ;
+        maxPixelX = static_cast<float>(w - 1);
+        maxPixelZ = static_cast<float>(h - 1);
+        cellX = terrainWidth / std::max(w - 1, 1);
+        cellZ = terrainDepth / std::max(h - 1, 1);
+        invTwoCellX = 1.0f / (2.0f * cellX);
+        invTwoCellZ = 1.0f / (2.0f * cellZ);
+    }
+
+#if defined(__AVX2__)
+    __m256 heights8(__m256 worldX, __m256 worldZ) const {
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 px = _mm256_add_ps(_mm256_mul_ps(worldX, _mm256_set1_ps(toPixelX)), _mm256_set1_ps(pixelBiasX));
+        __m256 pz = _mm256_add_ps(_mm256_mul_ps(worldZ, _mm256_set1_ps(toPixelZ)), _mm256_set1_ps(pixelBiasZ));
+        px = _mm256_min_ps(_mm256_max_ps(px, zero), _mm256_set1_ps(maxPixelX));
+        pz = _mm256_min_ps(_mm256_max_ps(pz, zero), _mm256_set1_ps(maxPixelZ));
+
+        // px, pz >= 0, asi que truncar es lo mismo que floor
+        __m256i x1 = _mm256_cvttps_epi32(px);
+        __m256i z1 = _mm256_cvttps_epi32(pz);
+        __m256 tx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(x1));
+        __m256 tz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(z1));
+        const __m256i one = _mm256_set1_epi32(1);
+        __m256i x2 = _mm256_min_epi32(_mm256_add_epi32(x1, one), _mm256_set1_epi32(gridWidth - 1));
+        __m256i z2 = _mm256_min_epi32(_mm256_add_epi32(z1, one), _mm256_set1_epi32(gridHeight - 1));
+
+        const __m256i stride = _mm256_set1_epi32(gridWidth);
+        __m256i row1 = _mm256_mullo_epi32(z1, stride);
+        __m256i row2 = _mm256_mullo_epi32(z2, stride);
+        const float* base = grid.data();
+        __m256 h00 = _mm256_i32gather_ps(base, _mm256_add_epi32(row1, x1), 4);
+        __m256 h10 = _mm256_i32gather_ps(base, _mm256_add_epi32(row1, x2), 4);
+        __m256 h01 = _mm256_i32gather_ps(base, _mm256_add_epi32(row2, x1), 4);
+        __m256 h11 = _mm256_i32gather_ps(base, _mm256_add_epi32(row2, x2), 4);
+
+        __m256 top = _mm256_add_ps(h00, _mm256_mul_ps(_mm256_sub_ps(h10, h00), tx));
+        __m256 bottom = _mm256_add_ps(h01, _mm256_mul_ps(_mm256_sub_ps(h11, h01), tx));
+        __m256 value = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), tz));
+        return _mm256_add_ps(_mm256_set1_ps(terrainYOffset), _mm256_mul_ps(value, _mm256_set1_ps(heightScale)));
+    }
+
+    void normals8(__m256 worldX, __m256 worldZ, __m256& nx, __m256& ny, __m256& nz) const {
+        const __m256 dx = _mm256_set1_ps(cellX), dz = _mm256_set1_ps(cellZ);
+        __m256 gx = _mm256_mul_ps(_mm256_sub_ps(heights8(_mm256_sub_ps(worldX, dx), worldZ),
+                                                heights8(_mm256_add_ps(worldX, dx), worldZ)),
+                                  _mm256_set1_ps(invTwoCellX));
+        __m256 gz = _mm256_mul_ps(_mm256_sub_ps(heights8(worldX, _mm256_sub_ps(worldZ, dz)),
+                                                heights8(worldX, _mm256_add_ps(worldZ, dz))),
+                                  _mm256_set1_ps(invTwoCellZ));
+        const __m256 one = _mm256_set1_ps(1.0f);
+        __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), one), _mm256_mul_ps(gz, gz));
+        __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSq));
+        nx = _mm256_mul_ps(gx, invLength);
+        ny = invLength;
+        nz = _mm256_mul_ps(gz, invLength);
+    }
+#elif defined(__SSE2__)
+    // SSE2 no tiene gather ni min/mullo de enteros: los indices se calculan en escalar
+    __m128 heights4(__m128 worldX, __m128 worldZ) const {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 px = _mm_add_ps(_mm_mul_ps(worldX, _mm_set1_ps(toPixelX)), _mm_set1_ps(pixelBiasX));
+        __m128 pz = _mm_add_ps(_mm_mul_ps(worldZ, _mm_set1_ps(toPixelZ)), _mm_set1_ps(pixelBiasZ));
+        px = _mm_min_ps(_mm_max_ps(px, zero), _mm_set1_ps(maxPixelX));
+        pz = _mm_min_ps(_mm_max_ps(pz, zero), _mm_set1_ps(maxPixelZ));
+
+        __m128i x1 = _mm_cvttps_epi32(px);
+        __m128i z1 = _mm_cvttps_epi32(pz);
+        __m128 tx = _mm_sub_ps(px, _mm_cvtepi32_ps(x1));
+        __m128 tz = _mm_sub_ps(pz, _mm_cvtepi32_ps(z1));
+
+        alignas(16) int ix[4], iz[4];
+        alignas(16) float h00[4], h10[4], h01[4], h11[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(ix), x1);
+        _mm_store_si128(reinterpret_cast<__m128i*>(iz), z1);
+        for (int k = 0; k < 4; ++k) {
+            int x2 = std::min(ix[k] + 1, gridWidth - 1);
+            int z2 = std::min(iz[k] + 1, gridHeight - 1);
+            const float* row1 = &grid[static_cast<size_t>(iz[k]) * gridWidth];
+            const float* row2 = &grid[static_cast<size_t>(z2) * gridWidth];
+            h00[k] = row1[ix[k]];
+            h10[k] = row1[x2];
+            h01[k] = row2[ix[k]];
+            h11[k] = row2[x2];
+        }
+        __m128 v00 = _mm_load_ps(h00), v10 = _mm_load_ps(h10), v01 = _mm_load_ps(h01), v11 = _mm_load_ps(h11);
+
+        __m128 top = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), tx));
+        __m128 bottom = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), tx));
+        __m128 value = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), tz));
+        return _mm_add_ps(_mm_set1_ps(terrainYOffset), _mm_mul_ps(value, _mm_set1_ps(heightScale)));
+    }
+
+    void normals4(__m128 worldX, __m128 worldZ, __m128& nx, __m128& ny, __m128& nz) const {
+        const __m128 dx = _mm_set1_ps(cellX), dz = _mm_set1_ps(cellZ);
+        __m128 gx = _mm_mul_ps(_mm_sub_ps(heights4(_mm_sub_ps(worldX, dx), worldZ),
+                                          heights4(_mm_add_ps(worldX, dx), worldZ)),
+                               _mm_set1_ps(invTwoCellX));
+        __m128 gz = _mm_mul_ps(_mm_sub_ps(heights4(worldX, _mm_sub_ps(worldZ, dz)),
+                                          heights4(worldX, _mm_add_ps(worldZ, dz))),
+                               _mm_set1_ps(invTwoCellZ));
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), one), _mm_mul_ps(gz, gz));
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+        nx = _mm_mul_ps(gx, invLength);
+        ny = invLength;
+        nz = _mm_mul_ps(gz, invLength);
+    }
+#endif
+
+    std::vector<float> grid; // gridWidth * gridHeight valores normalizados, fila a fila
+    int gridWidth = 0;
+    int gridHeight = 0;
+
+    float terrainWidth = 512.0f;
+    float terrainDepth = 512.0f;
+    float terrainYOffset = 0.0f;
+    float heightScale = 1.0f;
+
+    float toPixelX = 0.0f, toPixelZ = 0.0f;
+    float pixelBiasX = 0.0f, pixelBiasZ = 0.0f;
+    float maxPixelX = 0.0f, maxPixelZ = 0.0f;
+    float cellX = 1.0f, cellZ = 1.0f;
+    float invTwoCellX = 0.5f, invTwoCellZ = 0.5f;
+};
+
+// Floats por vertice del terreno horneado: posicion (3), normal (3), UV (2)
+constexpr int kTerrainBakedVertexFloats = 8;
+
+// Separacion (en UV) de las muestras con las que se calcula la pendiente para la mezcla de roca
+// (bakeTerrainSplatTile)
+constexpr float kTerrainSlopeSampleDist = 0.0001f;
+
+// Hornea las filas [zBegin, zEnd) de la cuadricula del terreno en vertices (resolutionX * resolutionZ
+// * kTerrainBakedVertexFloats floats): posicion ya desplazada por el heightmap y normal suave. Hace
+// en CPU lo mismo que hacia el vertex shader del terreno: normal con diferencias centrales a
+// sampleDist (en UV). Cada fila es independiente, asi que las filas se pueden repartir entre varios hilos.
+inline void bakeTerrainGridRows(const TerrainHeightField& field, int resolutionX, int resolutionZ,
+                                float terrainSizeX, float terrainSizeZ, float sampleDist,
+                                int zBegin, int zEnd, float* vertices) {
+    std::vector<float> xs(resolutionX), zs(resolutionX);
+    std::vector<float> xMinus(resolutionX), xPlus(resolutionX), zMinus(resolutionX), zPlus(resolutionX);
+    std::vector<float> h(resolutionX), hL(resolutionX), hR(resolutionX), hD(resolutionX), hU(resolutionX);
+
+    // Las muestras vecinas se toman sobre las UV fijadas a [dist, 1 - dist], como en el shader
+    auto clampedWorld = [](float uv, float dist, float size) {
+        return (std::min(std::max(uv, dist), 1.0f - dist) - 0.5f) * size;
+    };
+
+    for (int z = zBegin; z < zEnd; ++z) {
+        float texV = (float)z / (resolutionZ - 1);
+        for (int x = 0; x < resolutionX; ++x) {
+            float texU = (float)x / (resolutionX - 1);
+            xs[x] = -terrainSizeX / 2.0f + texU * terrainSizeX;
+            zs[x] = -terrainSizeZ / 2.0f + texV * terrainSizeZ;
+        }
+        field.heights(xs.data(), zs.data(), h.data(), resolutionX);
+
+        // Muestras de la normal a sampleDist
+        float centerV = clampedWorld(texV, sampleDist, terrainSizeZ);
+        for (int x = 0; x < resolutionX; ++x) {
+            float centerU = clampedWorld((float)x / (resolutionX - 1), sampleDist, terrainSizeX);
+            xMinus[x] = centerU - sampleDist * terrainSizeX;
+            xPlus[x] = centerU + sampleDist * terrainSizeX;
+            zMinus[x] = centerV - sampleDist * terrainSizeZ;
+            zPlus[x] = centerV + sampleDist * terrainSizeZ;
+            xs[x] = centerU;
+            zs[x] = centerV;
+        }
+        field.heights(xMinus.data(), zs.data(), hL.data(), resolutionX);
+        field.heights(xPlus.data(), zs.data(), hR.data(), resolutionX);
+        field.heights(xs.data(), zMinus.data(), hD.data(), resolutionX);
+        field.heights(xs.data(), zPlus.data(), hU.data(), resolutionX);
+
+        float* out = vertices + static_cast<size_t>(z) * resolutionX * kTerrainBakedVertexFloats;
+        for (int x = 0; x < resolutionX; ++x, out += kTerrainBakedVertexFloats) {
+            float texU = (float)x / (resolutionX - 1);
+
+            // Si no hay heightmap las diferencias son 0 y la normal queda apuntando hacia arriba
+            glm::vec3 normal = glm::normalize(glm::vec3(hL[x] - hR[x], 2.0f * sampleDist, hD[x] - hU[x]));
+
+            out[0] = -terrainSizeX / 2.0f + texU * terrainSizeX;
+            out[1] = h[x];
+            out[2] = -terrainSizeZ / 2.0f + texV * terrainSizeZ;
+            out[3] = normal.x;
+            out[4] = normal.y;
+            out[5] = normal.z;
+            out[6] = texU;
+            out[7] = texV;
+        }
+    }
+}
+
+// Un texel RG32UI por vertice de la cuadricula horneada para dibujar el terreno sin atributos: la
+// altura (bits del float, la misma que usan las cajas del quadtree y heightAt) y la normal
+// octaedrica en 2 x snorm16. El vertex shader la lee con un solo texelFetch en la celda entera.
+inline void packTerrainGridTexels(const float* vertices, size_t vertexCount, uint32_t* texels) {
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const float* in = vertices + v * kTerrainBakedVertexFloats;
+        std::memcpy(&texels[v * 2], &in[1], sizeof(float));
+        glm::vec2 octahedral = octEncode(glm::vec3(in[3], in[4], in[5]));
+        uint16_t x = static_cast<uint16_t>(packSnorm16(octahedral.x));
+        uint16_t y = static_cast<uint16_t>(packSnorm16(octahedral.y));
+        texels[v * 2 + 1] = static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 16);
+    }
+}
+
+// Reglas de la mezcla de materiales del terreno (las que calculaba el fragment shader en cada pixel)
+struct TerrainSplatRules {
+    float sandToGrassStart = -16.0f, sandToGrassEnd = -15.0f;  // Altura: arena abajo, hierba arriba
+    float rockStartSlope = 1.0f - std::cos(glm::radians(70.0f)); // Pendiente (0 = plano, 1 = vertical)
+    float rockFullSlope = 1.0f - std::cos(glm::radians(82.0f));
+    float rockNoise = 0.15f;   // Variacion aleatoria que se suma a la roca
+    float rockOpacity = 0.8f;  // La roca nunca tapa del todo lo de debajo
+    float snowStart = 0.0f, snowEnd = 1.0f; // Altura: nieve sobre todo lo demas
+};
+
+inline float terrainSmoothstep(float edge0, float edge1, float x) {
+    float t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Hornea el rectangulo [xBegin, xEnd) x [zBegin, zEnd) del mapa de mezcla (mapWidth * mapHeight texels
+// RGBA8 sobre las UV 0-1 del terreno): pesos de arena, hierba, roca y nieve que suman 1. Equivalen a
+// las mezclas encadenadas del shader anterior (arena->hierba por altura, roca por pendiente con ruido,
+// nieve por altura); la pendiente se mide como en bakeTerrainGridRows. Los rectangulos son
+// independientes, asi que el mapa se puede repartir en bloques entre varios hilos.
+inline void bakeTerrainSplatTile(const TerrainHeightField& field, int mapWidth, int mapHeight,
+                                 float terrainSizeX, float terrainSizeZ, const TerrainSplatRules& rules,
+                                 int xBegin, int xEnd, int zBegin, int zEnd, unsigned char* splat) {
+    const int count = xEnd - xBegin;
+    const float dist = kTerrainSlopeSampleDist;
+    std::vector<float> xs(count), zs(count), xMinus(count), xPlus(count), zMinus(count), zPlus(count);
+    std::vector<float> h(count), sL(count), sR(count), sD(count), sU(count), cx(count), cz(count);
+
+    for (int z = zBegin; z < zEnd; ++z) {
+        float texV = (z + 0.5f) / mapHeight; // Centro del texel
+        float centerV = (std::min(std::max(texV, dist), 1.0f - dist) - 0.5f) * terrainSizeZ;
+        for (int i = 0; i < count; ++i) {
+            float texU = (xBegin + i + 0.5f) / mapWidth;
+            float centerU = (std::min(std::max(texU, dist), 1.0f - dist) - 0.5f) * terrainSizeX;
+            xs[i] = (texU - 0.5f) * terrainSizeX;
+            zs[i] = (texV - 0.5f) * terrainSizeZ;
+            xMinus[i] = centerU - dist * terrainSizeX;
+            xPlus[i] = centerU + dist * terrainSizeX;
+            zMinus[i] = centerV - dist * terrainSizeZ;
+            zPlus[i] = centerV + dist * terrainSizeZ;
+            cx[i] = centerU;
+            cz[i] = centerV;
+        }
+        field.heights(xs.data(), zs.data(), h.data(), count);
+        field.heights(xMinus.data(), cz.data(), sL.data(), count);
+        field.heights(xPlus.data(), cz.data(), sR.data(), count);
+        field.heights(cx.data(), zMinus.data(), sD.data(), count);
+        field.heights(cx.data(), zPlus.data(), sU.data(), count);
+
+        unsigned char* out = splat + (static_cast<size_t>(z) * mapWidth + xBegin) * 4;
+        for (int i = 0; i < count; ++i, out += 4) {
+            glm::vec3 slopeNormal = glm::normalize(glm::vec3(sL[i] - sR[i], 0.02f, sD[i] - sU[i]));
+            float slope = 1.0f - std::fabs(slopeNormal.y);
+
+            // El mismo ruido que el shader: fract(sin(dot(xz, (12.9898, 78.233))) * 43758.5453)
+            double noiseArg = std::sin(xs[i] * 12.9898 + zs[i] * 78.233) * 43758.5453;
+            float noise = static_cast<float>(noiseArg - std::floor(noiseArg)) * rules.rockNoise;
+
+            float grass = terrainSmoothstep(rules.sandToGrassStart, rules.sandToGrassEnd, h[i]);
+            float rock = std::min(std::max(terrainSmoothstep(rules.rockStartSlope, rules.rockFullSlope, slope) + noise, 0.0f), 1.0f) * rules.rockOpacity;
+            float snow = terrainSmoothstep(rules.snowStart, rules.snowEnd, h[i]);
+
+            // mix(mix(mix(arena, hierba, g), roca, r), nieve, n) como suma de pesos
+            float weights[4] = {(1.0f - grass) * (1.0f - rock) * (1.0f - snow), grass * (1.0f - rock) * (1.0f - snow),
+                                rock * (1.0f - snow), snow};
+            for (int k = 0; k < 4; ++k) {
+                out[k] = static_cast<unsigned char>(weights[k] * 255.0f + 0.5f);
+            }
+        }
+    }
+}
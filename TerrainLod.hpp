@@ -0,0 +1,381 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// LOD del terreno por bloques (geomipmapping) sobre la malla horneada, sin llamadas a OpenGL.
+//
+// La cuadricula de vertices se divide en bloques de chunkQuads x chunkQuads celdas. Cada bloque se
+// dibuja con uno de varios niveles de detalle (saltando 1, 2, 4... vertices) segun la distancia a la
+// camara. Los indices de cada bloque son relativos a su esquina, asi que un mismo juego de indices
+// sirve para todos los bloques usando glDrawElementsBaseVertex.
+//
+// Para evitar grietas, dos bloques vecinos difieren como mucho en un nivel, y el lado que toca a un
+// vecino mas grueso junta sus vertices impares con el par anterior (quedan solo los vertices del vecino).
+// Un quadtree con las cajas de los bloques descarta de golpe lo que queda fuera del frustum.
+//
+// Ademas de las listas de triangulos sobre la malla horneada se generan los mismos juegos como tiras
+// de 16 bits relativas al bloque ((chunkQuads + 1)^2 vertices), separadas con kTerrainStripRestart.
+// Con ellas el terreno se dibuja sin atributos: el vertex shader saca la posicion del vertice de
+// gl_VertexID y de la esquina del bloque (TerrainChunkDraw::originX/Z).
+//
+// Las listas se reordenan para la cache de vertices con optimizeVertexCache. Las tiras no se pueden
+// reordenar por triangulos, asi que se parten en bandas de kTerrainStripBandQuads celdas: al bajar
+// a la fila siguiente la fila compartida sigue en la cache.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.hpp"
+#include "VertexCache.hpp"
+
+// Lados de un bloque que tocan a un vecino de un nivel mas grueso
+enum TerrainEdge : unsigned {
+    kTerrainEdgeWest = 1,   // -X
+    kTerrainEdgeEast = 2,   // +X
+    kTerrainEdgeNorth = 4,  // -Z
+    kTerrainEdgeSouth = 8,  // +Z
+    kTerrainEdgeMaskCount = 16
+};
+
+// Indice de reinicio de primitiva de las tiras (glPrimitiveRestartIndex)
+constexpr uint16_t kTerrainStripRestart = 0xffff;
+
+// Ancho de las bandas de las tiras: una fila de la banda (2 * (ancho + 1) vertices) cabe en la cache
+constexpr int kTerrainStripBandQuads = static_cast<int>(kVertexCacheSize) / 2 - 1;
+
+// ACMR/ATVR de todos los juegos de indices, antes y despues de ordenarlos para la cache
+struct TerrainCacheReport {
+    VertexCacheStats listBefore, listAfter;   // Listas en orden de filas / con optimizeVertexCache
+    VertexCacheStats stripBefore, stripAfter; // Una tira por fila / por bandas
+};
+
+// Una llamada de dibujo: indices [indexOffset, indexOffset + indexCount) del EBO, sumando baseVertex.
+// Sin atributos: tiras [stripOffset, stripOffset + stripCount) de stripIndices() con el bloque en originX/Z.
+struct TerrainChunkDraw {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    int32_t baseVertex;
+    uint32_t stripOffset;
+    uint32_t stripCount;
+    int32_t originX, originZ; // Esquina del bloque, en vertices de la cuadricula
+    float distance; // Del bloque a la camara, para ordenar de cerca a lejos
+};
+
+class TerrainQuadtree {
+public:
+    // vertices: resolutionX * resolutionZ vertices de vertexStride floats con la posicion en los 3 primeros.
+    // (resolutionX - 1) y (resolutionZ - 1) deben ser multiplos de chunkQuads, que debe ser potencia de 2
+    // y como mucho 128 (los vertices de un bloque deben caber en las tiras de 16 bits).
+    bool build(const float* vertices, int resolutionX, int resolutionZ, int vertexStride, int chunkQuads) {
+        if (chunkQuads < 1 || (chunkQuads & (chunkQuads - 1)) != 0 || (chunkQuads + 1) * (chunkQuads + 1) > kTerrainStripRestart ||
+            (resolutionX - 1) % chunkQuads != 0 || (resolutionZ - 1) % chunkQuads != 0) {
+            return false;
+        }
+        this->resolutionX = resolutionX;
+        this->chunkQuads = chunkQuads;
+        chunksX = (resolutionX - 1) / chunkQuads;
+        chunksZ = (resolutionZ - 1) / chunkQuads;
+        levels = 1;
+        while ((chunkQuads >> (levels - 1)) > 1) {
+            ++levels;
+        }
+
+        // Caja de cada bloque a partir de sus vertices reales
+        chunkBounds.assign(static_cast<size_t>(chunksX) * chunksZ, Aabb());
+        for (int cz = 0; cz < chunksZ; ++cz) {
+            for (int cx = 0; cx < chunksX; ++cx) {
+                Aabb& box = chunkBounds[cz * chunksX + cx];
+                for (int z = cz * chunkQuads; z <= (cz + 1) * chunkQuads; ++z) {
+                    for (int x = cx * chunkQuads; x <= (cx + 1) * chunkQuads; ++x) {
+                        const float* v = vertices + (static_cast<size_t>(z) * resolutionX + x) * vertexStride;
+                        box.expand(glm::vec3(v[0], v[1], v[2]));
+                    }
+                }
+            }
+        }
+
+        nodes.clear();
+        buildNode(0, 0, chunksX, chunksZ);
+        buildIndices();
+        chunkLods.assign(chunkBounds.size(), 0);
+        chunkVisible.assign(chunkBounds.size(), 0);
+        return true;
+    }
+
+    // Elige los bloques visibles y su nivel, y devuelve una llamada de dibujo por bloque.
+    // lodDistance: distancia hasta la que se usa el nivel 0; cada vez que se duplica se baja un nivel.
+    void select(const Frustum& frustum, const glm::vec3& cameraPos, float lodDistance, std::vector<TerrainChunkDraw>& out) {
+        out.clear();
+        visibleChunks = 0;
+        trianglesSelected = 0;
+        if (nodes.empty()) {
+            return;
+        }
+
+        // 1. Nivel de cada bloque segun su distancia a la camara
+        for (size_t i = 0; i < chunkBounds.size(); ++i) {
+            float distance = chunkBounds[i].distance(cameraPos);
+            int lod = distance <= lodDistance ? 0 : static_cast<int>(std::log2(distance / lodDistance)) + 1;
+            chunkLods[i] = std::min(lod, levels - 1);
+        }
+
+        // 2. Los vecinos difieren como mucho en un nivel (se refina el bloque mas grueso)
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int cz = 0; cz < chunksZ; ++cz) {
+                for (int cx = 0; cx < chunksX; ++cx) {
+                    int finest = std::min(std::min(lodAt(cx - 1, cz), lodAt(cx + 1, cz)),
+                                          std::min(lodAt(cx, cz - 1), lodAt(cx, cz + 1)));
+                    int& lod = chunkLods[cz * chunksX + cx];
+                    if (lod > finest + 1) {
+                        lod = finest + 1;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        // 3. Recorrido del quadtree descartando las ramas fuera del frustum
+        std::fill(chunkVisible.begin(), chunkVisible.end(), 0);
+        markVisible(0, frustum);
+
+        // 4. Una llamada por bloque visible, con el juego de indices de su nivel y sus lados cosidos
+        for (int cz = 0; cz < chunksZ; ++cz) {
+            for (int cx = 0; cx < chunksX; ++cx) {
+                int chunk = cz * chunksX + cx;
+                if (!chunkVisible[chunk]) {
+                    continue;
+                }
+                int lod = chunkLods[chunk];
+                unsigned mask = 0;
+                if (cx > 0 && lodAt(cx - 1, cz) > lod) mask |= kTerrainEdgeWest;
+                if (cx + 1 < chunksX && lodAt(cx + 1, cz) > lod) mask |= kTerrainEdgeEast;
+                if (cz > 0 && lodAt(cx, cz - 1) > lod) mask |= kTerrainEdgeNorth;
+                if (cz + 1 < chunksZ && lodAt(cx, cz + 1) > lod) mask |= kTerrainEdgeSouth;
+
+                const IndexRange& range = ranges[lod * kTerrainEdgeMaskCount + mask];
+                const IndexRange& strip = stripRanges[lod * kTerrainEdgeMaskCount + mask];
+                TerrainChunkDraw draw;
+                draw.indexOffset = range.offset;
+                draw.indexCount = range.count;
+                draw.baseVertex = (cz * chunkQuads) * resolutionX + cx * chunkQuads;
+                draw.stripOffset = strip.offset;
+                draw.stripCount = strip.count;
+                draw.originX = cx * chunkQuads;
+                draw.originZ = cz * chunkQuads;
+                draw.distance = chunkBounds[chunk].distance(cameraPos);
+                out.push_back(draw);
+                ++visibleChunks;
+                trianglesSelected += range.count / 3;
+            }
+        }
+    }
+
+    // Todos los juegos de indices (nivel x lados cosidos), para subirlos a un solo EBO
+    const std::vector<uint32_t>& indices() const { return indexData; }
+
+    // Los mismos juegos como tiras de 16 bits relativas al bloque, para dibujar sin atributos
+    const std::vector<uint16_t>& stripIndices() const { return stripData; }
+    int patchVerticesPerRow() const { return chunkQuads + 1; }
+
+    const TerrainCacheReport& vertexCacheReport() const { return cacheReport; }
+
+    int chunkCount() const { return chunksX * chunksZ; }
+    int levelCount() const { return levels; }
+    const Aabb& bounds() const { return nodes.front().bounds; }
+
+    // Estadisticas de la ultima llamada a select
+    int lastVisibleChunks() const { return visibleChunks; }
+    size_t lastTriangleCount() const { return trianglesSelected; }
+
+private:
+    struct Node {
+        Aabb bounds;
+        int chunk = -1;          // Indice del bloque si es una hoja
+        int children[4] = {-1, -1, -1, -1};
+    };
+
+    struct IndexRange {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    int lodAt(int cx, int cz) const {
+        if (cx < 0 || cz < 0 || cx >= chunksX || cz >= chunksZ) {
+            return levels; // Fuera del terreno: no limita el nivel de nadie
+        }
+        return chunkLods[cz * chunksX + cx];
+    }
+
+    int buildNode(int x0, int z0, int x1, int z1) {
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(Node());
+        if (x1 - x0 == 1 && z1 - z0 == 1) {
+            nodes[index].chunk = z0 * chunksX + x0;
+            nodes[index].bounds = chunkBounds[nodes[index].chunk];
+            return index;
+        }
+
+        int xm = x1 - x0 > 1 ? (x0 + x1) / 2 : x1;
+        int zm = z1 - z0 > 1 ? (z0 + z1) / 2 : z1;
+        const int quadrants[4][4] = {{x0, z0, xm, zm}, {xm, z0, x1, zm}, {x0, zm, xm, z1}, {xm, zm, x1, z1}};
+        Aabb bounds;
+        for (int i = 0; i < 4; ++i) {
+            const int* r = quadrants[i];
+            if (r[0] < r[2] && r[1] < r[3]) {
+                int child = buildNode(r[0], r[1], r[2], r[3]);
+                nodes[index].children[i] = child;
+                bounds.expand(nodes[child].bounds);
+            }
+        }
+        nodes[index].bounds = bounds;
+        return index;
+    }
+
+    void markVisible(int index, const Frustum& frustum) {
+        const Node& node = nodes[index];
+        if (!frustum.intersects(node.bounds)) {
+            return;
+        }
+        if (node.chunk >= 0) {
+            chunkVisible[node.chunk] = 1;
+            return;
+        }
+        for (int child : node.children) {
+            if (child >= 0) {
+                markVisible(child, frustum);
+            }
+        }
+    }
+
+    void buildIndices() {
+        indexData.clear();
+        stripData.clear();
+        cacheReport = TerrainCacheReport();
+        ranges.assign(static_cast<size_t>(levels) * kTerrainEdgeMaskCount, IndexRange());
+        stripRanges.assign(ranges.size(), IndexRange());
+        std::vector<uint16_t> rowStrips;
+        for (int lod = 0; lod < levels; ++lod) {
+            for (unsigned mask = 0; mask < kTerrainEdgeMaskCount; ++mask) {
+                IndexRange& range = ranges[lod * kTerrainEdgeMaskCount + mask];
+                range.offset = static_cast<uint32_t>(indexData.size());
+                appendChunkIndices(lod, mask);
+                range.count = static_cast<uint32_t>(indexData.size()) - range.offset;
+                uint32_t* list = indexData.data() + range.offset;
+                cacheReport.listBefore.add(analyzeVertexCache(list, range.count));
+                optimizeVertexCache(list, range.count);
+                cacheReport.listAfter.add(analyzeVertexCache(list, range.count));
+
+                IndexRange& strip = stripRanges[lod * kTerrainEdgeMaskCount + mask];
+                strip.offset = static_cast<uint32_t>(stripData.size());
+                appendChunkStrips(lod, mask, kTerrainStripBandQuads, stripData);
+                strip.count = static_cast<uint32_t>(stripData.size()) - strip.offset;
+                cacheReport.stripAfter.add(analyzeStripVertexCache(stripData.data() + strip.offset, strip.count, kTerrainStripRestart));
+
+                rowStrips.clear();
+                appendChunkStrips(lod, mask, chunkQuads, rowStrips);
+                cacheReport.stripBefore.add(analyzeStripVertexCache(rowStrips.data(), rowStrips.size(), kTerrainStripRestart));
+            }
+        }
+    }
+
+    // Indice del vertice local (x, z) con rowStride vertices por fila. En un lado cosido, los
+    // vertices impares del nivel se juntan con el par anterior, que es un vertice del vecino.
+    uint32_t stitchedVertex(int x, int z, int step, unsigned mask, int rowStride) const {
+        bool oddX = (x / step) % 2 == 1;
+        bool oddZ = (z / step) % 2 == 1;
+        if (((mask & kTerrainEdgeWest) && x == 0 && oddZ) || ((mask & kTerrainEdgeEast) && x == chunkQuads && oddZ)) {
+            z -= step;
+        }
+        if (((mask & kTerrainEdgeNorth) && z == 0 && oddX) || ((mask & kTerrainEdgeSouth) && z == chunkQuads && oddX)) {
+            x -= step;
+        }
+        return static_cast<uint32_t>(z * rowStride + x);
+    }
+
+    // Una tira por fila de celdas de cada banda de bandQuads celdas del nivel: (x, z), (x, z + step)
+    // alternados. Los triangulos salen con el mismo sentido que appendChunkIndices; los que colapsa el
+    // cosido quedan degenerados y la GPU los descarta sin rasterizar.
+    void appendChunkStrips(int lod, unsigned mask, int bandQuads, std::vector<uint16_t>& out) const {
+        const int step = 1 << lod;
+        const int rowStride = chunkQuads + 1;
+        const int bandWidth = std::max(1, bandQuads) * step;
+        bool first = true;
+        for (int x0 = 0; x0 < chunkQuads; x0 += bandWidth) {
+            const int x1 = std::min(x0 + bandWidth, chunkQuads);
+            for (int z = 0; z < chunkQuads; z += step) {
+                if (!first) {
+                    out.push_back(kTerrainStripRestart);
+                }
+                first = false;
+                for (int x = x0; x <= x1; x += step) {
+                    out.push_back(static_cast<uint16_t>(stitchedVertex(x, z, step, mask, rowStride)));
+                    out.push_back(static_cast<uint16_t>(stitchedVertex(x, z + step, step, mask, rowStride)));
+                }
+            }
+        }
+    }
+
+    void appendChunkIndices(int lod, unsigned mask) {
+        const int step = 1 << lod;
+        // Indice relativo a la esquina del bloque en la malla completa
+        auto vertex = [&](int x, int z) {
+            return stitchedVertex(x, z, step, mask, resolutionX);
+        };
+        auto triangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+            if (a != b && b != c && a != c) { // Los triangulos que colapsa el cosido no se dibujan
+                indexData.push_back(a);
+                indexData.push_back(b);
+                indexData.push_back(c);
+            }
+        };
+
+        // Mismo orden de vertices que generateTerrainGridIndices
+        for (int z = 0; z < chunkQuads; z += step) {
+            for (int x = 0; x < chunkQuads; x += step) {
+                uint32_t topLeft = vertex(x, z);
+                uint32_t topRight = vertex(x + step, z);
+                uint32_t bottomLeft = vertex(x, z + step);
+                uint32_t bottomRight = vertex(x + step, z + step);
+                triangle(topLeft, bottomLeft, topRight);
+                triangle(topRight, bottomLeft, bottomRight);
+            }
+        }
+    }
+
+    int resolutionX = 0;
+    int chunkQuads = 0;
+    int chunksX = 0;
+    int chunksZ = 0;
+    int levels = 0;
+
+    std::vector<Aabb> chunkBounds;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> indexData;
+    std::vector<IndexRange> ranges;
+    std::vector<uint16_t> stripData;
+    std::vector<IndexRange> stripRanges;
+    TerrainCacheReport cacheReport;
+
+    std::vector<int> chunkLods;              // Nivel elegido para cada bloque en el ultimo select
+    std::vector<unsigned char> chunkVisible;
+    int visibleChunks = 0;
+    size_t trianglesSelected = 0;
+};
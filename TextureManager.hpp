@@ -0,0 +1,446 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Gestor de texturas: una sola copia en la GPU por (ruta, parametros de muestreo).
+// Las texturas se comparten con shared_ptr (como ModelAssetCache con los modelos); el gestor
+// lleva la cuenta de los bytes residentes y, si superan el presupuesto, primero libera las
+// texturas sin usuarios menos usadas recientemente y despues reduce a la mitad las que siguen
+// en uso (el nombre GL no cambia, asi que los ids guardados en meshes y materiales siguen valiendo).
+// Si junto a la imagen hay una version cocinada al dia (<imagen>.ctex, ver cooktex.cpp) se suben sus
+// mipmaps ya hechos, comprimidos en BC1/BC3 cuando el driver tiene S3TC, en vez de decodificar el PNG.
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "CookedTexture.hpp"
+#include "stb_image.h"
+
+struct SamplerSettings {
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+
+    bool usesMipmaps() const { return minFilter != GL_LINEAR && minFilter != GL_NEAREST; }
+
+    bool operator<(const SamplerSettings& other) const {
+        return std::tie(wrapS, wrapT, minFilter, magFilter) < std::tie(other.wrapS, other.wrapT, other.minFilter, other.magFilter);
+    }
+};
+
+inline SamplerSettings clampedLinearSampler() {
+    SamplerSettings sampler;
+    sampler.wrapS = sampler.wrapT = GL_CLAMP_TO_EDGE;
+    sampler.minFilter = GL_LINEAR;
+    return sampler;
+}
+
+// Textura residente. Solo el gestor la modifica (al reducirla o liberarla).
+struct Texture {
+    GLuint id = 0;
+    int width = 0, height = 0, channels = 0;
+    size_t bytes = 0;            // Estimacion: ancho * alto * canales, +1/3 con mipmaps (exacto si esta cocinada)
+    std::string path;
+    SamplerSettings sampler;
+    bool pinned = false;         // Nunca se reduce (p. ej. el heightmap, que se muestrea por texel)
+    uint64_t lastUsedFrame = 0;
+    int downsizeLevel = 0;       // Veces que se ha reducido a la mitad
+    bool cooked = false;         // Subida desde <path>.ctex
+    bool compressed = false;     // BC1/BC3 en la GPU
+};
+
+using TextureHandle = std::shared_ptr<const Texture>;
+
+// Nombre GL de la textura, o 0 si no se pudo cargar
+inline GLuint textureId(const TextureHandle& texture) { return texture ? texture->id : 0; }
+
+struct TextureManagerStats {
+    size_t decodes = 0, cookedLoads = 0, cacheHits = 0, evictions = 0, downsizes = 0;
+};
+
+class TextureManager {
+public:
+    explicit TextureManager(size_t budgetBytes) : budget(budgetBytes) {}
+
+    ~TextureManager() { shutdown(); }
+
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    // Devuelve la textura ya cargada o la decodifica y sube ahora. nullptr si el archivo no se pudo leer.
+    TextureHandle load(const std::string& path, const SamplerSettings& sampler = SamplerSettings(), bool pinned = false) {
+        if (TextureHandle cached = find(path, sampler)) {
+            return cached;
+        }
+        CookedTexture cooked;
+        if (loadCookedTexture(cookedTexturePath(path), path, cooked)) {
+            ++stats.cookedLoads;
+            return uploadCooked(path, cooked, sampler, pinned);
+        }
+        int width, height, channels;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (!data) {
+            std::cerr << "Texture failed to load at path: " << path << std::endl;
+            return nullptr;
+        }
+        ++stats.decodes;
+        TextureHandle texture = upload(path, data, width, height, channels, sampler, pinned);
+        stbi_image_free(data);
+        return texture;
+    }
+
+    // Para imagenes que ya se decodificaron por otro motivo (el heightmap tambien se usa en la CPU).
+    // key hace de ruta en la cache.
+    TextureHandle loadFromPixels(const std::string& key, const unsigned char* pixels, int width, int height, int channels,
+                                 const SamplerSettings& sampler = SamplerSettings(), bool pinned = false) {
+        if (TextureHandle cached = find(key, sampler)) {
+            return cached;
+        }
+        return upload(key, pixels, width, height, channels, sampler, pinned);
+    }
+
+    // Marca la textura como usada en este frame (para el orden LRU)
+    void touch(GLuint id) {
+        auto it = byId.find(id);
+        if (it != byId.end()) {
+            it->second->lastUsedFrame = frame;
+        }
+    }
+
+    // Fin de frame: avanza el reloj LRU y aplica el presupuesto. Devuelve true si tuvo que liberar o
+    // reducir texturas: eso cambia las texturas enlazadas por fuera de GlStateCache (hay que invalidarla).
+    bool endFrame() {
+        ++frame;
+        if (resident <= budget) {
+            return false;
+        }
+        enforceBudget();
+        return true;
+    }
+
+    void setBudget(size_t budgetBytes) {
+        budget = budgetBytes;
+        enforceBudget();
+    }
+
+    // 1. Libera las texturas sin usuarios, de la menos usada a la mas usada recientemente.
+    // 2. Si no basta, reduce a la mitad las que estan en uso, con el mismo orden, hasta entrar.
+    void enforceBudget() {
+        if (resident <= budget) {
+            return;
+        }
+        std::vector<std::map<Key, std::shared_ptr<Texture>>::iterator> candidates;
+        for (auto it = textures.begin(); it != textures.end(); ++it) {
+            candidates.push_back(it);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a->second->lastUsedFrame < b->second->lastUsedFrame;
+        });
+
+        for (auto& it : candidates) {
+            if (resident <= budget) {
+                return;
+            }
+            if (it->second.use_count() == 1) {
+                Texture& texture = *it->second;
+                std::cout << "Texture evicted (LRU): " << texture.path << std::endl;
+                destroy(texture);
+                textures.erase(it);
+                it = textures.end(); // El iterador ya no es valido: se quita de los candidatos abajo
+                ++stats.evictions;
+            }
+        }
+        candidates.erase(std::remove(candidates.begin(), candidates.end(), textures.end()), candidates.end());
+        for (bool progress = true; progress && resident > budget;) {
+            progress = false;
+            for (auto it : candidates) {
+                if (resident <= budget) {
+                    return;
+                }
+                if (!it->second->pinned && downsize(*it->second)) {
+                    progress = true;
+                }
+            }
+        }
+        if (resident > budget) {
+            std::cerr << "Warning: textures need " << resident << " bytes, over the budget of " << budget << std::endl;
+        }
+    }
+
+    // Libera todo lo que hay en la GPU. Llamar antes de destruir el contexto; los TextureHandle
+    // que sigan vivos quedan con id 0.
+    void shutdown() {
+        for (auto& [key, texture] : textures) {
+            destroy(*texture);
+        }
+        textures.clear();
+        byId.clear();
+    }
+
+    size_t residentBytes() const { return resident; }
+    size_t budgetBytes() const { return budget; }
+    size_t size() const { return textures.size(); }
+    const TextureManagerStats& statistics() const { return stats; }
+
+private:
+    using Key = std::pair<std::string, SamplerSettings>;
+
+    std::map<Key, std::shared_ptr<Texture>> textures;
+    std::unordered_map<GLuint, Texture*> byId;
+    size_t budget;
+    size_t resident = 0;
+    uint64_t frame = 0;
+    TextureManagerStats stats;
+    int s3tc = -1; // -1 sin consultar
+
+    static constexpr int kMinDownsizeSize = 32;
+
+    TextureHandle find(const std::string& path, const SamplerSettings& sampler) {
+        auto it = textures.find(Key(path, sampler));
+        if (it == textures.end()) {
+            return nullptr;
+        }
+        ++stats.cacheHits;
+        it->second->lastUsedFrame = frame;
+        return it->second;
+    }
+
+    static GLenum formatFor(int channels) {
+        switch (channels) {
+            case 1: return GL_RED;
+            case 2: return GL_RG;
+            case 3: return GL_RGB;
+            default: return GL_RGBA;
+        }
+    }
+
+    static GLenum internalFormatFor(int channels) {
+        switch (channels) {
+            case 1: return GL_R8;
+            case 2: return GL_RG8;
+            case 3: return GL_RGB8;
+            default: return GL_RGBA8;
+        }
+    }
+
+    static size_t estimateBytes(int width, int height, int channels, bool mipmaps) {
+        size_t base = static_cast<size_t>(width) * height * channels;
+        return mipmaps ? base + base / 3 : base;
+    }
+
+    // Sube el nivel 0 (y los mipmaps si el sampler los usa) a la textura ya enlazada
+    static void uploadLevels(const Texture& texture, const unsigned char* pixels) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Filas RGB de ancho impar no estan alineadas a 4
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormatFor(texture.channels), texture.width, texture.height, 0,
+                     formatFor(texture.channels), GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (texture.sampler.usesMipmaps()) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+
+    TextureHandle upload(const std::string& path, const unsigned char* pixels, int width, int height, int channels,
+                         const SamplerSettings& sampler, bool pinned) {
+        auto texture = std::make_shared<Texture>();
+        texture->width = width;
+        texture->height = height;
+        texture->channels = std::min(std::max(channels, 1), 4);
+        texture->path = path;
+        texture->sampler = sampler;
+        texture->pinned = pinned;
+        texture->lastUsedFrame = frame;
+
+        glGenTextures(1, &texture->id);
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+        uploadLevels(*texture, pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        texture->bytes = estimateBytes(width, height, texture->channels, sampler.usesMipmaps());
+        resident += texture->bytes;
+        byId[texture->id] = texture.get();
+        textures[Key(path, sampler)] = texture;
+        std::cout << "Texture loaded: " << path << " (" << width << "x" << height << ", " << (texture->bytes >> 10) << " KiB)" << std::endl;
+        enforceBudget();
+        return texture;
+    }
+
+    bool s3tcSupported() {
+        if (s3tc < 0) {
+            s3tc = 0;
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count && !s3tc; ++i) {
+                const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                s3tc = name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+            }
+            if (!s3tc) {
+                std::cout << "S3TC not supported: cooked BC textures are decoded to RGBA8 at load." << std::endl;
+            }
+        }
+        return s3tc != 0;
+    }
+
+    TextureHandle uploadCooked(const std::string& path, const CookedTexture& cooked, const SamplerSettings& sampler, bool pinned) {
+        auto texture = std::make_shared<Texture>();
+        texture->channels = 4;
+        texture->path = path;
+        texture->sampler = sampler;
+        texture->pinned = pinned;
+        texture->lastUsedFrame = frame;
+        texture->cooked = true;
+
+        glGenTextures(1, &texture->id);
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+        uploadCookedLevels(*texture, cooked, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        resident += texture->bytes;
+        byId[texture->id] = texture.get();
+        textures[Key(path, sampler)] = texture;
+        std::cout << "Texture loaded: " << cookedTexturePath(path) << " (" << texture->width << "x" << texture->height << " "
+                  << cookedTextureFormatName(cooked.header.format) << (texture->compressed ? "" : " as RGBA8") << ", "
+                  << cooked.header.levelCount << " levels, " << (texture->bytes >> 10) << " KiB)" << std::endl;
+        enforceBudget();
+        return texture;
+    }
+
+    // Sube los niveles desde firstLevel a la textura ya enlazada (los anteriores se saltan al reducirla).
+    // Sin mipmaps en el sampler solo se sube ese nivel.
+    void uploadCookedLevels(Texture& texture, const CookedTexture& cooked, uint32_t firstLevel) {
+        const CookedTextureFormat format = cooked.header.format;
+        texture.compressed = format != CookedTextureFormat::RGBA8 && s3tcSupported();
+        const GLenum compressedFormat = format == CookedTextureFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        const uint32_t lastLevel = texture.sampler.usesMipmaps() ? cooked.header.levelCount - 1 : firstLevel;
+
+        std::vector<uint8_t> decoded;
+        texture.bytes = 0;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (uint32_t l = firstLevel; l <= lastLevel; ++l) {
+            const CookedTextureLevel& level = cooked.levels[l];
+            const GLint target = static_cast<GLint>(l - firstLevel);
+            if (texture.compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, target, compressedFormat, level.width, level.height, 0,
+                                       static_cast<GLsizei>(level.size), cooked.levelData(l));
+                texture.bytes += level.size;
+                continue;
+            }
+            const uint8_t* pixels = cooked.levelData(l);
+            if (format != CookedTextureFormat::RGBA8) {
+                decodeBcLevel(pixels, level.width, level.height, format, decoded);
+                pixels = decoded.data();
+            }
+            glTexImage2D(GL_TEXTURE_2D, target, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            texture.bytes += static_cast<size_t>(level.width) * level.height * 4;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(lastLevel - firstLevel));
+        texture.width = static_cast<int>(cooked.levels[firstLevel].width);
+        texture.height = static_cast<int>(cooked.levels[firstLevel].height);
+    }
+
+    // Una textura cocinada se reduce volviendo a subir su cadena desde el siguiente nivel del archivo
+    bool downsizeCooked(Texture& texture) {
+        CookedTexture cooked;
+        const uint32_t firstLevel = static_cast<uint32_t>(texture.downsizeLevel + 1);
+        if (!loadCookedTexture(cookedTexturePath(texture.path), texture.path, cooked) || firstLevel >= cooked.header.levelCount) {
+            return false;
+        }
+        const size_t previousBytes = texture.bytes;
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        uploadCookedLevels(texture, cooked, firstLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        resident -= previousBytes - texture.bytes;
+        ++texture.downsizeLevel;
+        ++stats.downsizes;
+        std::cout << "Texture downsized (LRU): " << texture.path << " -> " << texture.width << "x" << texture.height << std::endl;
+        return true;
+    }
+
+    // Lee el nivel 0 de la GPU, lo reduce a la mitad con un filtro de caja y lo vuelve a subir
+    // en el mismo nombre GL. false si ya es demasiado pequeña.
+    bool downsize(Texture& texture) {
+        if (texture.width < 2 * kMinDownsizeSize || texture.height < 2 * kMinDownsizeSize) {
+            return false;
+        }
+        if (texture.cooked) {
+            return downsizeCooked(texture);
+        }
+        const int channels = texture.channels;
+        std::vector<unsigned char> full(static_cast<size_t>(texture.width) * texture.height * channels);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, formatFor(channels), GL_UNSIGNED_BYTE, full.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        const int halfWidth = texture.width / 2, halfHeight = texture.height / 2;
+        std::vector<unsigned char> half(static_cast<size_t>(halfWidth) * halfHeight * channels);
+        for (int y = 0; y < halfHeight; ++y) {
+            const unsigned char* row0 = full.data() + static_cast<size_t>(2 * y) * texture.width * channels;
+            const unsigned char* row1 = row0 + static_cast<size_t>(texture.width) * channels;
+            unsigned char* out = half.data() + static_cast<size_t>(y) * halfWidth * channels;
+            for (int x = 0; x < halfWidth; ++x) {
+                for (int c = 0; c < channels; ++c) {
+                    int sum = row0[(2 * x) * channels + c] + row0[(2 * x + 1) * channels + c] +
+                              row1[(2 * x) * channels + c] + row1[(2 * x + 1) * channels + c];
+                    out[x * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        texture.width = halfWidth;
+        texture.height = halfHeight;
+        uploadLevels(texture, half.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        size_t bytes = estimateBytes(halfWidth, halfHeight, channels, texture.sampler.usesMipmaps());
+        resident -= texture.bytes - bytes;
+        texture.bytes = bytes;
+        ++texture.downsizeLevel;
+        ++stats.downsizes;
+        std::cout << "Texture downsized (LRU): " << texture.path << " -> " << halfWidth << "x" << halfHeight << std::endl;
+        return true;
+    }
+
+    void destroy(Texture& texture) {
+        if (texture.id != 0) {
+            byId.erase(texture.id);
+            glDeleteTextures(1, &texture.id);
+            texture.id = 0;
+        }
+        resident -= texture.bytes;
+        texture.bytes = 0;
+    }
+};
@@ -0,0 +1,319 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cache de vertices ya transformados, sobre indices y sin llamadas a OpenGL: simulacion para medir
+// un orden de triangulos, optimizeVertexCache para mejorarlo (Tipsify, Sander et al. 2007) y
+// optimizeOverdraw para dibujar antes lo que tapa al resto sin perder mucha cache.
+// La cache se modela como FIFO de kVertexCacheSize entradas. ACMR = fallos por triangulo (0.5 es
+// el minimo teorico en una malla grande, 3 el peor caso) y ATVR = fallos por vertice (1 es ideal).
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+constexpr unsigned kVertexCacheSize = 16;
+
+// Margen de ACMR que se le permite perder a optimizeOverdraw al partir los grupos
+constexpr float kOverdrawCacheThreshold = 1.05f;
+
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0; // Vertices distintos que usan los indices
+    size_t misses = 0;
+
+    float acmr() const { return triangles ? static_cast<float>(misses) / triangles : 0.0f; }
+    float atvr() const { return vertices ? static_cast<float>(misses) / vertices : 0.0f; }
+
+    void add(const VertexCacheStats& other) {
+        triangles += other.triangles;
+        vertices += other.vertices;
+        misses += other.misses;
+    }
+};
+
+// Cache FIFO con marcas de tiempo: un vertice esta dentro si se inserto hace menos de cacheSize fallos
+class VertexCacheSimulator {
+public:
+    explicit VertexCacheSimulator(size_t vertexCount, unsigned cacheSize = kVertexCacheSize)
+        : insertedAt(vertexCount, 0), cacheSize(cacheSize), time(cacheSize + 1) {}
+
+    // true si fue un fallo
+    bool access(uint32_t vertex) {
+        if (time - insertedAt[vertex] > cacheSize) {
+            insertedAt[vertex] = time++;
+            return true;
+        }
+        return false;
+    }
+
+    void flush() { time += cacheSize + 1; }
+
+private:
+    std::vector<size_t> insertedAt;
+    unsigned cacheSize;
+    size_t time;
+};
+
+inline size_t maxIndexCount(const unsigned int* indices, size_t count) {
+    unsigned int highest = 0;
+    for (size_t i = 0; i < count; ++i) {
+        highest = std::max(highest, indices[i]);
+    }
+    return count ? static_cast<size_t>(highest) + 1 : 0;
+}
+
+// Lista de triangulos
+inline VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t count, unsigned cacheSize = kVertexCacheSize) {
+    VertexCacheStats stats;
+    const size_t vertexCount = maxIndexCount(indices, count);
+    VertexCacheSimulator cache(vertexCount, cacheSize);
+    std::vector<uint8_t> used(vertexCount, 0);
+    stats.triangles = count / 3;
+    for (size_t i = 0; i < count; ++i) {
+        stats.misses += cache.access(indices[i]) ? 1 : 0;
+        stats.vertices += used[indices[i]] ? 0 : 1;
+        used[indices[i]] = 1;
+    }
+    return stats;
+}
+
+// Tiras de triangulos separadas por restart. Solo cuentan los triangulos no degenerados.
+inline VertexCacheStats analyzeStripVertexCache(const uint16_t* indices, size_t count, uint16_t restart,
+                                                unsigned cacheSize = kVertexCacheSize) {
+    VertexCacheStats stats;
+    VertexCacheSimulator cache(65536, cacheSize);
+    std::vector<uint8_t> used(65536, 0);
+    size_t inStrip = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (indices[i] == restart) {
+            inStrip = 0;
+            continue;
+        }
+        stats.misses += cache.access(indices[i]) ? 1 : 0;
+        stats.vertices += used[indices[i]] ? 0 : 1;
+        used[indices[i]] = 1;
+        if (++inStrip >= 3 && indices[i] != indices[i - 1] && indices[i] != indices[i - 2] && indices[i - 1] != indices[i - 2]) {
+            ++stats.triangles;
+        }
+    }
+    return stats;
+}
+
+// Tipsify: abanica los triangulos pendientes alrededor de un vertice y elige como siguiente el
+// vecino que seguira en la cache cuando se usen sus triangulos. Los triangulos mantienen el orden
+// de sus vertices (el sentido no cambia). clusters recibe el primer triangulo de cada tramo que
+// empieza sin vecinos en la cache (los limites "duros" que usa optimizeOverdraw).
+inline void optimizeVertexCache(unsigned int* indices, size_t count, std::vector<uint32_t>* clusters = nullptr,
+                                unsigned cacheSize = kVertexCacheSize) {
+    const size_t triangleCount = count / 3;
+    const size_t vertexCount = maxIndexCount(indices, count);
+    if (clusters) {
+        clusters->clear();
+    }
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangulos de cada vertice
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        ++offsets[indices[i] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<unsigned int> out;
+    out.reserve(triangleCount * 3);
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    auto nextLive = [&]() -> int64_t {
+        while (!deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                return v;
+            }
+        }
+        while (cursor < vertexCount) {
+            if (live[cursor] > 0) {
+                return static_cast<int64_t>(cursor);
+            }
+            ++cursor;
+        }
+        return -1;
+    };
+
+    int64_t fan = nextLive();
+    while (fan >= 0) {
+        if (clusters && (clusters->empty() || candidates.empty())) {
+            clusters->push_back(static_cast<uint32_t>(out.size() / 3));
+        }
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            emitted[t] = 1;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // El candidato que lleva mas tiempo en la cache sin salirse al abanicar sus triangulos; los
+        // que se saldrian (prioridad 0) no cuentan
+        int64_t best = -1;
+        size_t bestPriority = 0;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0 || time - cacheTime[v] + 2 * live[v] > cacheSize) {
+                continue;
+            }
+            const size_t priority = time - cacheTime[v];
+            if (priority > bestPriority) {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        if (best < 0) {
+            candidates.clear(); // Ningun vecino sigue en cache: el siguiente abanico empieza un tramo nuevo
+            best = nextLive();
+        }
+        fan = best;
+    }
+    std::copy(out.begin(), out.end(), indices);
+}
+
+// Reordena los tramos de optimizeVertexCache para reducir el overdraw. Cada tramo se parte donde
+// su ACMR acumulado baja de threshold veces el del tramo entero (el orden dentro de cada trozo no
+// cambia, asi que la cache pierde como mucho ese margen). Despues los trozos se ordenan por lo que
+// miran hacia fuera: dot(centro del trozo - centro del mesh, normal del trozo), de mayor a menor.
+inline void optimizeOverdraw(unsigned int* indices, size_t count, const float* vertices, size_t vertexStride,
+                             const std::vector<uint32_t>& clusters, float threshold = kOverdrawCacheThreshold,
+                             unsigned cacheSize = kVertexCacheSize) {
+    const size_t triangleCount = count / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+    VertexCacheSimulator cache(maxIndexCount(indices, count), cacheSize);
+    auto triangleMisses = [&](size_t t) {
+        return (cache.access(indices[t * 3]) ? 1u : 0u) + (cache.access(indices[t * 3 + 1]) ? 1u : 0u) +
+               (cache.access(indices[t * 3 + 2]) ? 1u : 0u);
+    };
+
+    // Limites blandos dentro de cada tramo
+    std::vector<uint32_t> starts;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const size_t begin = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            clusterMisses += triangleMisses(t);
+        }
+        const float limit = threshold * clusterMisses / static_cast<float>(end - begin);
+
+        starts.push_back(static_cast<uint32_t>(begin));
+        cache.flush();
+        size_t runMisses = 0, runTriangles = 0;
+        for (size_t t = begin; t < end; ++t) {
+            runMisses += triangleMisses(t);
+            ++runTriangles;
+            if (static_cast<float>(runMisses) / runTriangles <= limit && t + 1 < end) {
+                starts.push_back(static_cast<uint32_t>(t + 1));
+                cache.flush();
+                runMisses = runTriangles = 0;
+            }
+        }
+    }
+
+    // Centro y normal (ponderados por area) de cada trozo y del mesh
+    auto position = [&](unsigned int v) {
+        const float* p = vertices + static_cast<size_t>(v) * vertexStride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    struct Piece {
+        uint32_t begin, end;
+        glm::vec3 centroid, normal;
+        float area;
+        float sortKey;
+    };
+    std::vector<Piece> pieces(starts.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t p = 0; p < starts.size(); ++p) {
+        Piece& piece = pieces[p];
+        piece.begin = starts[p];
+        piece.end = p + 1 < starts.size() ? starts[p + 1] : static_cast<uint32_t>(triangleCount);
+        piece.centroid = piece.normal = glm::vec3(0.0f);
+        piece.area = 0.0f;
+        for (uint32_t t = piece.begin; t < piece.end; ++t) {
+            glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c - a); // Largo = 2 * area
+            float area = glm::length(n);
+            piece.centroid += (a + b + c) * (area / 3.0f);
+            piece.normal += n;
+            piece.area += area;
+        }
+        meshCentroid += piece.centroid;
+        meshArea += piece.area;
+        if (piece.area > 0.0f) {
+            piece.centroid = piece.centroid * (1.0f / piece.area);
+        }
+        float normalLength = glm::length(piece.normal);
+        if (normalLength > 0.0f) {
+            piece.normal = piece.normal * (1.0f / normalLength);
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid = meshCentroid * (1.0f / meshArea);
+    }
+    for (Piece& piece : pieces) {
+        piece.sortKey = glm::dot(piece.centroid - meshCentroid, piece.normal);
+    }
+    std::stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> out;
+    out.reserve(triangleCount * 3);
+    for (const Piece& piece : pieces) {
+        out.insert(out.end(), indices + piece.begin * 3, indices + piece.end * 3);
+    }
+    std::copy(out.begin(), out.end(), indices);
+}
@@ -0,0 +1,926 @@
+
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Microbenchmarks de las rutas calientes de CPU (sin ventana ni contexto OpenGL).
+//
+// Compilar:  g++ -O2 -std=c++17 bench.cpp -o bench -lassimp -pthread   (añadir -mavx2 para los lotes con AVX2)
+// Uso:       ./bench [--quick] [--filter <texto>] [--model Resources/model.dae] [--out bench.json]
+//
+// Imprime un documento JSON con ns/op, throughput y reservas de memoria por op
+// para cada kernel y cada combinacion de parametros del barrido.
+
+#include "Terrain.hpp"
+#include "TerrainLod.hpp"
+#include "Bvh.hpp"
+#include "Animation.hpp"
+#include "AnimationCompression.hpp"
+#include "MeshData.hpp"
+#include "MeshOptimize.hpp"
+#include "AnimationWorkers.hpp"
+#include "AnimationLod.hpp"
+#include "PoseBaking.hpp"
+#include "ModelImport.hpp"
+#include "BakedModel.hpp"
+#include "CpuSkinning.hpp"
+#include "PackedVertex.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// --- Contador global de reservas de memoria ---
+static std::atomic<unsigned long long> g_allocCount{0};
+static std::atomic<unsigned long long> g_allocBytes{0};
+
+void* operator new(std::size_t size) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Evita que el compilador elimine el resultado de los kernels
+static volatile float g_sink = 0.0f;
+
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, long long>> params;
+    long long iterations;
+    double nsPerOp;
+    double itemsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+struct BenchOptions {
+    double minSeconds = 0.25;
+    std::string filter;
+    std::string modelPath;
+    std::string outPath;
+};
+
+static BenchOptions g_options;
+static std::vector<BenchResult> g_results;
+
+// Ejecuta fn() en bucle hasta acumular al menos minSeconds y registra el resultado.
+// itemsPerOp es el numero de elementos (consultas, vertices, huesos...) que procesa una llamada.
+template <typename Fn>
+void runBench(const std::string& name, std::vector<std::pair<std::string, long long>> params,
+              double itemsPerOp, Fn&& fn) {
+    std::string fullName = name;
+    for (const auto& p : params) {
+        fullName += "/" + p.first + ":" + std::to_string(p.second);
+    }
+    if (!g_options.filter.empty() && fullName.find(g_options.filter) == std::string::npos) {
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+    fn(); // Calentamiento (caches, primeras reservas)
+
+    long long iterations = 1;
+    double elapsedNs = 0.0;
+    unsigned long long allocs = 0, bytes = 0;
+    while (true) {
+        unsigned long long allocsBefore = g_allocCount.load();
+        unsigned long long bytesBefore = g_allocBytes.load();
+        auto start = clock::now();
+        for (long long i = 0; i < iterations; ++i) {
+            fn();
+        }
+        elapsedNs = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        allocs = g_allocCount.load() - allocsBefore;
+        bytes = g_allocBytes.load() - bytesBefore;
+        if (elapsedNs >= g_options.minSeconds * 1e9 || iterations >= (1LL << 40)) {
+            break;
+        }
+        // Estimar cuantas iteraciones hacen falta para llegar al tiempo minimo
+        double scale = elapsedNs > 0.0 ? (g_options.minSeconds * 1e9 * 1.2) / elapsedNs : 10.0;
+        scale = std::min(std::max(scale, 2.0), 100.0);
+        iterations = static_cast<long long>(iterations * scale);
+    }
+
+    BenchResult r;
+    r.name = name;
+    r.params = std::move(params);
+    r.iterations = iterations;
+    r.nsPerOp = elapsedNs / iterations;
+    r.itemsPerOp = itemsPerOp;
+    r.allocsPerOp = static_cast<double>(allocs) / iterations;
+    r.bytesPerOp = static_cast<double>(bytes) / iterations;
+    g_results.push_back(r);
+    std::cerr << fullName << ": " << r.nsPerOp << " ns/op, " << r.allocsPerOp << " allocs/op" << std::endl;
+}
+
+static void writeJson(std::ostream& os) {
+    os << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        const BenchResult& r = g_results[i];
+        double opsPerSec = r.nsPerOp > 0.0 ? 1e9 / r.nsPerOp : 0.0;
+        os << "    {\"name\": \"" << r.name << "\", \"params\": {";
+        for (size_t p = 0; p < r.params.size(); ++p) {
+            os << (p ? ", " : "") << "\"" << r.params[p].first << "\": " << r.params[p].second;
+        }
+        os << "}, \"iterations\": " << r.iterations
+           << ", \"ns_per_op\": " << r.nsPerOp
+           << ", \"ops_per_sec\": " << opsPerSec
+           << ", \"items_per_op\": " << r.itemsPerOp
+           << ", \"ns_per_item\": " << (r.itemsPerOp > 0.0 ? r.nsPerOp / r.itemsPerOp : 0.0)
+           << ", \"items_per_sec\": " << opsPerSec * r.itemsPerOp
+           << ", \"allocs_per_op\": " << r.allocsPerOp
+           << ", \"bytes_allocated_per_op\": " << r.bytesPerOp << "}"
+           << (i + 1 < g_results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// --- Datos sinteticos ---
+
+// Heightmap aleatorio suavizado, con el mismo layout que devuelve stbi_load (8 bits, N canales)
+static std::vector<unsigned char> makeHeightmap(int width, int height, int channels, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<unsigned char> data(static_cast<size_t>(width) * height * channels);
+    for (int z = 0; z < height; ++z) {
+        for (int x = 0; x < width; ++x) {
+            int v = (x * 7 + z * 3 + dist(rng) / 8) & 0xff;
+            for (int c = 0; c < channels; ++c) {
+                data[(static_cast<size_t>(z) * width + x) * channels + c] = static_cast<unsigned char>(v);
+            }
+        }
+    }
+    return data;
+}
+
+static std::string boneName(int i) {
+    return "Bone_" + std::to_string(i);
+}
+
+static std::map<std::string, Bone> makeBones(int boneCount) {
+    std::map<std::string, Bone> bones;
+    for (int b = 0; b < boneCount; ++b) {
+        Bone bone;
+        bone.name = boneName(b);
+        bone.id = b;
+        bone.offsetMatrix = glm::mat4(1.0f);
+        bones[bone.name] = bone;
+    }
+    return bones;
+}
+
+// Animacion con keyCount keys por canal para los huesos [0, boneCount), construida como
+// aiAnimation y convertida con el mismo codigo que usa AnimatedModel al cargar.
+static Animation makeAnimation(int boneCount, int keyCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    aiAnimation* anim = new aiAnimation();
+    anim->mName.Set("synthetic");
+    anim->mDuration = keyCount > 1 ? keyCount - 1 : 1;
+    anim->mTicksPerSecond = 25.0;
+    anim->mNumChannels = boneCount;
+    anim->mChannels = new aiNodeAnim*[boneCount];
+    for (int b = 0; b < boneCount; ++b) {
+        aiNodeAnim* channel = new aiNodeAnim();
+        channel->mNodeName.Set(boneName(b));
+        channel->mNumPositionKeys = channel->mNumRotationKeys = channel->mNumScalingKeys = keyCount;
+        channel->mPositionKeys = new aiVectorKey[keyCount];
+        channel->mRotationKeys = new aiQuatKey[keyCount];
+        channel->mScalingKeys = new aiVectorKey[keyCount];
+        for (int k = 0; k < keyCount; ++k) {
+            channel->mPositionKeys[k].mTime = k;
+            channel->mPositionKeys[k].mValue = aiVector3D(dist(rng), dist(rng), dist(rng));
+            channel->mScalingKeys[k].mTime = k;
+            channel->mScalingKeys[k].mValue = aiVector3D(1.0f, 1.0f, 1.0f);
+            glm::quat q = glm::normalize(glm::quat(1.0f, dist(rng) * 0.3f, dist(rng) * 0.3f, dist(rng) * 0.3f));
+            channel->mRotationKeys[k].mTime = k;
+            channel->mRotationKeys[k].mValue = aiQuaternion(q.w, q.x, q.y, q.z);
+        }
+        anim->mChannels[b] = channel;
+    }
+    Animation animation = convertAnimation(anim, makeBones(boneCount));
+    delete anim;
+    return animation;
+}
+
+// Jerarquia de nodos estilo Assimp: cada hueso cuelga de uno anterior elegido al azar.
+// El aiNode raiz es dueño de todos sus hijos (se libera con delete root).
+static aiNode* makeNodeHierarchy(int boneCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<aiNode*> nodes;
+    std::vector<std::vector<aiNode*>> children(boneCount + 1);
+    aiNode* root = new aiNode();
+    root->mName.Set("RootNode");
+    nodes.push_back(root);
+    for (int b = 0; b < boneCount; ++b) {
+        aiNode* node = new aiNode();
+        node->mName.Set(boneName(b));
+        std::uniform_int_distribution<int> parentDist(std::max(0, static_cast<int>(nodes.size()) - 4), static_cast<int>(nodes.size()) - 1);
+        int parent = parentDist(rng);
+        node->mParent = nodes[parent];
+        children[parent].push_back(node);
+        nodes.push_back(node);
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (children[i].empty()) {
+            continue;
+        }
+        nodes[i]->mNumChildren = static_cast<unsigned int>(children[i].size());
+        nodes[i]->mChildren = new aiNode*[children[i].size()];
+        std::copy(children[i].begin(), children[i].end(), nodes[i]->mChildren);
+    }
+    return root;
+}
+
+// aiMesh de una rejilla triangulada con 4 influencias de hueso por vertice.
+// Se libera con delete (el destructor de aiMesh libera sus arreglos).
+static aiMesh* makeSkinnedMesh(int vertexCount, int boneCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    int side = std::max(2, static_cast<int>(std::sqrt(static_cast<double>(vertexCount))));
+    int numVertices = side * side;
+
+    aiMesh* mesh = new aiMesh();
+    mesh->mNumVertices = numVertices;
+    mesh->mVertices = new aiVector3D[numVertices];
+    mesh->mNormals = new aiVector3D[numVertices];
+    mesh->mTextureCoords[0] = new aiVector3D[numVertices];
+    for (int i = 0; i < numVertices; ++i) {
+        mesh->mVertices[i] = aiVector3D(static_cast<float>(i % side), dist(rng), static_cast<float>(i / side));
+        mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+        mesh->mTextureCoords[0][i] = aiVector3D(static_cast<float>(i % side) / side, static_cast<float>(i / side) / side, 0.0f);
+    }
+
+    int quads = (side - 1) * (side - 1);
+    mesh->mNumFaces = quads * 2;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    int f = 0;
+    for (int z = 0; z < side - 1; ++z) {
+        for (int x = 0; x < side - 1; ++x) {
+            unsigned int i0 = z * side + x, i1 = i0 + 1, i2 = i0 + side, i3 = i2 + 1;
+            unsigned int tris[2][3] = {{i0, i2, i1}, {i1, i2, i3}};
+            for (auto& t : tris) {
+                mesh->mFaces[f].mNumIndices = 3;
+                mesh->mFaces[f].mIndices = new unsigned int[3]{t[0], t[1], t[2]};
+                ++f;
+            }
+        }
+    }
+
+    // Cada vertice recibe 4 huesos consecutivos con pesos 0.4/0.3/0.2/0.1
+    std::vector<std::vector<aiVertexWeight>> weights(boneCount);
+    const float w[4] = {0.4f, 0.3f, 0.2f, 0.1f};
+    for (int v = 0; v < numVertices; ++v) {
+        for (int k = 0; k < 4; ++k) {
+            aiVertexWeight vw;
+            vw.mVertexId = v;
+            vw.mWeight = w[k];
+            weights[(v + k) % boneCount].push_back(vw);
+        }
+    }
+    mesh->mNumBones = boneCount;
+    mesh->mBones = new aiBone*[boneCount];
+    for (int b = 0; b < boneCount; ++b) {
+        aiBone* bone = new aiBone();
+        bone->mName.Set(boneName(b));
+        bone->mNumWeights = static_cast<unsigned int>(weights[b].size());
+        bone->mWeights = new aiVertexWeight[weights[b].size()];
+        std::copy(weights[b].begin(), weights[b].end(), bone->mWeights);
+        mesh->mBones[b] = bone;
+    }
+    return mesh;
+}
+
+// --- Benchmarks ---
+
+static void benchTerrainHeight() {
+    const float terrainWidth = 512.0f, terrainDepth = 512.0f, terrainBaseY = -16.01f, heightScale = 30.0f;
+    for (int size : {256, 1024, 4096}) {
+        const int channels = 3;
+        std::vector<unsigned char> heightmap = makeHeightmap(size, size, channels, 1);
+        TerrainHeightField field(terrainWidth, terrainDepth, terrainBaseY, heightScale);
+        field.loadFromImage(heightmap.data(), size, size, channels);
+        for (int batch : {1, 200, 10000}) {
+            std::mt19937 rng(2);
+            std::uniform_real_distribution<float> dist(-terrainWidth / 2.0f, terrainWidth / 2.0f);
+            std::vector<float> xs(batch), zs(batch), heights(batch), slopes(batch);
+            std::vector<glm::vec3> normals(batch);
+            for (int i = 0; i < batch; ++i) {
+                xs[i] = dist(rng);
+                zs[i] = dist(rng);
+            }
+            runBench("terrain_height", {{"heightmap", size}, {"batch", batch}}, batch, [&] {
+                float acc = 0.0f;
+                for (int i = 0; i < batch; ++i) {
+                    acc += field.heightAt(xs[i], zs[i]);
+                }
+                g_sink = acc;
+            });
+            runBench("terrain_height_batch", {{"heightmap", size}, {"batch", batch}}, batch, [&] {
+                field.heights(xs.data(), zs.data(), heights.data(), batch);
+                g_sink = heights.back();
+            });
+            runBench("terrain_normal_batch", {{"heightmap", size}, {"batch", batch}}, batch, [&] {
+                field.normals(xs.data(), zs.data(), normals.data(), batch);
+                g_sink = normals.back().y;
+            });
+            runBench("terrain_slope_batch", {{"heightmap", size}, {"batch", batch}}, batch, [&] {
+                field.slopes(xs.data(), zs.data(), slopes.data(), batch);
+                g_sink = slopes.back();
+            });
+        }
+    }
+}
+
+static void benchTerrainGrid() {
+    for (int resolution : {64, 256, 1024}) {
+        double vertices = static_cast<double>(resolution) * resolution;
+        runBench("terrain_grid_vertices", {{"resolution", resolution}}, vertices, [&] {
+            std::vector<float> v = generateTerrainGridVertices(resolution, resolution, 512.0f, 512.0f, -16.01f);
+            g_sink = v.back();
+        });
+        runBench("terrain_grid_indices", {{"resolution", resolution}}, vertices, [&] {
+            std::vector<unsigned int> idx = generateTerrainGridIndices(resolution, resolution);
+            g_sink = static_cast<float>(idx.back());
+        });
+    }
+
+    // Horneado de posiciones, normales y pendiente (lo que antes hacia el vertex shader), por filas en paralelo
+    const int heightmapSize = 256;
+    std::vector<unsigned char> heightmap = makeHeightmap(heightmapSize, heightmapSize, 3, 1);
+    TerrainHeightField field(512.0f, 512.0f, -16.01f, 30.0f);
+    field.loadFromImage(heightmap.data(), heightmapSize, heightmapSize, 3);
+    std::vector<unsigned> threadCounts = {1, std::max(1u, std::thread::hardware_concurrency())};
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+    for (int resolution : {64, 256, 1024}) {
+        std::vector<float> vertices(static_cast<size_t>(resolution) * resolution * kTerrainBakedVertexFloats);
+        for (unsigned threads : threadCounts) {
+            AnimationWorkerPool pool(threads);
+            runBench("terrain_grid_bake", {{"resolution", resolution}, {"threads", threads}},
+                     static_cast<double>(resolution) * resolution, [&] {
+                pool.parallelFor(resolution, 8, [&](size_t zBegin, size_t zEnd) {
+                    bakeTerrainGridRows(field, resolution, resolution, 512.0f, 512.0f, 1.0f / heightmapSize,
+                                        static_cast<int>(zBegin), static_cast<int>(zEnd), vertices.data());
+                });
+                g_sink = vertices.back();
+            });
+        }
+    }
+}
+
+// Seleccion de bloques del terreno: LOD por distancia, vecinos a un nivel y descarte por frustum.
+// La camara mira en horizontal desde el centro, como la camara en tercera persona del juego.
+static void benchTerrainLod() {
+    const float terrainSize = 512.0f;
+    for (int resolution : {257, 1025}) {
+        std::vector<unsigned char> heightmap = makeHeightmap(256, 256, 1, 1);
+        TerrainHeightField field(terrainSize, terrainSize, -16.01f, 30.0f);
+        field.loadFromImage(heightmap.data(), 256, 256, 1);
+        std::vector<float> vertices(static_cast<size_t>(resolution) * resolution * kTerrainBakedVertexFloats);
+        bakeTerrainGridRows(field, resolution, resolution, terrainSize, terrainSize, 1.0f / 256, 0, resolution, vertices.data());
+
+        glm::vec3 camera(0.0f, 10.0f, 10.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 500.0f);
+        glm::mat4 view = glm::lookAt(camera, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        for (int chunkQuads : {16, 32, 64}) {
+            TerrainQuadtree quadtree;
+            quadtree.build(vertices.data(), resolution, resolution, kTerrainBakedVertexFloats, chunkQuads);
+            std::vector<TerrainChunkDraw> draws;
+            quadtree.select(frustum, camera, 64.0f, draws);
+            runBench("terrain_lod_select",
+                     {{"resolution", resolution}, {"chunk", chunkQuads}, {"chunks", quadtree.chunkCount()},
+                      {"visible", quadtree.lastVisibleChunks()}, {"triangles", static_cast<long long>(quadtree.lastTriangleCount())},
+                      {"full_triangles", 2LL * (resolution - 1) * (resolution - 1)}},
+                     quadtree.chunkCount(), [&] {
+                quadtree.select(frustum, camera, 64.0f, draws);
+                g_sink = static_cast<float>(draws.size());
+            });
+        }
+    }
+}
+
+// Culling de objetos con la BVH frente a probar todas las cajas, con la camara del juego.
+// scene_cull_moving mueve un 10% de los objetos cada frame (reajustes y reconstrucciones incluidos).
+static void benchSceneCull() {
+    glm::vec3 camera(0.0f, 10.0f, 10.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 500.0f);
+    glm::mat4 view = glm::lookAt(camera, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    for (int objects : {200, 2000, 20000}) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> posDist(-400.0f, 400.0f);
+        std::vector<glm::vec3> positions(objects);
+        std::vector<Aabb> boxes(objects);
+        Bvh bvh;
+        for (int i = 0; i < objects; ++i) {
+            positions[i] = glm::vec3(posDist(rng), 0.0f, posDist(rng));
+            boxes[i].min = positions[i] - glm::vec3(2.0f, 0.0f, 2.0f);
+            boxes[i].max = positions[i] + glm::vec3(2.0f, 10.0f, 2.0f);
+            bvh.add(boxes[i], i, i % 10 == 0 ? 1.0f : 0.0f);
+        }
+        bvh.build();
+        std::vector<uint32_t> visible;
+        visible.reserve(objects);
+        bvh.cull(frustum, visible);
+        const long long visibleCount = static_cast<long long>(visible.size());
+
+        runBench("scene_cull_brute", {{"objects", objects}, {"visible", visibleCount}}, objects, [&] {
+            visible.clear();
+            for (int i = 0; i < objects; ++i) {
+                if (frustum.intersects(boxes[i])) {
+                    visible.push_back(i);
+                }
+            }
+            g_sink = static_cast<float>(visible.size());
+        });
+        runBench("scene_cull_bvh", {{"objects", objects}, {"visible", visibleCount},
+                                    {"nodes_tested", static_cast<long long>(bvh.lastNodesTested())}}, objects, [&] {
+            visible.clear();
+            bvh.cull(frustum, visible);
+            g_sink = static_cast<float>(visible.size());
+        });
+
+        float phase = 0.0f;
+        runBench("scene_cull_moving", {{"objects", objects}, {"moving", objects / 10}}, objects, [&] {
+            phase += 0.05f;
+            glm::vec3 offset(std::sin(phase) * 3.0f, 0.0f, std::cos(phase) * 3.0f);
+            for (int i = 0; i < objects; i += 10) {
+                Aabb box = boxes[i];
+                box.min += offset;
+                box.max += offset;
+                bvh.update(i, box);
+            }
+            bvh.refresh();
+            visible.clear();
+            bvh.cull(frustum, visible);
+            g_sink = static_cast<float>(visible.size());
+        });
+    }
+}
+
+static void benchKeyframeInterpolation() {
+    const int boneCount = 64;
+    for (int keyCount : {2, 30, 300, 3000, 30000}) {
+        Animation anim = makeAnimation(boneCount, keyCount, 3);
+        AnimationCursor cursor;
+        cursor.reset(anim.tracks.size());
+        // El tiempo avanza como en el juego (a 60 FPS) para que el patron de acceso sea realista
+        float animTime = 0.0f;
+        const float step = anim.ticksPerSecond / 60.0f;
+        runBench("keyframe_interpolation", {{"bones", boneCount}, {"keys", keyCount}}, boneCount, [&] {
+            animTime = std::fmod(animTime + step, anim.duration);
+            glm::mat4 acc(0.0f);
+            for (int b = 0; b < boneCount; ++b) {
+                acc += getInterpolatedBoneTransform(anim, b, animTime, cursor);
+            }
+            g_sink = acc[3][0];
+        });
+
+        // Saltos aleatorios en el clip: el cursor no sirve y se usa la busqueda binaria
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> timeDist(0.0f, anim.duration);
+        std::vector<float> seekTimes(256);
+        for (float& t : seekTimes) {
+            t = timeDist(rng);
+        }
+        size_t seek = 0;
+        runBench("keyframe_interpolation_seek", {{"bones", boneCount}, {"keys", keyCount}}, boneCount, [&] {
+            float t = seekTimes[seek++ & 255];
+            glm::mat4 acc(0.0f);
+            for (int b = 0; b < boneCount; ++b) {
+                acc += getInterpolatedBoneTransform(anim, b, t, cursor);
+            }
+            g_sink = acc[3][0];
+        });
+    }
+}
+
+// Compresion al importar y descompresion al reproducir un clip (lo que cuesta un fallo de la LRU)
+static void benchAnimationCompression() {
+    const int boneCount = 64;
+    for (int keyCount : {30, 300}) {
+        Animation anim = makeAnimation(boneCount, keyCount, 5);
+        const long long keys = static_cast<long long>(animationKeyCount(anim));
+        runBench("clip_compress", {{"bones", boneCount}, {"keys", keyCount}}, keys, [&] {
+            CompressedAnimation clip = compressAnimation(anim);
+            g_sink = static_cast<float>(clip.rotationKeys.size());
+        });
+        CompressedAnimation clip = compressAnimation(anim);
+        runBench("clip_decompress", {{"bones", boneCount}, {"keys", keyCount}}, keys, [&] {
+            Animation decompressed = decompressAnimation(clip);
+            g_sink = decompressed.rotationKeys.back().value.w;
+        });
+    }
+}
+
+static void benchBoneHierarchy() {
+    const int keyCount = 30;
+    for (int boneCount : {16, 64, 256}) {
+        Animation anim = makeAnimation(boneCount, keyCount, 4);
+        std::map<std::string, Bone> bones = makeBones(boneCount);
+        aiNode* root = makeNodeHierarchy(boneCount, 5);
+        Skeleton skeleton = buildSkeleton(root, bones);
+        delete root;
+        std::vector<glm::mat4> globalTransforms(skeleton.nodeCount());
+        std::vector<glm::mat4> boneTransforms(skeleton.boneCount(), glm::mat4(1.0f));
+        AnimationCursor cursor;
+        cursor.reset(anim.tracks.size());
+        float animTime = 0.0f;
+        const float step = anim.ticksPerSecond / 60.0f;
+        runBench("bone_hierarchy", {{"bones", boneCount}, {"keys", keyCount}}, boneCount, [&] {
+            animTime = std::fmod(animTime + step, anim.duration);
+            calculateBoneTransformations(skeleton, &anim, animTime, &cursor, globalTransforms, boneTransforms);
+            g_sink = boneTransforms.back()[3][0];
+        });
+    }
+}
+
+// Mezcla de locomocion: N clips muestreados a poses locales, mezclados y una sola paleta.
+// clips = 0 es el camino de un solo clip sin poses intermedias, como referencia.
+static void benchPoseBlend() {
+    const int boneCount = 64, keyCount = 30;
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    aiNode* root = makeNodeHierarchy(boneCount, 11);
+    Skeleton skeleton = buildSkeleton(root, bones);
+    delete root;
+    std::vector<Animation> clips;
+    for (unsigned c = 0; c < 4; ++c) {
+        clips.push_back(makeAnimation(boneCount, keyCount, 20 + c));
+    }
+
+    for (int clipCount : {0, 1, 2, 4}) {
+        AnimationState state;
+        if (clipCount == 0) {
+            state.init(skeleton, &clips[0]);
+        } else {
+            std::vector<const Animation*> layers;
+            std::vector<float> weights;
+            for (int c = 0; c < clipCount; ++c) {
+                layers.push_back(&clips[c]);
+                weights.push_back(1.0f);
+            }
+            state.initLayers(skeleton, layers, 0);
+            state.setLayerTargets(weights.data());
+            state.fadeSeconds = 0.0f;
+        }
+        runBench("pose_blend", {{"clips", clipCount}, {"bones", boneCount}}, boneCount, [&] {
+            state.update(1.0f / 60.0f);
+            g_sink = state.boneTransforms.back()[3][0];
+        });
+    }
+
+    std::vector<LocalPose> poses(4);
+    for (LocalPose& pose : poses) {
+        pose.resize(boneCount);
+        for (int b = 0; b < boneCount; ++b) {
+            pose.set(b, glm::vec3(0.1f * b), glm::normalize(glm::quat(1.0f, 0.01f * b, 0.0f, 0.0f)), glm::vec3(1.0f));
+        }
+    }
+    const LocalPose* inputs[4] = {&poses[0], &poses[1], &poses[2], &poses[3]};
+    const float weights[4] = {0.4f, 0.3f, 0.2f, 0.1f};
+    LocalPose blended;
+    for (int clipCount : {2, 4}) {
+        runBench("pose_blend_only", {{"clips", clipCount}, {"bones", boneCount}}, boneCount, [&] {
+            blendLocalPoses(inputs, weights, clipCount, blended);
+            g_sink = blended.data[0];
+        });
+    }
+}
+
+// Muchos personajes que comparten esqueleto y clip, cada uno con su propio tiempo y paleta
+static void benchCrowdUpdate() {
+    const int boneCount = 64, keyCount = 30;
+    Animation anim = makeAnimation(boneCount, keyCount, 8);
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    aiNode* root = makeNodeHierarchy(boneCount, 9);
+    Skeleton skeleton = buildSkeleton(root, bones);
+    delete root;
+
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts = {1, 2, 4};
+    if (hardwareThreads > 4) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    for (int instances : {1, 100, 1000}) {
+        std::vector<AnimationState> states(instances);
+        std::vector<AnimationState*> statePtrs;
+        for (int i = 0; i < instances; ++i) {
+            states[i].init(skeleton, &anim);
+            states[i].animationTime = std::fmod(i * 0.37f, anim.duration);
+            statePtrs.push_back(&states[i]);
+        }
+        for (unsigned threads : threadCounts) {
+            AnimationWorkerPool pool(threads);
+            runBench("crowd_update", {{"instances", instances}, {"bones", boneCount}, {"threads", threads}},
+                     instances, [&] {
+                pool.updateAnimations(statePtrs, 1.0f / 60.0f);
+                g_sink = states.back().boneTransforms[0][3][0];
+            });
+        }
+    }
+
+    // La misma multitud con LOD de animacion: 10% cerca, 20% a media distancia, 40% lejos (sin la
+    // mitad de los huesos, los de menos peso) y 30% fuera de pantalla
+    std::vector<float> influence(boneCount);
+    for (int b = 0; b < boneCount; ++b) {
+        influence[b] = b < boneCount / 2 ? 1.9f / boneCount : 0.1f / boneCount;
+    }
+    std::vector<uint8_t> lowDetailBones = lowInfluenceBones(skeleton, influence, AnimationLodSettings().boneInfluenceThreshold);
+    for (int instances : {100, 1000}) {
+        std::vector<AnimationState> states(instances);
+        AnimationLodScheduler scheduler;
+        for (float& budget : scheduler.settings.budgetMs) {
+            budget = 1e9f; // Intervalos nominales: se mide el LOD, no la adaptacion al presupuesto
+        }
+        for (int i = 0; i < instances; ++i) {
+            states[i].init(skeleton, &anim);
+            states[i].animationTime = std::fmod(i * 0.37f, anim.duration);
+            scheduler.add(&states[i], &lowDetailBones);
+            int slot = i % 10;
+            scheduler.setTier(i, slot < 1 ? AnimationLodTier::Full : slot < 3 ? AnimationLodTier::Reduced
+                                 : slot < 7 ? AnimationLodTier::Far : AnimationLodTier::Offscreen);
+        }
+        for (unsigned threads : threadCounts) {
+            AnimationWorkerPool pool(threads);
+            runBench("crowd_update_lod", {{"instances", instances}, {"bones", boneCount}, {"threads", threads}},
+                     instances, [&] {
+                scheduler.update(pool, 1.0f / 60.0f);
+                g_sink = states.back().boneTransforms[0][3][0];
+            });
+        }
+    }
+
+    // Multitud con poses horneadas: el coste en CPU es avanzar el reloj y elegir el frame
+    BakedPoses poses;
+    beginBakedPoses(skeleton, kBakedPoseFramesPerSecond, poses);
+    runBench("pose_bake", {{"bones", boneCount}, {"frames", static_cast<long long>(std::lround(anim.duration / anim.ticksPerSecond * kBakedPoseFramesPerSecond))}},
+             1, [&] {
+        BakedPoses clip;
+        beginBakedPoses(skeleton, kBakedPoseFramesPerSecond, clip);
+        appendBakedPoseClip(skeleton, anim, clip);
+        g_sink = clip.texels.back().x;
+    });
+    appendBakedPoseClip(skeleton, anim, poses);
+    for (int instances : {100, 1000}) {
+        std::vector<AnimationState> states(instances);
+        for (int i = 0; i < instances; ++i) {
+            states[i].init(skeleton, &anim);
+            states[i].animationTime = std::fmod(i * 0.37f, anim.duration);
+        }
+        runBench("crowd_baked_playback", {{"instances", instances}, {"bones", boneCount}}, instances, [&] {
+            size_t texel = 0;
+            for (AnimationState& state : states) {
+                state.advance(1.0f / 60.0f);
+                texel += poses.frameTexel(0, state.animationTime / anim.duration);
+            }
+            g_sink = static_cast<float>(texel);
+        });
+    }
+}
+
+static void benchMeshImport() {
+    const int boneCount = 32;
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    for (int vertexCount : {1000, 10000, 100000}) {
+        aiMesh* mesh = makeSkinnedMesh(vertexCount, boneCount, 6);
+        runBench("mesh_import", {{"vertices", static_cast<long long>(mesh->mNumVertices)}, {"bones", boneCount}},
+                 mesh->mNumVertices, [&] {
+            MeshData data;
+            buildMeshData(mesh, bones, data);
+            g_sink = data.vertices.back();
+        });
+        delete mesh;
+    }
+}
+
+// Soldado y orden para la cache, el overdraw y la lectura de vertices (importModel lo hace con cada mesh)
+static void benchMeshOptimize() {
+    const int boneCount = 32;
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    for (int vertexCount : {10000, 100000}) {
+        aiMesh* mesh = makeSkinnedMesh(vertexCount, boneCount, 12);
+        MeshData source;
+        buildMeshData(mesh, bones, source);
+        delete mesh;
+        const long long triangles = static_cast<long long>(source.indices.size() / 3);
+        MeshData data;
+        runBench("mesh_optimize", {{"vertices", static_cast<long long>(source.vertices.size() / 8)}, {"triangles", triangles}},
+                 triangles, [&] {
+            data = source;
+            MeshOptimizeReport report;
+            optimizeMesh(data, report);
+            g_sink = report.after.acmr();
+        });
+    }
+}
+
+// Empaquetado de vertices a PackedSkinnedVertex (lo que hace ModelAsset al subir cada mesh)
+static void benchVertexPack() {
+    const int boneCount = 32;
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    for (int vertexCount : {10000, 100000}) {
+        aiMesh* mesh = makeSkinnedMesh(vertexCount, boneCount, 11);
+        MeshData data;
+        buildMeshData(mesh, bones, data);
+        delete mesh;
+        const size_t count = data.vertices.size() / 8;
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        expandPackedVertexBounds(data.vertices.data(), count, 8, lo, hi);
+        const PackedVertexBounds bounds = packedVertexBounds(lo, hi);
+        std::vector<PackedSkinnedVertex> packed;
+        runBench("vertex_pack", {{"vertices", static_cast<long long>(count)},
+                                 {"bytes_per_vertex", static_cast<long long>(sizeof(PackedSkinnedVertex))}},
+                 count, [&] {
+            packSkinnedVertices(data.vertices.data(), count, data.boneIDsData.data(), data.boneWeightsData.data(), bounds, packed);
+            g_sink = packed.back().weights[0];
+        });
+    }
+}
+
+// Skinning en CPU: el kernel escalar frente al despacho (AVX2 si se compilo con -mavx2) en un hilo,
+// y skinMeshes repartiendo 8 personajes entre varios hilos
+static void benchCpuSkinning() {
+    const int boneCount = 64;
+    std::map<std::string, Bone> bones = makeBones(boneCount);
+    std::vector<glm::mat4> palette(boneCount);
+    for (int b = 0; b < boneCount; ++b) {
+        palette[b] = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.1f * b, 0.0f, 0.0f)),
+                                 0.05f * b, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts = {1, 2, 4};
+    if (hardwareThreads > 4) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    for (int vertexCount : {10000, 100000}) {
+        aiMesh* mesh = makeSkinnedMesh(vertexCount, boneCount, 10);
+        MeshData data;
+        buildMeshData(mesh, bones, data);
+        delete mesh;
+        SkinningSource source;
+        source.vertices = data.vertices.data();
+        source.boneIDs = data.boneIDsData.data();
+        source.boneWeights = data.boneWeightsData.data();
+        source.vertexCount = data.vertices.size() / 8;
+        const long long vertices = static_cast<long long>(source.vertexCount);
+        std::vector<float> out(source.vertexCount * kCpuSkinnedVertexFloats);
+
+        runBench("cpu_skinning_scalar", {{"vertices", vertices}, {"bones", boneCount}}, vertices, [&] {
+            skinVerticesScalar(palette.data(), palette.size(), source, 0, source.vertexCount, out.data());
+            g_sink = out.back();
+        });
+        runBench("cpu_skinning_simd", {{"vertices", vertices}, {"bones", boneCount}}, vertices, [&] {
+            skinVertices(palette.data(), palette.size(), source, 0, source.vertexCount, out.data());
+            g_sink = out.back();
+        });
+
+        const int characters = 8;
+        std::vector<std::vector<float>> outputs(characters, std::vector<float>(out.size()));
+        std::vector<SkinningJob> jobs(characters);
+        for (int c = 0; c < characters; ++c) {
+            jobs[c].palette = palette.data();
+            jobs[c].boneCount = palette.size();
+            jobs[c].source = source;
+            jobs[c].out = outputs[c].data();
+        }
+        for (unsigned threads : threadCounts) {
+            AnimationWorkerPool pool(threads);
+            runBench("cpu_skinning_meshes", {{"characters", characters}, {"vertices", vertices}, {"threads", threads}},
+                     vertices * characters, [&] {
+                skinMeshes(pool, jobs);
+                g_sink = outputs.back().back();
+            });
+        }
+    }
+}
+
+// Importacion real de un archivo (Assimp + conversion de todos sus meshes)
+static void benchModelFile(const std::string& path) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs |
+                                             aiProcess_CalcTangentSpace | aiProcess_ValidateDataStructure);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
+        return;
+    }
+
+    std::map<std::string, Bone> bones;
+    collectBones(scene, bones);
+    long long totalVertices = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        totalVertices += scene->mMeshes[i]->mNumVertices;
+    }
+
+    runBench("model_file_read", {{"meshes", scene->mNumMeshes}, {"vertices", totalVertices}}, totalVertices, [&] {
+        Assimp::Importer reader;
+        const aiScene* s = reader.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs |
+                                           aiProcess_CalcTangentSpace | aiProcess_ValidateDataStructure);
+        g_sink = s ? static_cast<float>(s->mNumMeshes) : 0.0f;
+    });
+    runBench("model_file_meshes", {{"meshes", scene->mNumMeshes}, {"vertices", totalVertices}}, totalVertices, [&] {
+        MeshData data;
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            buildMeshData(scene->mMeshes[i], bones, data);
+        }
+        g_sink = static_cast<float>(data.indices.size());
+    });
+
+    // Misma carga desde el formato horneado: mmap + copia del esqueleto y las pistas
+    ModelData model;
+    std::string bakedPath = bakedModelPath(path) + ".bench";
+    if (importModel(path, model) && writeBakedModel(bakedPath, path, model)) {
+        runBench("model_file_baked", {{"meshes", scene->mNumMeshes}, {"vertices", totalVertices}}, totalVertices, [&] {
+            BakedModel baked;
+            loadBakedModel(bakedPath, path, baked);
+            g_sink = static_cast<float>(baked.skeleton.boneCount());
+        });
+        std::remove(bakedPath.c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            g_options.minSeconds = 0.02;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            g_options.filter = argv[++i];
+        } else if (arg == "--model" && i + 1 < argc) {
+            g_options.modelPath = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            g_options.outPath = argv[++i];
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--quick] [--filter <texto>] [--model <archivo>] [--out <archivo.json>]" << std::endl;
+            return 1;
+        }
+    }
+
+    benchTerrainHeight();
+    benchTerrainGrid();
+    benchTerrainLod();
+    benchSceneCull();
+    benchKeyframeInterpolation();
+    benchAnimationCompression();
+    benchBoneHierarchy();
+    benchPoseBlend();
+    benchCrowdUpdate();
+    benchMeshImport();
+    benchMeshOptimize();
+    benchVertexPack();
+    benchCpuSkinning();
+    if (!g_options.modelPath.empty()) {
+        benchModelFile(g_options.modelPath);
+    }
+
+    if (g_options.outPath.empty()) {
+        writeJson(std::cout);
+    } else {
+        std::ofstream out(g_options.outPath);
+        writeJson(out);
+        std::cerr << "Resultados escritos en " << g_options.outPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright 2025 Adolfo Cárdenas P.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Herramienta offline: convierte imagenes al formato de CookedTexture.hpp, junto a la original
+// (<imagen>.ctex), con todos los mipmaps y comprimidas en BC1/BC3. Cada imagen se cocina en un hilo.
+//
+// Compilar:  g++ -O2 -std=c++17 cooktex.cpp -o cooktex -pthread
+// Uso:       ./cooktex [--rgba8] Resources/grass2.png [otra.png ...]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "AnimationWorkers.hpp"
+#include "CookedTexture.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    bool forceRgba8 = false;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rgba8") {
+            forceRgba8 = true;
+        } else {
+            sources.push_back(arg);
+        }
+    }
+    if (sources.empty()) {
+        std::cerr << "Uso: " << argv[0] << " [--rgba8] <imagen> [<imagen> ...]" << std::endl;
+        return 1;
+    }
+
+    std::vector<CookTextureResult> results(sources.size());
+    std::vector<char> succeeded(sources.size(), 0);
+    std::vector<double> milliseconds(sources.size(), 0.0);
+    AnimationWorkerPool workers;
+    workers.parallelFor(sources.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            succeeded[i] = cookTexture(sources[i], cookedTexturePath(sources[i]), forceRgba8, results[i]);
+            milliseconds[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    });
+
+    int failures = 0;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!succeeded[i]) {
+            ++failures;
+            continue;
+        }
+        const CookTextureResult& result = results[i];
+        std::cout << "Cooked " << sources[i] << " -> " << cookedTexturePath(sources[i]) << ": " << result.width << "x"
+                  << result.height << " " << cookedTextureFormatName(result.format) << ", " << result.levelCount
+                  << " levels, " << (result.cookedBytes >> 10) << " KiB (RGBA8 with mipmaps: "
+                  << (result.uncompressedBytes >> 10) << " KiB), " << milliseconds[i] << " ms" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -17,35 +17,39 @@
 */
 
 #include "Player.hpp"
+#include "Terrain.hpp"
+#include "TerrainLod.hpp"
+#include "StaticBillboards.hpp"
+#include "Bvh.hpp"
+#include "ShaderProgram.hpp"
+#include "TextureManager.hpp"
 
-// --- Variables globales para las texturas ---
-GLuint floorTextureID;
-GLuint heightmapTextureID;
-GLuint sandTextureID;
-GLuint rockTextureID;
-GLuint snowTextureID;
+#include <chrono>
+
+// --- Texturas ---
+// Todas se cargan a traves del TextureManager (TextureManager.hpp). Si las texturas residentes
+// superan este presupuesto se liberan o reducen las menos usadas recientemente.
+const size_t kTextureBudgetBytes = 256u * 1024u * 1024u;
 
 //-------NEWOBJ-----
 
-GLuint newObjectTextureID; // ID de la textura para tu PNG
 GLuint newObjectVAO, newObjectVBO; // VAO y VBO para un simple quad (o un modelo más complejo si tienes)
 
-GLuint modelArbolTextureID; // ID de la textura para tu PNG
 //GLuint modelArbolVAO, modelArbolVBO; 
 
 const char* objectVertexShaderSource = R"(
     #version 330 core
     layout (location = 0) in vec3 aPos;
     layout (location = 4) in vec2 aTexCoords;
+    layout (location = 5) in mat4 instanceModel; // Matriz de mundo de cada instancia (ver StaticBillboards.hpp)
 
-    uniform mat4 model;
     uniform mat4 view;
     uniform mat4 projection;
 
     out vec2 TexCoords;
 
     void main() {
-        gl_Position = projection * view * model * vec4(aPos, 1.0);
+        gl_Position = projection * view * instanceModel * vec4(aPos, 1.0);
         TexCoords = aTexCoords;
     }
 )";
@@ -78,13 +82,23 @@ const char* objectFragmentShaderSource = R"(
 //----------------------------------------------------------------------
 
 
-unsigned char* heightmapCpuData = nullptr; 
-int heightmapWidth, heightmapHeight, heightmapNrChannels; // Añade estas líneas
-
 // Variables globales para VAO/VBO/EBO del suelo ---
 GLuint floorVAO, floorVBO, floorEBO;
+GLuint terrainGridTexture = 0; // Altura y normal por vertice para el terreno sin atributos
+
+// Unidad de terrainGridTexture: las 0 a 5 son las texturas del DrawItem del suelo
+const GLuint kTerrainGridTextureUnit = 6;
 
-unsigned char *h_data;
+// Esquina de un bloque del terreno dibujado sin atributos, como uniforms propios del DrawItem
+struct TerrainPatchSetup {
+    const Uniform* patchOrigin;
+    glm::vec2 origin;
+
+    static void apply(const void* context) {
+        const TerrainPatchSetup* patch = static_cast<const TerrainPatchSetup*>(context);
+        setUniform(*patch->patchOrigin, patch->origin);
+    }
+};
 
 // Helper function to check for OpenGL errors
 void checkGLError(const std::string& stage) {
@@ -93,47 +107,6 @@ void checkGLError(const std::string& stage) {
         std::cerr << "OpenGL Error at " << stage << ": " << err << std::endl;
     }
 }
-/*
-// Función para verificar errores de compilación/linkeo de shaders
-void checkShaderCompileErrors(GLuint shader, std::string type) {
-    GLint success;
-    GLchar infoLog[1024];
-    if (type != "PROGRAM") {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    } else {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cerr << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
-}
-*/
-void checkShaderCompileErrors(GLuint shaderOrProgram, const std::string& type) {
-    GLint success;
-    GLchar infoLog[1024];
-    
-    if (type == "VERTEX" || type == "FRAGMENT" || type == "GEOMETRY") {
-        glGetShaderiv(shaderOrProgram, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shaderOrProgram, sizeof(infoLog), NULL, infoLog);
-            std::cerr << "ERROR::SHADER_COMPILATION (" << type << ")\n" 
-                      << infoLog << "\n--------------------------------------" << std::endl;
-        }
-    } 
-    else if (type == "PROGRAM") {
-        glGetProgramiv(shaderOrProgram, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shaderOrProgram, sizeof(infoLog), NULL, infoLog);
-            std::cerr << "ERROR::SHADER_PROGRAM_LINKING\n" 
-                      << infoLog << "\n--------------------------------------" << std::endl;
-        }
-    }
-}
 const char* floorVertexShaderSource = R"(
     #version 330 core
     layout (location = 0) in vec3 aPos;
@@ -143,7 +116,22 @@ const char* floorVertexShaderSource = R"(
     uniform mat4 model;
     uniform mat4 view;
     uniform mat4 projection;
-    
+    uniform mat3 normalMatrix; // transpose(inverse(model)), calculada una vez en CPU
+
+    // Con displaceInShader = false la malla ya viene desplazada y con normales (bakeTerrainGridRows).
+    // Con true se usa el camino anterior: altura y normales leidas del heightmap en cada vertice.
+    uniform bool displaceInShader;
+
+    // Sin atributos (gridFromVertexId): gl_VertexID es el vertice dentro del bloque, que tiene
+    // patchVerticesPerRow vertices por lado y la esquina en patchOrigin (en vertices de la cuadricula).
+    // Posicion y UV salen de ahi; la altura y la normal horneadas, de un texelFetch en terrainGrid
+    // (packTerrainGridTexels): las mismas alturas que la malla horneada y que la CPU.
+    uniform bool gridFromVertexId;
+    uniform usampler2D terrainGrid;
+    uniform vec2 patchOrigin;
+    uniform int patchVerticesPerRow;
+    uniform vec2 gridQuads;   // Resolucion - 1 en X y Z
+    uniform vec2 terrainSize;
     uniform sampler2D heightmap;    
     uniform float heightScale;
     uniform float sampleDist; // Nuevo uniform
@@ -151,11 +139,45 @@ const char* floorVertexShaderSource = R"(
     uniform vec2 grassTexRepeat;
 
     out vec3 Normal;
-    out vec3 Normal2;
     out vec3 FragPos;
     out vec2 TexCoords;
+    out vec2 TerrainUV; // UV sin repetir, para el mapa de mezcla
+
+    // Igual que octDecode en PackedVertex.hpp
+    vec3 octDecode(vec2 e) {
+        vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        if (n.z < 0.0) {
+            n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+        }
+        return normalize(n);
+    }
 
     void main() {
+        if (gridFromVertexId) {
+            ivec2 cell = ivec2(patchOrigin) + ivec2(gl_VertexID % patchVerticesPerRow, gl_VertexID / patchVerticesPerRow);
+            uvec2 texel = texelFetch(terrainGrid, cell, 0).rg;
+            vec2 uv = vec2(cell) / gridQuads;
+            // snorm16 con signo: desplazar a la parte alta y volver extiende el signo
+            vec2 octahedral = vec2(int(texel.g << 16u) >> 16, int(texel.g) >> 16) / 32767.0;
+            vec3 position = vec3((uv.x - 0.5) * terrainSize.x, uintBitsToFloat(texel.r), (uv.y - 0.5) * terrainSize.y);
+            TexCoords = uv * grassTexRepeat;
+            TerrainUV = uv;
+            FragPos = vec3(model * vec4(position, 1.0));
+            gl_Position = projection * view * vec4(FragPos, 1.0);
+            Normal = normalMatrix * octDecode(max(octahedral, vec2(-1.0)));
+            return;
+        }
+
+        TexCoords = aTexCoords * grassTexRepeat;
+        TerrainUV = aTexCoords;
+
+        if (!displaceInShader) {
+            FragPos = vec3(model * vec4(aPos, 1.0));
+            gl_Position = projection * view * vec4(FragPos, 1.0);
+            Normal = normalMatrix * aNormal;
+            return;
+        }
+
         float heightValue = texture(heightmap, aTexCoords).r; 
 
         vec3 newPos = aPos;
@@ -165,7 +187,6 @@ const char* floorVertexShaderSource = R"(
         FragPos = vec3(model * vec4(newPos, 1.0));
 
         //float sampleDist = 0.001; 
-        float sampleDist2 = 0.0001; 
         // Para evitar problemas con las normales en los bordes del heightmap
         // Se asegura que los muestreos vecinos no se salgan de 0-1
         vec2 uv_clamped = clamp(aTexCoords, vec2(sampleDist, sampleDist), vec2(1.0 - sampleDist, 1.0 - sampleDist));
@@ -179,27 +200,20 @@ const char* floorVertexShaderSource = R"(
         // Normal = normalize(cross(vec3(dx, hR-hL, 0), vec3(0, hU-hD, dz)))
         // Simplificado para un heightmap:
         vec3 normal = normalize(vec3(hL - hR, 2.0 * sampleDist, hD - hU)); // (dz para GLSL es 'y' del vector, dy es 'z')
-        Normal = mat3(transpose(inverse(model))) * normal;
-
-        hL = texture(heightmap, uv_clamped - vec2(sampleDist2, 0.0)).r * heightScale;
-        hR = texture(heightmap, uv_clamped + vec2(sampleDist2, 0.0)).r * heightScale;
-        hD = texture(heightmap, uv_clamped - vec2(0.0, sampleDist2)).r * heightScale;
-        hU = texture(heightmap, uv_clamped + vec2(0.0, sampleDist2)).r * heightScale;
-        //vec3 normal2 = normalize(vec3(hL - hR, 2.0 * , hD - hU)); // (dz para GLSL es 'y' del vector, dy es 'z')
-        vec3 normal2 = normalize(vec3(hL - hR, 0.02, hD - hU)); // (dz para GLSL es 'y' del vector, dy es 'z')
-        
-        Normal2 = mat3(transpose(inverse(model))) * normal2;
-        TexCoords = aTexCoords * grassTexRepeat;
+        Normal = normalMatrix * normal;
     }
 )";
 
+// Los pesos de arena, hierba, roca y nieve se hornean al cargar en splatMap (bakeTerrainSplatTile):
+// aqui solo se leen. Las texturas con peso 0 no se muestrean; los gradientes se toman antes de
+// las ramas para que el mipmap sea el mismo que sin ellas.
 const char* floorFragmentShaderSource = R"(
     #version 330 core
     out vec4 FragColor;
     in vec3 Normal;    
-    in vec3 Normal2;
     in vec3 FragPos;
     in vec2 TexCoords;
+    in vec2 TerrainUV;
 
     uniform vec3 lightPos;
     uniform vec3 viewPos;
@@ -208,6 +222,7 @@ const char* floorFragmentShaderSource = R"(
     uniform sampler2D sandTexture;
     uniform sampler2D rockTexture;
     uniform sampler2D snowTexture;
+    uniform sampler2D splatMap; // r = arena, g = hierba, b = roca, a = nieve
     
     uniform vec3 lightColor;
     uniform float ambientStrength;
@@ -215,7 +230,6 @@ const char* floorFragmentShaderSource = R"(
     
     void main() {
         vec3 norm = normalize(Normal);
-        vec3 norm2 = normalize(Normal2);
         vec3 lightDir = normalize(lightPos - FragPos);
 
         // Iluminación
@@ -223,45 +237,18 @@ const char* floorFragmentShaderSource = R"(
         vec3 diffuse = diff * lightColor * diffuseStrength; 
         vec3 ambient = ambientStrength * lightColor; 
 
-        // Texturas
-        vec3 texColor = texture(ourTexture, TexCoords).rgb;
-        vec3 sandColor = texture(sandTexture, TexCoords).rgb;
-        vec3 rockColor = texture(rockTexture, TexCoords * 15.0).rgb; // Más tiling para roca
-        vec3 snowColor = texture(snowTexture, TexCoords).rgb;
-
-        // Mezcla arena/hierba (basada en altura)
-        float sandBlendFactor = smoothstep(-16.0f, -15.0f, FragPos.y);
-        vec3 finalColor = mix(sandColor, texColor, sandBlendFactor);
-
-        // --- CÁLCULO CORRECTO PARA ROCA EN PENDIENTES ---
-        //float slope = 1.0 - abs(dot(norm, vec3(0.0, 1.0, 0.0))); // 0=plano, 1=vertical
-        float slope = 1.0 - abs(dot(norm2, vec3(0.0, 1.0, 0.0))); // 0=plano, 1=vertical
-                
-        // Ángulos de transición (en valores de slope, no grados)
-        
-        float rockStartSlope = 1.0-cos(radians(70.0)); // Approx 0.5
-        float rockFullSlope = 1.0-cos(radians(82.0));  // Approx 0.826    
-        
-        float rockBlendFactor = smoothstep(rockStartSlope, rockFullSlope, slope);
-        
-        // Añadir variación con ruido
-        float noise = fract(sin(dot(FragPos.xz, vec2(12.9898, 78.233))) * 43758.5453) * 0.15;
-        rockBlendFactor = clamp(rockBlendFactor + noise, 0.0, 1.0);
-                
-        finalColor = mix(finalColor, rockColor, rockBlendFactor*0.8);
-
-
-         // Mezcla de Nieve (basada en altura, sobre todo lo demás)
-        // Nieve en las zonas más altas
-        //float snowBlendFactor = smoothstep(heightBlendStartSnow, heightBlendEndSnow, FragPos.y);
-        float snowBlendFactor = smoothstep(0.0f, 1.0f, FragPos.y);
-        finalColor = mix(finalColor, snowColor, snowBlendFactor); // Mezcla nieve con lo que ya tenías
-
+        vec4 weights = texture(splatMap, TerrainUV);
+        vec2 dx = dFdx(TexCoords);
+        vec2 dy = dFdy(TexCoords);
+        const float minWeight = 1.0 / 255.0;
 
+        vec3 finalColor = vec3(0.0);
+        if (weights.r > minWeight) finalColor += weights.r * textureGrad(sandTexture, TexCoords, dx, dy).rgb;
+        if (weights.g > minWeight) finalColor += weights.g * textureGrad(ourTexture, TexCoords, dx, dy).rgb;
+        if (weights.b > minWeight) finalColor += weights.b * textureGrad(rockTexture, TexCoords * 15.0, dx * 15.0, dy * 15.0).rgb; // Más tiling para roca
+        if (weights.a > minWeight) finalColor += weights.a * textureGrad(snowTexture, TexCoords, dx, dy).rgb;
 
         // Resultado con iluminación
-        
-        //FragColor = vec4(slope, slope, slope, 1.0);
         FragColor = vec4(finalColor * (ambient + diffuse), 1.0);
         //FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);//para ver las normales directamente
     }   
@@ -270,175 +257,10 @@ const char* floorFragmentShaderSource = R"(
 
 
 
-GLuint cargarTextura(const char* archivo) {
-    GLuint texturaID;
-    glGenTextures(1, &texturaID);
-    
-    int ancho, alto, nrCanales;
-    unsigned char* datos = stbi_load(archivo, &ancho, &alto, &nrCanales, 0);
-    
-    if(datos) {
-        GLenum formato = (nrCanales == 4) ? GL_RGBA : GL_RGB;
-        
-        glBindTexture(GL_TEXTURE_2D, texturaID);
-        glTexImage2D(GL_TEXTURE_2D, 0, formato, ancho, alto, 0, formato, GL_UNSIGNED_BYTE, datos);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        
-        stbi_image_free(datos);
-    } else {
-        std::cerr << "Error al cargar la textura: " << archivo << std::endl;
-    }
-    
-    return texturaID;
-}
 
 
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    // Check compilation status
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if(!success) {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    
-    return shader;
-}
-
 
-// Funciones para generar la malla del terreno ---
-// Genera una cuadrícula de vértices para el terreno
-std::vector<float> generateTerrainGridVertices(int resolutionX, int resolutionZ, float terrainSizeX, float terrainSizeZ, float baseHeight) {
-    std::vector<float> vertices;
-    float stepX = terrainSizeX / (resolutionX - 1);
-    float stepZ = terrainSizeZ / (resolutionZ - 1);
-
-    for (int z = 0; z < resolutionZ; ++z) {
-        for (int x = 0; x < resolutionX; ++x) {
-            float posX = -terrainSizeX / 2.0f + x * stepX;
-            float posZ = -terrainSizeZ / 2.0f + z * stepZ;
-            float posY = baseHeight; // La altura Y será modificada por el heightmap en el shader
-
-            // Normal inicial (apuntando hacia arriba, se recalculará en el shader)
-            float normX = 0.0f;
-            float normY = 1.0f;
-            float normZ = 0.0f;
-
-            // Coordenadas de textura (UVs de 0.0 a 1.0 para el heightmap y la repetición de hierba)
-            float texU = (float)x / (resolutionX - 1);
-            float texV = (float)z / (resolutionZ - 1);
-
-            // Añadir los 8 floats por vértice: Posición (3), Normal (3), TexCoords (2)
-            vertices.push_back(posX);
-            vertices.push_back(posY);
-            vertices.push_back(posZ);
-            vertices.push_back(normX);
-            vertices.push_back(normY);
-            vertices.push_back(normZ);
-            vertices.push_back(texU);
-            vertices.push_back(texV);
-        }
-    }
-    return vertices;
-}
 
-// Genera los índices para una cuadrícula de terreno (para dibujar con EBO)
-std::vector<unsigned int> generateTerrainGridIndices(int resolutionX, int resolutionZ) {
-    std::vector<unsigned int> indices;
-    for (int z = 0; z < resolutionZ - 1; ++z) {
-        for (int x = 0; x < resolutionX - 1; ++x) {
-            unsigned int topLeft = z * resolutionX + x;
-            unsigned int topRight = z * resolutionX + x + 1;
-            unsigned int bottomLeft = (z + 1) * resolutionX + x;
-            unsigned int bottomRight = (z + 1) * resolutionX + x + 1;
-
-            // Primer triángulo del quad (Top-Left, Bottom-Left, Top-Right)
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-
-            // Segundo triángulo del quad (Top-Right, Bottom-Left, Bottom-Right)
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-        }
-    }
-    return indices;
-}
-
-float getTerrainHeight(float worldX, float worldZ, float terrainWidth, float terrainDepth, float terrainYOffset, 
-                       float heightScale, const unsigned char* heightmapData, int h_width, int h_height, int h_channels) {
-    if (!heightmapData || h_width == 0 || h_height == 0) {
-        return terrainYOffset; // Retorna la altura base si el heightmap no está cargado
-    }
-
-    // 1. Convertir coordenadas del mundo (X, Z) a UV del heightmap (0.0 a 1.0)
-    float normalizedX = (worldX + terrainWidth / 2.0f) / terrainWidth;
-    float normalizedZ = (worldZ + terrainDepth / 2.0f) / terrainDepth;
-
-    // Asegurarse de que las coordenadas UV estén dentro del rango [0.0, 1.0]
-    normalizedX = glm::clamp(normalizedX, 0.0f, 1.0f);
-    normalizedZ = glm::clamp(normalizedZ, 0.0f, 1.0f);
-
-    // 2. Convertir UV a coordenadas flotantes de píxel del heightmap
-    // Multiplicamos por (h_width - 1) porque las coordenadas de píxel van de 0 a (resolución-1)
-    float pixelX_float = normalizedX * (h_width - 1);
-    float pixelZ_float = normalizedZ * (h_height - 1);
-
-    // 3. Obtener los 4 píxeles enteros circundantes
-    int x1 = static_cast<int>(floor(pixelX_float));
-    int x2 = static_cast<int>(ceil(pixelX_float));
-    int z1 = static_cast<int>(floor(pixelZ_float));
-    int z2 = static_cast<int>(ceil(pixelZ_float));
-
-    // Clamp para asegurar que no nos salimos de los límites de la imagen
-    x1 = glm::clamp(x1, 0, h_width - 1);
-    x2 = glm::clamp(x2, 0, h_width - 1);
-    z1 = glm::clamp(z1, 0, h_height - 1);
-    z2 = glm::clamp(z2, 0, h_height - 1);
-
-    // 4. Obtener los valores de altura (0.0-1.0) de los 4 píxeles
-    // Nota: La lectura de stbi_image es a menudo de arriba a abajo, de izquierda a derecha.
-    // h_data[ (y * width + x) * channels ]
-    auto getPixelHeightValue = [&](int x, int z) {
-        // Asegúrate de que el índice no exceda los límites
-        unsigned int index = (z * h_width + x) * h_channels;
-        if (index >= h_width * h_height * h_channels) {
-            return 0.0f; // Valor por defecto o error si el índice está fuera de rango
-        }
-        return static_cast<float>(heightmapData[index]) / 255.0f;
-    };
-
-    float h00 = getPixelHeightValue(x1, z1); // Top-Left
-    float h10 = getPixelHeightValue(x2, z1); // Top-Right
-    float h01 = getPixelHeightValue(x1, z2); // Bottom-Left
-    float h11 = getPixelHeightValue(x2, z2); // Bottom-Right
-
-    // 5. Calcular los pesos de interpolación
-    float tx = pixelX_float - x1; // Fracción entre x1 y x2
-    float tz = pixelZ_float - z1; // Fracción entre z1 y z2
-
-    // 6. Interpolación bilineal
-    // Interpolar a lo largo del eje X (horizontal)
-    float interpolatedX1 = glm::mix(h00, h10, tx); // Interpolación entre (x1,z1) y (x2,z1)
-    float interpolatedX2 = glm::mix(h01, h11, tx); // Interpolación entre (x1,z2) y (x2,z2)
-
-    // Interpolar a lo largo del eje Z (vertical)
-    float finalHeightValue = glm::mix(interpolatedX1, interpolatedX2, tz);
-
-    // 7. Aplicar la escala y el offset del terreno
-    return terrainYOffset + finalHeightValue * heightScale;
-}
 // Main function
 int main()
 {
@@ -488,15 +310,25 @@ int main()
     checkGLError("glViewport");
 
     // --- Carga de personajes ---
+    // El gestor de texturas va antes que la cache de modelos, y esta antes que los personajes,
+    // para que cada uno se destruya despues de quien lo usa
+    TextureManager textureManager(kTextureBudgetBytes);
+    ModelAssetCache modelCache(textureManager);
     std::vector<std::unique_ptr<AnimatedModel>> characters;
     
     // Carga la primera instancia del personaje principal (el controlable)
     std::cout << "Main: Attempting to create AnimatedModel instance for: Resources/model.dae (Player Character)" << std::endl;
-    characters.push_back(std::make_unique<AnimatedModel>("Resources/model.dae"));
-    if (characters.back()->shaderProgram == 0) { // Check if loading failed
+    std::shared_ptr<ModelAsset> playerAsset = modelCache.load("Resources/model.dae");
+    if (!playerAsset) { // Check if loading failed
         std::cerr << "Error: Failed to load model Resources/model.dae. Exiting." << std::endl;
         return -1; 
     }
+    characters.push_back(std::make_unique<AnimatedModel>(playerAsset));
+    characters.back()->scale = glm::vec3(0.5f);
+    // Quieto: pose de enlace; andando (10 unidades/s, ver moveSpeed): el primer clip del modelo
+    if (playerAsset->clipCount() > 0) {
+        characters.back()->setLocomotion({-1, playerAsset->defaultClip()}, {0.0f, 10.0f});
+    }
     std::cout << "Main: AnimatedModel instance created for player character." << std::endl;
     checkGLError("AnimatedModel creation for player character");
     
@@ -508,27 +340,56 @@ int main()
 
     // El índice 0 siempre será el personaje principal (el controlable)
     int currentCharacterIndex = 0; 
+
+    // Las animaciones de todos los personajes se calculan en paralelo cada frame, cada una con el
+    // nivel de detalle que le toca por tamaño en pantalla y distancia (AnimationLod.hpp)
+    AnimationWorkerPool animationWorkers;
+    AnimationLodScheduler animationLod;
+    for (auto& character : characters) {
+        animationLod.add(&character->getAnimationState(), &character->getAsset().lowInfluenceBoneMask());
+    }
+    std::cout << "Main: Animation worker pool with " << animationWorkers.threadCount() << " threads." << std::endl;
     // --- Fin de carga de personajes ---
 
     // --- Floor Shader Program Setup ---
-    GLuint floorVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(floorVertexShader, 1, &floorVertexShaderSource, nullptr);
-    glCompileShader(floorVertexShader);
-    checkShaderCompileErrors(floorVertexShader, "VERTEX");
-
-    GLuint floorFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(floorFragmentShader, 1, &floorFragmentShaderSource, nullptr);
-    glCompileShader(floorFragmentShader);
-    checkShaderCompileErrors(floorFragmentShader, "FRAGMENT");
-
-    GLuint floorShaderProgram = glCreateProgram();
-    glAttachShader(floorShaderProgram, floorVertexShader);
-    glAttachShader(floorShaderProgram, floorFragmentShader);
-    glLinkProgram(floorShaderProgram);
-    checkShaderCompileErrors(floorShaderProgram, "PROGRAM");
-
-    glDeleteShader(floorVertexShader);
-    glDeleteShader(floorFragmentShader);
+    // Los uniforms se resuelven una vez aqui; en el bucle solo se usan los Uniform guardados
+    ShaderProgram floorShader;
+    floorShader.build(floorVertexShaderSource, floorFragmentShaderSource, "floor");
+    struct {
+        Uniform model, normalMatrix, displaceInShader, view, projection;
+        Uniform lightPos, viewPos, lightColor, ambientStrength, diffuseStrength;
+        Uniform sampleDist, heightScale, terrainYOffset, grassTexRepeat;
+        Uniform gridFromVertexId, patchOrigin, patchVerticesPerRow, gridQuads, terrainSize;
+    } floorUniforms;
+    floorUniforms.model = floorShader.uniform("model");
+    floorUniforms.normalMatrix = floorShader.uniform("normalMatrix");
+    floorUniforms.displaceInShader = floorShader.uniform("displaceInShader");
+    floorUniforms.view = floorShader.uniform("view");
+    floorUniforms.projection = floorShader.uniform("projection");
+    floorUniforms.lightPos = floorShader.uniform("lightPos");
+    floorUniforms.viewPos = floorShader.uniform("viewPos");
+    floorUniforms.lightColor = floorShader.uniform("lightColor");
+    floorUniforms.ambientStrength = floorShader.uniform("ambientStrength");
+    floorUniforms.diffuseStrength = floorShader.uniform("diffuseStrength");
+    floorUniforms.sampleDist = floorShader.uniform("sampleDist");
+    floorUniforms.heightScale = floorShader.uniform("heightScale");
+    floorUniforms.terrainYOffset = floorShader.uniform("terrainYOffset");
+    floorUniforms.grassTexRepeat = floorShader.uniform("grassTexRepeat");
+    floorUniforms.gridFromVertexId = floorShader.uniform("gridFromVertexId");
+    floorUniforms.patchOrigin = floorShader.uniform("patchOrigin");
+    floorUniforms.patchVerticesPerRow = floorShader.uniform("patchVerticesPerRow");
+    floorUniforms.gridQuads = floorShader.uniform("gridQuads");
+    floorUniforms.terrainSize = floorShader.uniform("terrainSize");
+    // Unidades de textura fijas: hierba, heightmap, arena, roca, nieve y mapa de mezcla
+    floorShader.setSampler("ourTexture", 0);
+    floorShader.setSampler("heightmap", 1);
+    floorShader.setSampler("sandTexture", 2);
+    floorShader.setSampler("rockTexture", 3);
+    floorShader.setSampler("snowTexture", 4);
+    floorShader.setSampler("terrainGrid", kTerrainGridTextureUnit);
+    floorShader.setSampler("splatMap", 5);
+    std::cout << "Main: Floor shader with " << floorShader.activeUniforms().size() << " active uniforms, "
+              << floorShader.samplers().size() << " samplers." << std::endl;
     checkGLError("Floor Shader Program Setup");
     // --- End Floor Shader Program Setup ---
 
@@ -537,7 +398,6 @@ int main()
 
 
 //----------------------------------------------
-    int imgWidth, imgHeight, imgNrChannels;
 //-----------------------------------------------
 
 
@@ -545,8 +405,11 @@ int main()
 
     // --- CAMBIO: Generación de la malla del terreno (vértices e índices) ---
     // Puedes ajustar estos valores para cambiar el tamaño y detalle del terreno
-    int terrainResolutionX = 256; // Por ejemplo, un vértice por píxel del heightmap si es 256x256
-    int terrainResolutionZ = 256; 
+    // (resolucion - 1) debe ser multiplo de terrainChunkQuads (bloques de LOD, ver TerrainLod.hpp)
+    int terrainResolutionX = 257; // Por ejemplo, un vértice por píxel del heightmap si es 256x256
+    int terrainResolutionZ = 257; 
+    int terrainChunkQuads = 32;       // Celdas por lado de cada bloque del quadtree
+    float terrainLodDistance = 64.0f; // Hasta esta distancia los bloques se dibujan con todo el detalle
     float terrainWidth = 512.0f; // Tamaño del terreno en unidades de mundo
     float terrainDepth = 512.0f;
     float terrainBaseY = -16.01f; // Altura inicial del plano antes de deformación
@@ -555,122 +418,162 @@ int main()
     // Para la escala de altura, usa el mismo valor que pasas al shader (0.5f)
     float currentHeightScale = 30.0f; // Declara esta variable y úsala para el shader también
 
-    // Calcula la altura inicial del terreno en el centro (0,0) donde quieres que empiece el personaje
-    float initialTerrainHeight = getTerrainHeight(
-        0.0f,                  // Posición X inicial del personaje (centro del terreno)
-        0.0f,                  // Posición Z inicial del personaje (centro del terreno)
-        terrainWidth,         
-        terrainDepth,         
-        terrainBaseY,         
-        currentHeightScale,    // ¡IMPORTANTE! Usar la misma escala que en el shader
-        heightmapCpuData,     
-        heightmapWidth,
-        heightmapHeight,
-        heightmapNrChannels
-    );
-
-    std::vector<float> floorVerticesVec = generateTerrainGridVertices(terrainResolutionX, terrainResolutionZ, terrainWidth, terrainDepth, terrainBaseY);
-    std::vector<unsigned int> floorIndicesVec = generateTerrainGridIndices(terrainResolutionX, terrainResolutionZ);
-    std::cout << "DEBUG: Terreno generado con " << floorVerticesVec.size() / 8 << " vértices y " << floorIndicesVec.size() / 3 << " triángulos." << std::endl;
-
-    // --- Floor VAO/VBO/EBO Setup ---
-    std::cout << "Main: Generating Floor VAO, VBO, and EBO." << std::endl;
-    glGenVertexArrays(1, &floorVAO);
-    glGenBuffers(1, &floorVBO);
-    glGenBuffers(1, &floorEBO); // --- CAMBIO: Generar EBO ---
-
-    std::cout << "DEBUG: floorVAO ID = " << floorVAO << ", floorVBO ID = " << floorVBO << ", floorEBO ID = " << floorEBO << std::endl;
-    checkGLError("glGenVertexArrays/glGenBuffers/glGenBuffers for floor");
-
-    std::cout << "Main: Binding Floor VAO: " << floorVAO << std::endl;
-    glBindVertexArray(floorVAO);
-    checkGLError("glBindVertexArray for floor");
-
-    std::cout << "Main: Binding Floor VBO: " << floorVBO << std::endl;
-    glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-    std::cout << "DEBUG: sizeof(floorVerticesVec) = " << floorVerticesVec.size() * sizeof(float) << " bytes" << std::endl; // Tamaño en bytes del vector
-    glBufferData(GL_ARRAY_BUFFER, floorVerticesVec.size() * sizeof(float), floorVerticesVec.data(), GL_STATIC_DRAW);
-    checkGLError("glBufferData for floor VBO");
-
-    // Enlazar y enviar datos al EBO ---
-    std::cout << "Main: Binding Floor EBO: " << floorEBO << std::endl;
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
-    std::cout << "DEBUG: sizeof(floorIndicesVec) = " << floorIndicesVec.size() * sizeof(unsigned int) << " bytes" << std::endl;
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, floorIndicesVec.size() * sizeof(unsigned int), floorIndicesVec.data(), GL_STATIC_DRAW);
-    checkGLError("glBufferData for floor EBO");    
-
-    // Atributos de vértice para el suelo (aPos, aNormal, aTexCoords)
-    std::cout << "Main: Setting up Floor Vertex Attributes." << std::endl;
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); // aPos (location 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); // aNormal (location 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))); // aTexCoords (location 4)
-    glEnableVertexAttribArray(4);
-    
-    checkGLError("glVertexAttribPointer/glEnableVertexAttribArray for floor");
+    // Copia en CPU del heightmap para consultar alturas (se llena al cargar heightmap.png)
+    TerrainHeightField terrainHeightField(terrainWidth, terrainDepth, terrainBaseY, currentHeightScale);
 
-    std::cout << "Main: Unbinding Floor VAO." << std::endl;
-    glBindVertexArray(0); 
-    checkGLError("glBindVertexArray 0 for floor");
-
-    // --- Floor Texture (grass.png) ---
-    glGenTextures(1, &floorTextureID);
-    checkGLError("glGenTextures for floor");
+    // --- Carga del Heightmap (heightmap.png) ---
+    // Se decodifica una sola vez: la misma imagen llena la copia en CPU y la textura.
+    // No se reduce nunca (pinned): el shader la muestrea a distancia de un texel.
+    TextureHandle heightmapTexture;
+    int h_width, h_height, h_nrChannels;
+    unsigned char* h_data = stbi_load("heightmap.png", &h_width, &h_height, &h_nrChannels, 0);
+    if (h_data) {
+        heightmapTexture = textureManager.loadFromPixels("heightmap.png", h_data, h_width, h_height, h_nrChannels,
+                                                         clampedLinearSampler(), true);
+        std::cout << "Heightmap texture loaded: heightmap.png (Width: " << h_width << ", Height: " << h_height << ", Channels: " << h_nrChannels << ")" << std::endl;
+        // La copia en CPU se guarda ya convertida a float; la imagen original ya no hace falta
+        terrainHeightField.loadFromImage(h_data, h_width, h_height, h_nrChannels);
+        stbi_image_free(h_data);
+    } else {
+        std::cerr << "Failed to load heightmap: heightmap.png. Make sure it's in the program directory." << std::endl;
+    }
+    checkGLError("Heightmap texture loading");
 
-    glBindTexture(GL_TEXTURE_2D, floorTextureID);
-    checkGLError("glBindTexture for floor");
+    //float heightmapPixelSize = 1.0f / terrainHeightField.width(); // Asumiendo width = height para simplificar
+    
+    float heightmapPixelSize = 1.0f / terrainHeightField.width();//Produce normales más suaves y realistas.
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    checkGLError("glTexParameter for floor");
+    // true = el vertex shader desplaza la malla y calcula las normales leyendo el heightmap (camino anterior).
+    // false = se usan las posiciones, normales y pendientes horneadas abajo.
+    bool terrainDisplaceInShader = false;
 
+    // true = sin VBO: el vertex shader genera cada vertice desde gl_VertexID y la esquina del bloque,
+    // con un solo EBO de tiras de 16 bits que comparten todos los bloques (TerrainQuadtree::stripIndices).
+    // Altura y normal horneadas se leen con un texelFetch de terrainGridTexture (8 bytes por vertice).
+    bool terrainFromVertexId = true;
 
+    // Calcula la altura inicial del terreno en el centro (0,0) donde quieres que empiece el personaje
+    float initialTerrainHeight = terrainHeightField.heightAt(0.0f, 0.0f);
+
+    // Hornea posiciones, normales y pendiente de cada vertice en CPU, repartiendo las filas entre los hilos
+    std::vector<float> floorVerticesVec(static_cast<size_t>(terrainResolutionX) * terrainResolutionZ * kTerrainBakedVertexFloats);
+    animationWorkers.parallelFor(terrainResolutionZ, 8, [&](size_t zBegin, size_t zEnd) {
+        bakeTerrainGridRows(terrainHeightField, terrainResolutionX, terrainResolutionZ, terrainWidth, terrainDepth,
+                            heightmapPixelSize, static_cast<int>(zBegin), static_cast<int>(zEnd), floorVerticesVec.data());
+    });
+
+    // Bloques con sus cajas y los indices de todos los niveles de detalle
+    TerrainQuadtree terrainLod;
+    if (!terrainLod.build(floorVerticesVec.data(), terrainResolutionX, terrainResolutionZ, kTerrainBakedVertexFloats, terrainChunkQuads)) {
+        std::cerr << "Terrain resolution - 1 must be a multiple of " << terrainChunkQuads << ". Exiting." << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    const std::vector<uint32_t>& floorIndicesVec = terrainLod.indices();
+    std::vector<TerrainChunkDraw> terrainDraws; // Se rellena cada frame con los bloques visibles
+    std::vector<TerrainPatchSetup> terrainPatchSetups; // Uniforms de cada bloque dibujado sin atributos
+    terrainPatchSetups.reserve(terrainLod.chunkCount());
+    std::cout << "DEBUG: Terreno generado con " << floorVerticesVec.size() / kTerrainBakedVertexFloats << " vértices, "
+              << terrainLod.chunkCount() << " bloques y " << terrainLod.levelCount() << " niveles de detalle." << std::endl;
+    const TerrainCacheReport& terrainCache = terrainLod.vertexCacheReport();
+    std::cout << "Terrain vertex cache (FIFO " << kVertexCacheSize << "): lists ACMR " << terrainCache.listBefore.acmr() << " -> "
+              << terrainCache.listAfter.acmr() << ", ATVR " << terrainCache.listBefore.atvr() << " -> " << terrainCache.listAfter.atvr()
+              << "; strips ACMR " << terrainCache.stripBefore.acmr() << " -> " << terrainCache.stripAfter.acmr() << ", ATVR "
+              << terrainCache.stripBefore.atvr() << " -> " << terrainCache.stripAfter.atvr() << std::endl;
+
+    if (terrainFromVertexId) {
+        // Sin VBO: el VAO solo guarda el EBO con las tiras. Los atributos desactivados no se leen.
+        const std::vector<uint16_t>& stripIndices = terrainLod.stripIndices();
+        glGenVertexArrays(1, &floorVAO);
+        glGenBuffers(1, &floorEBO);
+        floorVBO = 0;
+        glBindVertexArray(floorVAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, stripIndices.size() * sizeof(uint16_t), stripIndices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        checkGLError("Floor strip EBO");
+
+        // Altura y normal de cada vertice horneado en una textura entera (sin filtrado: texelFetch)
+        std::vector<uint32_t> gridTexels(static_cast<size_t>(terrainResolutionX) * terrainResolutionZ * 2);
+        packTerrainGridTexels(floorVerticesVec.data(), gridTexels.size() / 2, gridTexels.data());
+        glGenTextures(1, &terrainGridTexture);
+        glBindTexture(GL_TEXTURE_2D, terrainGridTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, terrainResolutionX, terrainResolutionZ, 0, GL_RG_INTEGER, GL_UNSIGNED_INT,
+                     gridTexels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        checkGLError("Terrain grid texture");
+
+        const size_t bakedBytes = floorVerticesVec.size() * sizeof(float) + floorIndicesVec.size() * sizeof(uint32_t);
+        const size_t gridBytes = stripIndices.size() * sizeof(uint16_t) + gridTexels.size() * sizeof(uint32_t);
+        std::cout << "Terrain mesh: vertices from gl_VertexID, " << gridBytes / 1024 << " KiB of strip indices and height/normal texels ("
+                  << bakedBytes / 1024 << " KiB with the baked vertex buffer)" << std::endl;
+        // Las posiciones horneadas ya estan en la textura y en las cajas del quadtree
+        std::vector<float>().swap(floorVerticesVec);
+    } else {
+        // --- Floor VAO/VBO/EBO Setup ---
+        std::cout << "Main: Generating Floor VAO, VBO, and EBO." << std::endl;
+        glGenVertexArrays(1, &floorVAO);
+        glGenBuffers(1, &floorVBO);
+        glGenBuffers(1, &floorEBO); // --- CAMBIO: Generar EBO ---
 
+        std::cout << "DEBUG: floorVAO ID = " << floorVAO << ", floorVBO ID = " << floorVBO << ", floorEBO ID = " << floorEBO << std::endl;
+        checkGLError("glGenVertexArrays/glGenBuffers/glGenBuffers for floor");
 
+        std::cout << "Main: Binding Floor VAO: " << floorVAO << std::endl;
+        glBindVertexArray(floorVAO);
+        checkGLError("glBindVertexArray for floor");
+
+        std::cout << "Main: Binding Floor VBO: " << floorVBO << std::endl;
+        glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
+        std::cout << "DEBUG: sizeof(floorVerticesVec) = " << floorVerticesVec.size() * sizeof(float) << " bytes" << std::endl; // Tamaño en bytes del vector
+        glBufferData(GL_ARRAY_BUFFER, floorVerticesVec.size() * sizeof(float), floorVerticesVec.data(), GL_STATIC_DRAW);
+        checkGLError("glBufferData for floor VBO");
+
+        // Enlazar y enviar datos al EBO ---
+        std::cout << "Main: Binding Floor EBO: " << floorEBO << std::endl;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
+        std::cout << "DEBUG: sizeof(floorIndicesVec) = " << floorIndicesVec.size() * sizeof(unsigned int) << " bytes" << std::endl;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, floorIndicesVec.size() * sizeof(unsigned int), floorIndicesVec.data(), GL_STATIC_DRAW);
+        checkGLError("glBufferData for floor EBO");    
+
+        // Atributos de vértice para el suelo (aPos, aNormal, aTexCoords)
+        std::cout << "Main: Setting up Floor Vertex Attributes." << std::endl;
+        const GLsizei floorStride = kTerrainBakedVertexFloats * sizeof(float);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, floorStride, (void*)0); // aPos (location 0)
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, floorStride, (void*)(3 * sizeof(float))); // aNormal (location 1)
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, floorStride, (void*)(6 * sizeof(float))); // aTexCoords (location 4)
+        glEnableVertexAttribArray(4);
+    
+        checkGLError("glVertexAttribPointer/glEnableVertexAttribArray for floor");
 
+        std::cout << "Main: Unbinding Floor VAO." << std::endl;
+        glBindVertexArray(0); 
+        checkGLError("glBindVertexArray 0 for floor");
+    }
 
-//-------NEWOBJ-----
+    // --- Floor Texture (grass.png) ---
+    TextureHandle floorTexture = textureManager.load("Resources/grass2.png");
+    checkGLError("Texture loading for floor");
 
 
-/*
-  GLuint objectVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(objectVertexShader, 1, &objectVertexShaderSource, nullptr);
-    glCompileShader(objectVertexShader);
-    checkShaderCompileErrors(objectVertexShader, "OBJECT_VERTEX");
-
-    GLuint objectFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(objectFragmentShader, 1, &objectFragmentShaderSource, nullptr);
-    glCompileShader(objectFragmentShader);
-    checkShaderCompileErrors(objectFragmentShader, "OBJECT_FRAGMENT");
-*/
-    GLuint objectVertexShader = compileShader(GL_VERTEX_SHADER, objectVertexShaderSource);
-    GLuint objectFragmentShader = compileShader(GL_FRAGMENT_SHADER, objectFragmentShaderSource);
 
 
-    GLuint objectShaderProgram = glCreateProgram();
-    glAttachShader(objectShaderProgram, objectVertexShader);
-    glAttachShader(objectShaderProgram, objectFragmentShader);
 
-    glLinkProgram(objectShaderProgram);
 
+//-------NEWOBJ-----
 
-//glLinkProgram(program);
-/*
-GLint success;
-glGetProgramiv(objectShaderProgram, GL_LINK_STATUS, &success);
-if(!success) {
-    GLchar infoLog[512];
-    glGetProgramInfoLog(objectShaderProgram, 512, NULL, infoLog);
-    std::cerr << "ERROR::>>>PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-}
-*/
-    checkShaderCompileErrors(objectShaderProgram, "PROGRAM");
 
-    glDeleteShader(objectVertexShader);
-    glDeleteShader(objectFragmentShader);
+    ShaderProgram objectShader;
+    objectShader.build(objectVertexShaderSource, objectFragmentShaderSource, "object");
+    Uniform objectViewUniform = objectShader.uniform("view");
+    Uniform objectProjectionUniform = objectShader.uniform("projection");
+    objectShader.setSampler("ourTexture", 0);
     checkGLError("Object Shader Program Setup");
 
 
@@ -741,31 +644,13 @@ for (int i = 0; i < num_arboles; i++) {
 }
     
 
-    unsigned char *data = stbi_load("Resources/grass2.png", &imgWidth, &imgHeight, &imgNrChannels, 0);
-    if (data)
-    {
-        GLenum format = GL_RGB;
-        if (imgNrChannels == 1) format = GL_RED;
-        else if (imgNrChannels == 3) format = GL_RGB;
-        else if (imgNrChannels == 4) format = GL_RGBA;
-
-        glTexImage2D(GL_TEXTURE_2D, 0, format, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(data);
-        std::cout << "Floor texture loaded: Resources/grass.png" << std::endl;
-    }
-    else
-    {
-        std::cerr << "Failed to load floor texture: Resources/grass.png. Using solid color or default." << std::endl;
-    }
-    checkGLError("Texture loading for floor");
 
 
 //-------NEWOBJ-----
-newObjectTextureID = cargarTextura("Resources/coco.png") ;
+TextureHandle cocoTexture = textureManager.load("Resources/coco.png");
 
 //arbol----------------------
-modelArbolTextureID = cargarTextura("Resources/arbol.png") ; // ID de la textura para tu PNG
+TextureHandle arbolTexture = textureManager.load("Resources/arbol.png");
 
 /*
  // Cargar la nueva textura PNG para el objeto
@@ -803,101 +688,101 @@ modelArbolTextureID = cargarTextura("Resources/arbol.png") ; // ID de la textura
 
 
 
-    // Cargar Sand Texture
-    glGenTextures(1, &sandTextureID);
-    glBindTexture(GL_TEXTURE_2D, sandTextureID);
-    // Configurar parámetros (GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, etc.)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Cargar datos de la imagen (ej. Resources/sand.png)
-    unsigned char *sand_data = stbi_load("Resources/sand.png", &imgWidth, &imgHeight, &imgNrChannels, 0);
-    if (sand_data) {
-        GLenum format = GL_RGB; // Ajusta según el formato de tu imagen
-        if (imgNrChannels == 4) format = GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, sand_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(sand_data);
-        std::cout << "sand texture loaded: Resources/sand.png" << std::endl;
-    } else { /* Error handling */ }
-    checkGLError("sand Texture Loading");
-
-    // Cargar Rock Texture
-    glGenTextures(1, &rockTextureID);
-    glBindTexture(GL_TEXTURE_2D, rockTextureID);
-    // Configurar parámetros (GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, etc.)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Cargar datos de la imagen (ej. Resources/rock.png)
-    
-    unsigned char *rock_data = stbi_load("Resources/rock.png", &imgWidth, &imgHeight, &imgNrChannels, 0);
-    if (rock_data) {
-        GLenum format = GL_RGB; // Ajusta según el formato de tu imagen
-        if (imgNrChannels == 4) format = GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, rock_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(rock_data);
-        std::cout << "Rock texture loaded: Resources/rock.png" << std::endl;
-    } else { /* Error handling */ }
-    checkGLError("Rock Texture Loading");
-
-
-    // Cargar Snow Texture
-    glGenTextures(1, &snowTextureID);
-    glBindTexture(GL_TEXTURE_2D, snowTextureID);
-    // Configurar parámetros (GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, etc.)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Cargar datos de la imagen (ej. Resources/snow.png)
-    unsigned char *snow_data = stbi_load("Resources/snow.png", &imgWidth, &imgHeight, &imgNrChannels, 0);
-    if (snow_data) {
-        GLenum format = GL_RGB; // Ajusta según el formato de tu imagen
-        if (imgNrChannels == 4) format = GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, snow_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(snow_data);
-        std::cout << "snow texture loaded: Resources/snow.png" << std::endl;
-    } else { /* Error handling */ }
-    checkGLError("snow Texture Loading");
-
+    // Texturas del terreno por altura y pendiente
+    TextureHandle sandTexture = textureManager.load("Resources/sand.png");
+    TextureHandle rockTexture = textureManager.load("Resources/rock.png");
+    TextureHandle snowTexture = textureManager.load("Resources/snow.png");
 
-    // --- Carga del Heightmap (heightmap.png) ---
-    glGenTextures(1, &heightmapTextureID);
-    glBindTexture(GL_TEXTURE_2D, heightmapTextureID);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Mapa de mezcla: pesos de las cuatro texturas horneados una vez, en bloques de 64x64 repartidos entre los hilos
+    const int terrainSplatResolution = 1024; // 2 texels por unidad de mundo en un terreno de 512
+    const int splatTile = 64;
+    const int splatTilesPerRow = (terrainSplatResolution + splatTile - 1) / splatTile;
+    std::vector<unsigned char> splatPixels(static_cast<size_t>(terrainSplatResolution) * terrainSplatResolution * 4);
+    auto splatStart = std::chrono::steady_clock::now();
+    TerrainSplatRules splatRules;
+    animationWorkers.parallelFor(static_cast<size_t>(splatTilesPerRow) * splatTilesPerRow, 4, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            int x0 = static_cast<int>(tile % splatTilesPerRow) * splatTile, z0 = static_cast<int>(tile / splatTilesPerRow) * splatTile;
+            bakeTerrainSplatTile(terrainHeightField, terrainSplatResolution, terrainSplatResolution, terrainWidth, terrainDepth, splatRules,
+                                 x0, std::min(x0 + splatTile, terrainSplatResolution), z0, std::min(z0 + splatTile, terrainSplatResolution),
+                                 splatPixels.data());
+        }
+    });
+    SamplerSettings splatSampler = clampedLinearSampler();
+    splatSampler.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    TextureHandle splatTexture = textureManager.loadFromPixels("terrain splat map", splatPixels.data(), terrainSplatResolution,
+                                                               terrainSplatResolution, 4, splatSampler);
+    std::cout << "Terrain splat map baked: " << terrainSplatResolution << "x" << terrainSplatResolution << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - splatStart).count() << " ms" << std::endl;
+    splatPixels = std::vector<unsigned char>();
+    checkGLError("Terrain texture loading");
+    std::cout << "Textures: " << textureManager.size() << " resident, " << (textureManager.residentBytes() >> 20)
+              << " MiB of " << (textureManager.budgetBytes() >> 20) << " MiB budget" << std::endl;
+
+
+
+    // Los arboles no se mueven: su altura sobre el terreno se calcula una sola vez, en lote
+    std::vector<float> arbolesX, arbolesZ, arbolesY(arboles_pos.size());
+    for (const glm::vec3& pos : arboles_pos) {
+        arbolesX.push_back(pos.x);
+        arbolesZ.push_back(pos.z);
+    }
+    terrainHeightField.heights(arbolesX.data(), arbolesZ.data(), arbolesY.data(), arboles_pos.size());
+    std::vector<glm::mat4> arbolesMatrices;
+    arbolesMatrices.reserve(arboles_pos.size());
+    for (size_t i = 0; i < arboles_pos.size(); ++i) {
+        arboles_pos[i].y = arbolesY[i];
+        arbolesMatrices.push_back(billboardMatrix(arboles_pos[i], 180.0f, 10.0f)); // Rotación vertical y escala (ajústala)
+    }
 
-    int h_width, h_height, h_nrChannels;
-    h_data = stbi_load("heightmap.png", &h_width, &h_height, &h_nrChannels, 0);
-    if (h_data) {
-        GLenum h_format = GL_RGB;
-        if (h_nrChannels == 1)      h_format = GL_RED;
-        else if (h_nrChannels == 3) h_format = GL_RGB;
-        else if (h_nrChannels == 4) h_format = GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, h_format, h_width, h_height, 0, h_format, GL_UNSIGNED_BYTE, h_data);
-        glGenerateMipmap(GL_TEXTURE_2D);        
-        std::cout << "Heightmap texture loaded: heightmap.png (Width: " << h_width << ", Height: " << h_height << ", Channels: " << h_nrChannels << ")" << std::endl;
-        heightmapCpuData = h_data; // ¡IMPORTANTE! Ahora heightmapCpuData apunta a estos datos
-        heightmapWidth = h_width;
-        heightmapHeight = h_height;
-        heightmapNrChannels = h_nrChannels;
-    } else {
-        std::cerr << "Failed to load heightmap: heightmap.png. Make sure it's in the program directory." << std::endl;
+    // --- Posición del nuevo objeto PNG (coco) ---
+    glm::vec3 objectPos = glm::vec3(10.0f, 0.0f, 10.0f); // Posición X y Z deseadas
+    // Añade un pequeño offset para que no quede enterrado o "flote" justo en la superficie
+    objectPos.y = terrainHeightField.heightAt(objectPos.x, objectPos.z) + 0.01f;
+
+    // Billboards estaticos: las matrices se suben una sola vez y cada tipo se dibuja con una llamada
+    auto cocoBillboards = std::make_unique<StaticBillboardBatch>(newObjectVBO, textureId(cocoTexture));
+    cocoBillboards->setInstances({billboardMatrix(objectPos, 0.0f, 5.0f)}); // Ajusta el tamaño del PNG
+    auto arbolBillboards = std::make_unique<StaticBillboardBatch>(newObjectVBO, textureId(arbolTexture));
+    arbolBillboards->setInstances(arbolesMatrices);
+    checkGLError("Static billboard instances");
+
+    // --- Culling: personajes y billboards en una sola BVH ---
+    // El terreno no entra: sus bloques ya se descartan con su propio quadtree (TerrainLod.hpp).
+    // El userData de cada proxy es su posicion en sceneObjects.
+    enum class SceneObjectKind { Character, Coco, Arbol };
+    struct SceneObject {
+        SceneObjectKind kind;
+        uint32_t index;
+    };
+    std::vector<SceneObject> sceneObjects;
+    Bvh sceneBvh;
+    auto addSceneObject = [&](SceneObjectKind kind, uint32_t index, const Aabb& box, float margin) {
+        uint32_t proxy = sceneBvh.add(box, static_cast<uint32_t>(sceneObjects.size()), margin);
+        sceneObjects.push_back({kind, index});
+        return proxy;
+    };
+    // Los personajes se mueven: margen de 1 unidad para no reajustar el arbol en cada paso
+    std::vector<uint32_t> characterProxies;
+    for (uint32_t i = 0; i < characters.size(); ++i) {
+        characterProxies.push_back(addSceneObject(SceneObjectKind::Character, i, characters[i]->getWorldBounds(), 1.0f));
     }
-    checkGLError("Heightmap texture loading");
+    for (uint32_t i = 0; i < (uint32_t)cocoBillboards->size(); ++i) {
+        addSceneObject(SceneObjectKind::Coco, i, billboardBounds(cocoBillboards->instance(i)), 0.0f);
+    }
+    for (uint32_t i = 0; i < (uint32_t)arbolBillboards->size(); ++i) {
+        addSceneObject(SceneObjectKind::Arbol, i, billboardBounds(arbolBillboards->instance(i)), 0.0f);
+    }
+    sceneBvh.build();
+    std::cout << "Main: Scene BVH with " << sceneBvh.size() << " objects, " << sceneBvh.nodeCount() << " nodes." << std::endl;
+
+    // Listas visibles de cada frame (se reutilizan para no reservar memoria)
+    std::vector<uint32_t> visibleObjects;
+    std::vector<uint32_t> visibleCharacters, visibleCocos, visibleArboles;
+    std::vector<Aabb> characterBounds;
+    std::vector<uint8_t> characterVisible;
 
     
-    //float heightmapPixelSize = 1.0f / heightmapWidth; // Asumiendo width = height para simplificar
-    
-    float heightmapPixelSize = 1.0f / heightmapWidth;//Produce normales más suaves y realistas.
 
     // Establece la posición inicial del personaje en X=0, Z=0 y la altura Y del terreno
     // Agrega un pequeño offset (+0.5f o +1.0f) si el pivote de tu modelo no está en la base de los pies.
@@ -909,6 +794,21 @@ modelArbolTextureID = cargarTextura("Resources/arbol.png") ; // ID de la textura
     glm::vec3 cameraOffset = glm::vec3(0.0f, 5.0f, 10.0f);
 
 
+    // Cola de dibujo del frame y cache del estado GL. La carga toco el estado por fuera de la cache.
+    RenderQueue renderQueue;
+    GlStateCache glState;
+    glState.invalidate();
+    float lastRenderStatsTime = 0.0f;
+
+    // K alterna el skinning de los personajes entre el vertex shader y la CPU (VBO dinamico)
+    bool cpuSkinning = false;
+    bool cpuSkinningKeyDown = false;
+    std::vector<SkinningJob> skinningJobs;
+
+    // Personajes: todas las instancias de un modelo en un dibujo instanciado por mesh
+    SkinnedCharacterRenderer characterRenderer;
+    std::vector<const AnimatedModel*> visibleCharacterModels;
+
     float lastTime = glfwGetTime();
     std::cout << "Main: Entering main loop." << std::endl;    
 
@@ -946,33 +846,37 @@ modelArbolTextureID = cargarTextura("Resources/arbol.png") ; // ID de la textura
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, true);
         }
+        bool cpuSkinningKey = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+        if (cpuSkinningKey && !cpuSkinningKeyDown) {
+            cpuSkinning = !cpuSkinning;
+            for (auto& character : characters) {
+                character->setCpuSkinning(cpuSkinning);
+            }
+            glState.invalidate(); // setCpuSkinning crea VAOs por fuera de la cache
+            std::cout << "Main: Skinning on the " << (cpuSkinning ? "CPU" : "GPU") << std::endl;
+        }
+        cpuSkinningKeyDown = cpuSkinningKey;
 
         // Después de que characterPosition.x y .z se han actualizado,
         // recalcula la altura Y del terreno en la nueva posición XZ del personaje.
-        float currentTerrainHeight = getTerrainHeight(
-            characterPosition.x,
-            characterPosition.z,
-            terrainWidth,          // Variable que define el ancho del terreno
-            terrainDepth,          // Variable que define la profundidad del terreno
-            terrainBaseY,          // Variable que define el offset Y base
-            currentHeightScale,    // ¡IMPORTANTE! Usar la misma currentHeightScale que en el shader
-            heightmapCpuData,      // Los datos de la imagen del heightmap
-            heightmapWidth,
-            heightmapHeight,
-            heightmapNrChannels
-        );
+        float currentTerrainHeight = terrainHeightField.heightAt(characterPosition.x, characterPosition.z);
         
         // El +0.5f (o el valor que uses) es para ajustar si el pivote del modelo no está en sus pies.
         characterPosition.y = currentTerrainHeight + 0.5f;         
 
         AnimatedModel* playerCharacter = characters[currentCharacterIndex].get(); // El personaje que el jugador controla
+        playerCharacter->position = characterPosition;
+        playerCharacter->rotationY = characterRotationY;
+        bool walking = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+        playerCharacter->setMovementSpeed(walking ? 10.0f : 0.0f);
 
         glm::vec3 currentCameraPos = characterPosition + glm::vec3(0.0f, cameraOffset.y, cameraOffset.z);
         glm::mat4 view = glm::lookAt(currentCameraPos,
                                      characterPosition,
                                      glm::vec3(0.0f, 1.0f, 0.0f));
 
-        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)width / (float)height, 0.5f, 500.0f); 
+        const float cameraFovY = glm::radians(60.0f);
+        glm::mat4 projection = glm::perspective(cameraFovY, (float)width / (float)height, 0.5f, 500.0f);
         checkGLError("Projection Matrix Setup");
 
         glm::vec3 lightPos = currentCameraPos + glm::vec3(0.0f, 2.0f, -3.0f); // Posición de la luz
@@ -980,224 +884,207 @@ modelArbolTextureID = cargarTextura("Resources/arbol.png") ; // ID de la textura
         float ambientStrength = 0.5f;
         float diffuseStrength = 0.8f;
 
+        // --- Culling: la lista de visibles se decide antes de emitir ningun draw ---
+        Frustum viewFrustum = Frustum::fromMatrix(projection * view);
+        characterBounds.resize(characters.size());
+        for (size_t i = 0; i < characters.size(); ++i) {
+            characterBounds[i] = characters[i]->getWorldBounds();
+            sceneBvh.update(characterProxies[i], characterBounds[i]);
+        }
+        sceneBvh.refresh();
+        visibleObjects.clear();
+        sceneBvh.cull(viewFrustum, visibleObjects);
+        visibleCharacters.clear();
+        visibleCocos.clear();
+        visibleArboles.clear();
+        for (uint32_t objectId : visibleObjects) {
+            const SceneObject& object = sceneObjects[objectId];
+            switch (object.kind) {
+                case SceneObjectKind::Character: visibleCharacters.push_back(object.index); break;
+                case SceneObjectKind::Coco: visibleCocos.push_back(object.index); break;
+                case SceneObjectKind::Arbol: visibleArboles.push_back(object.index); break;
+            }
+        }
+        // En orden fijo, para que los billboards solo vuelvan a subir instancias si el conjunto cambia
+        std::sort(visibleCocos.begin(), visibleCocos.end());
+        std::sort(visibleArboles.begin(), visibleArboles.end());
+
+        // Paletas de huesos de todos los personajes (sin llamadas GL, se suben en Draw). Los que no se
+        // ven solo avanzan el reloj; los pequeños o lejanos se evaluan menos a menudo y se interpolan,
+        // y los del fondo se dibujan con la pose horneada del frame que les toca.
+        characterVisible.assign(characters.size(), 0);
+        for (uint32_t characterIndex : visibleCharacters) {
+            characterVisible[characterIndex] = 1;
+        }
+        const float tanHalfFovY = std::tan(cameraFovY * 0.5f);
+        for (size_t i = 0; i < characters.size(); ++i) {
+            glm::vec3 offset = characterBounds[i].center() - currentCameraPos;
+            float distance = std::sqrt(glm::dot(offset, offset));
+            float screenSize = projectedScreenSize(characterBounds[i], currentCameraPos, tanHalfFovY);
+            bool bakedAvailable = !characters[i]->getAsset().bakedPoses().empty() && !characters[i]->usesCpuSkinning() &&
+                                  characterRenderer.bakedPosesFit(characters[i]->getAsset());
+            AnimationLodTier tier = selectAnimationLodTier(animationLod.settings, characterVisible[i] != 0, screenSize, distance, bakedAvailable);
+            animationLod.setTier(i, tier);
+            characters[i]->setBakedPlayback(tier == AnimationLodTier::Baked);
+        }
+        animationLod.update(animationWorkers, deltaTime);
+
+        // Skinning en CPU de los personajes visibles, todos los meshes repartidos entre los hilos
+        skinningJobs.clear();
+        for (uint32_t characterIndex : visibleCharacters) {
+            if (characters[characterIndex]->usesCpuSkinning()) {
+                characters[characterIndex]->appendSkinningJobs(skinningJobs);
+            }
+        }
+        if (!skinningJobs.empty()) {
+            skinMeshes(animationWorkers, skinningJobs);
+            for (uint32_t characterIndex : visibleCharacters) {
+                if (characters[characterIndex]->usesCpuSkinning()) {
+                    characters[characterIndex]->uploadSkinnedVertices();
+                }
+            }
+        }
 
-
-
-        // --- Dibujar el personaje principal (controlable) ---
-        glUseProgram(playerCharacter->shaderProgram); 
-        checkGLError("glUseProgram for player character");
-
-        glm::mat4 playerModelMat = glm::mat4(1.0f);
-        playerModelMat = glm::translate(playerModelMat, characterPosition);
-        playerModelMat = glm::rotate(playerModelMat, characterRotationY, glm::vec3(0.0f, 1.0f, 0.0f));
-        playerModelMat = glm::scale(playerModelMat, glm::vec3(0.5f)); 
-        glUniformMatrix4fv(glGetUniformLocation(playerCharacter->shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(playerModelMat));
-        glUniformMatrix4fv(glGetUniformLocation(playerCharacter->shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(playerCharacter->shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        
-        glUniform3fv(glGetUniformLocation(playerCharacter->shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
-        glUniform3fv(glGetUniformLocation(playerCharacter->shaderProgram, "viewPos"), 1, glm::value_ptr(currentCameraPos));
-        glUniform3fv(glGetUniformLocation(playerCharacter->shaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
-        glUniform1f(glGetUniformLocation(playerCharacter->shaderProgram, "ambientStrength"), ambientStrength);
-        glUniform1f(glGetUniformLocation(playerCharacter->shaderProgram, "diffuseStrength"), diffuseStrength); 
+        // --- Uniforms del frame, una vez por programa ---
+        const SkinnedShader& characterShader = playerCharacter->getShader();
+        glState.useProgram(characterShader.program.id());
+        setUniform(characterShader.view, view);
+        setUniform(characterShader.projection, projection);
+        setUniform(characterShader.lightPos, lightPos);
+        setUniform(characterShader.viewPos, currentCameraPos);
+        setUniform(characterShader.lightColor, lightColor);
+        setUniform(characterShader.ambientStrength, ambientStrength);
+        setUniform(characterShader.diffuseStrength, diffuseStrength);
         checkGLError("Uniforms for player character");
 
-        playerCharacter->updateAnimation(deltaTime);
-        playerCharacter->Draw(); 
-        checkGLError("playerCharacter->Draw()");
-
-
-        
-
-        // --- Dibujar el suelo ---
-        glUseProgram(floorShaderProgram); 
-        checkGLError("glUseProgram for floor");
-        
+        glState.useProgram(floorShader.id());
         glm::mat4 floorModelMat = glm::mat4(1.0f); 
-        glUniformMatrix4fv(glGetUniformLocation(floorShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(floorModelMat));
-        glUniformMatrix4fv(glGetUniformLocation(floorShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view)); 
-        glUniformMatrix4fv(glGetUniformLocation(floorShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection)); 
-        
-        // Send lighting uniforms for the floor
-        glUniform3fv(glGetUniformLocation(floorShaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
-        glUniform3fv(glGetUniformLocation(floorShaderProgram, "viewPos"), 1, glm::value_ptr(currentCameraPos));
-        glUniform3fv(glGetUniformLocation(floorShaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
-        glUniform1f(glGetUniformLocation(floorShaderProgram, "ambientStrength"), ambientStrength);
-        glUniform1f(glGetUniformLocation(floorShaderProgram, "diffuseStrength"), diffuseStrength); 
-        
-        glActiveTexture(GL_TEXTURE0); // Unidad 0 para la textura de hierba
-        glBindTexture(GL_TEXTURE_2D, floorTextureID);
-        glUniform1i(glGetUniformLocation(floorShaderProgram, "ourTexture"), 0); 
-
-        glActiveTexture(GL_TEXTURE1); // Unidad 1 para la textura del heightmap
-        glBindTexture(GL_TEXTURE_2D, heightmapTextureID);
-        glUniform1i(glGetUniformLocation(floorShaderProgram, "heightmap"), 1);
-
-
-        glActiveTexture(GL_TEXTURE2); // Unidad 2 para la arena
-        glBindTexture(GL_TEXTURE_2D, sandTextureID);
-        glUniform1i(glGetUniformLocation(floorShaderProgram, "sandTexture"), 2);
-
-        glActiveTexture(GL_TEXTURE3); // Unidad 3 para la roca
-        glBindTexture(GL_TEXTURE_2D, rockTextureID);
-        glUniform1i(glGetUniformLocation(floorShaderProgram, "rockTexture"), 3);
-        glUniform1f(glGetUniformLocation(floorShaderProgram, "sampleDist"), heightmapPixelSize);
-
-        glActiveTexture(GL_TEXTURE4); // Unidad 4 para la nieve
-        glBindTexture(GL_TEXTURE_2D, snowTextureID);
-        glUniform1i(glGetUniformLocation(floorShaderProgram, "snowTexture"), 4);
-
+        setUniform(floorUniforms.model, floorModelMat);
+        glm::mat3 floorNormalMat = glm::mat3(glm::transpose(glm::inverse(floorModelMat)));
+        setUniform(floorUniforms.normalMatrix, floorNormalMat);
+        setUniform(floorUniforms.displaceInShader, terrainDisplaceInShader);
+        setUniform(floorUniforms.gridFromVertexId, terrainFromVertexId);
+        setUniform(floorUniforms.patchVerticesPerRow, terrainLod.patchVerticesPerRow());
+        setUniform(floorUniforms.gridQuads, glm::vec2(terrainResolutionX - 1, terrainResolutionZ - 1));
+        setUniform(floorUniforms.terrainSize, glm::vec2(terrainWidth, terrainDepth));
+        setUniform(floorUniforms.view, view);
+        setUniform(floorUniforms.projection, projection);
+        setUniform(floorUniforms.lightPos, lightPos);
+        setUniform(floorUniforms.viewPos, currentCameraPos);
+        setUniform(floorUniforms.lightColor, lightColor);
+        setUniform(floorUniforms.ambientStrength, ambientStrength);
+        setUniform(floorUniforms.diffuseStrength, diffuseStrength);
+        setUniform(floorUniforms.sampleDist, heightmapPixelSize);
         // Uniforms de escala para el heightmap y repetición de hierba
-        glUniform1f(glGetUniformLocation(floorShaderProgram, "heightScale"),  currentHeightScale);//;40.0f); // Puedes ajustar este valor
-        glUniform1f(glGetUniformLocation(floorShaderProgram, "terrainYOffset"), -16.01f);
-        glUniform2f(glGetUniformLocation(floorShaderProgram, "grassTexRepeat"), 24.0f, 24.0f); // Ajustado para un terreno 100x100
+        setUniform(floorUniforms.heightScale, currentHeightScale);
+        setUniform(floorUniforms.terrainYOffset, -16.01f);
+        setUniform(floorUniforms.grassTexRepeat, glm::vec2(24.0f, 24.0f)); // Ajustado para un terreno 100x100
         checkGLError("Uniforms for floor");
 
-        glBindVertexArray(floorVAO);
-        checkGLError("glBindVertexArray for floor draw");
-
-        // Dibujar con glDrawElements en lugar de glDrawArrays ---
-        glDrawElements(GL_TRIANGLES, floorIndicesVec.size(), GL_UNSIGNED_INT, 0);
-        checkGLError("glDrawElements for floor");
-        
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0); 
-        checkGLError("Unbind VAO/Texture for floor");
-
-
-
-//-------NEWOBJ-----
-///*
-        // --- Posición del nuevo objeto PNG ---
-        glm::vec3 objectPosXZ = glm::vec3(10.0f, 0.0f, 10.0f); // Posición X y Z deseadas
-        // Usa getTerrainHeight para obtener la altura Y en esa posición
-  
-        float objectY = getTerrainHeight(
-            objectPosXZ.x,
-            objectPosXZ.z,
-            terrainWidth,          // Variable que define el ancho del terreno
-            terrainDepth,          // Variable que define la profundidad del terreno
-            terrainBaseY,          // Variable que define el offset Y base
-            currentHeightScale,    // ¡IMPORTANTE! Usar la misma currentHeightScale que en el shader
-            heightmapCpuData,      // Los datos de la imagen del heightmap
-            heightmapWidth,
-            heightmapHeight,
-            heightmapNrChannels
-        );
-        
-        // Añade un pequeño offset para que no quede enterrado o "flote" justo en la superficie
-        objectY += 0.01f; // Ajusta este valor si el objeto se ve hundido o flotando
-
-        // --- Dibujar el nuevo objeto PNG ---
-        glUseProgram(objectShaderProgram); // Activa el shader del objeto
-        checkGLError("glUseProgram for new object");
-
-        glm::mat4 objectModelMat = glm::mat4(1.0f);
-        objectModelMat = glm::translate(objectModelMat, glm::vec3(objectPosXZ.x, objectY, objectPosXZ.z));
-       // objectModelMat = glm::rotate(objectModelMat, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Si es un quad vertical
-        objectModelMat = glm::scale(objectModelMat, glm::vec3(5.0f)); // Ajusta el tamaño del PNG
-
-/*
-glm::mat4 model = glm::mat4(1.0f);
-model = glm::translate(model, glm::vec3(posX, posY, posZ)); // Posición donde quieres colocarla
-model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rota 90° en X para que quede vertical
-model = glm::scale(model, glm::vec3(escalaX, escalaY, escalaZ)); // Ajusta el tamaño
-*/
-
-
-
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(objectModelMat));
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        
-        glActiveTexture(GL_TEXTURE0); // Usar la unidad de textura 0 para el objeto
-        glBindTexture(GL_TEXTURE_2D, newObjectTextureID);
-        glUniform1i(glGetUniformLocation(objectShaderProgram, "ourTexture"), 0);
-
-
-glEnable(GL_BLEND);
-glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Fórmula estándar para transparencias
-
-
-        glBindVertexArray(newObjectVAO);
-        // Usar glDrawArrays para un quad de 4 vértices sin EBO
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4); // O GL_TRIANGLES si usaste índices para el quad
-        // Si creaste un EBO para el quad: glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-        checkGLError("glDrawArrays for new object");
-        
-        //ABAJOSESIGUEUSANDOELMISMOVAO  glBindVertexArray(0); // Desenlazar VAO
-        glBindTexture(GL_TEXTURE_2D, 0); // Desenlazar textura
-
-//*/
+        glState.useProgram(objectShader.id());
+        setUniform(objectViewUniform, view);
+        setUniform(objectProjectionUniform, projection);
+        checkGLError("Uniforms for billboards");
 
+        // --- Cola de dibujo: personajes, bloques del terreno y billboards ---
+        renderQueue.clear();
+        visibleCharacterModels.clear();
+        for (uint32_t characterIndex : visibleCharacters) {
+            visibleCharacterModels.push_back(characters[characterIndex].get());
+        }
+        characterRenderer.enqueue(visibleCharacterModels, currentCameraPos, renderQueue);
+        glState.bindTextureBuffer(kBonePaletteTextureUnit, characterRenderer.paletteTexture());
+        glState.bindTextureBuffer(kBakedPoseTextureUnit, characterRenderer.bakedPoseTexture());
+        glState.bindTexture2D(kTerrainGridTextureUnit, terrainGridTexture);
+
+        // Solo los bloques dentro del frustum, cada uno con su nivel de detalle.
+        // Texturas: hierba, heightmap, arena, roca, nieve y mapa de mezcla en las unidades 0 a 5 (ver setSampler)
+        terrainLod.select(viewFrustum, currentCameraPos, terrainLodDistance, terrainDraws);
+        DrawItem floorItem;
+        floorItem.program = floorShader.id();
+        floorItem.vao = floorVAO;
+        floorItem.textures[0] = textureId(floorTexture);
+        floorItem.textures[1] = textureId(heightmapTexture);
+        floorItem.textures[2] = textureId(sandTexture);
+        floorItem.textures[3] = textureId(rockTexture);
+        floorItem.textures[4] = textureId(snowTexture);
+        floorItem.textures[5] = textureId(splatTexture);
+        floorItem.textureCount = 6;
+        if (terrainFromVertexId) {
+            // Una tira por bloque con su esquina como uniform; el vector no crece durante el frame
+            floorItem.mode = GL_TRIANGLE_STRIP;
+            floorItem.indexType = GL_UNSIGNED_SHORT;
+            floorItem.primitiveRestart = true;
+            floorItem.setup = &TerrainPatchSetup::apply;
+            terrainPatchSetups.clear();
+            for (const TerrainChunkDraw& draw : terrainDraws) {
+                terrainPatchSetups.push_back({&floorUniforms.patchOrigin, glm::vec2(draw.originX, draw.originZ)});
+                floorItem.context = &terrainPatchSetups.back();
+                floorItem.count = static_cast<GLsizei>(draw.stripCount);
+                floorItem.indexOffset = draw.stripOffset * sizeof(uint16_t);
+                renderQueue.add(floorItem, draw.distance);
+            }
+        } else {
+            for (const TerrainChunkDraw& draw : terrainDraws) {
+                floorItem.count = static_cast<GLsizei>(draw.indexCount);
+                floorItem.indexOffset = draw.indexOffset * sizeof(uint32_t);
+                floorItem.baseVertex = draw.baseVertex;
+                renderQueue.add(floorItem, draw.distance);
+            }
+        }
 
+        // Billboards estaticos (coco y arboles), transparentes: van despues de lo opaco
+        cocoBillboards->setVisible(visibleCocos);
+        arbolBillboards->setVisible(visibleArboles);
+        if (!visibleCocos.empty()) {
+            renderQueue.add(cocoBillboards->drawItem(objectShader.id()), glm::length(objectPos - currentCameraPos));
+        }
+        if (!visibleArboles.empty()) {
+            renderQueue.add(arbolBillboards->drawItem(objectShader.id()), 0.0f);
+        }
 
+        renderQueue.sort();
+        renderQueue.submit(glState);
+        checkGLError("RenderQueue::submit");
 
-////USARELDEARRIBA    glBindVertexArray(newObjectVAO);
-    //glEnable(GL_BLEND);  // Para transparencia
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    //glBindTexture(GL_TEXTURE_2D, tuTexturaPNG);  // Usa la textura PNG
-    glBindTexture(GL_TEXTURE_2D, modelArbolTextureID);
-
-    for (const auto& pos : arboles_pos) {
-        glm::mat4 model = glm::mat4(1.0f);
-
-
-glm::vec3 oo = pos;
- oo.y =  getTerrainHeight(
-            oo.x,
-            oo.z,
-            terrainWidth,          // Variable que define el ancho del terreno
-            terrainDepth,          // Variable que define la profundidad del terreno
-            terrainBaseY,          // Variable que define el offset Y base
-            currentHeightScale,    // ¡IMPORTANTE! Usar la misma currentHeightScale que en el shader
-            heightmapCpuData,      // Los datos de la imagen del heightmap
-            heightmapWidth,
-            heightmapHeight,
-            heightmapNrChannels
-        );
-
-
-
-
-        model = glm::translate(model, oo);  // Posición del objeto
-        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));  // Rotación vertical
-        model = glm::scale(model, glm::vec3(10.0f));  // Escala (ajústala)
-        
-        // Pasa la matriz "model" al shader
-        glUniformMatrix4fv(glGetUniformLocation(objectShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-     //   glDrawArrays(GL_TRIANGLES, 0, 6);
-    //}
-      //  
-    
-    // Dibuja el quad (rectángulo con la textura)
-    //    glBindVertexArray(quadVAO);  // Asume que ya tienes un VAO para un quad
-
-//glBindVertexArray(newObjectVAO);
-
-      //funciono raro...glDrawArrays(GL_TRIANGLES, 0, 6);
-      glDrawArrays(GL_TRIANGLE_FAN, 0, 4); // O GL_TRIANGLES si usaste índices para el quad
-    }
-    glBindVertexArray(0); // Desenlazar VAO
-/*OPCIONAL MUCHOS OBJETOS MAS OPTIMO
-// Configura un buffer con las matrices de modelo
-GLuint instanceVBO;
-glGenBuffers(1, &instanceVBO);
-glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * posiciones.size(), &modelMatrices[0], GL_STATIC_DRAW);
-
-// Dibuja todos los objetos en una llamada
-glBindVertexArray(quadVAO);
-glDrawArraysInstanced(GL_TRIANGLES, 0, 6, posiciones.size());
-*/
-//-------------------------------
-
-
-
+        // Las texturas dibujadas este frame pasan al frente del orden LRU del gestor
+        for (const DrawItem& item : renderQueue.drawItems()) {
+            for (int unit = 0; unit < item.textureCount; ++unit) {
+                textureManager.touch(item.textures[unit]);
+            }
+        }
+        if (textureManager.endFrame()) {
+            glState.invalidate(); // Liberar o reducir texturas cambia los enlaces de GL_TEXTURE_2D
+        }
 
+        // Cada 5 s: cambios de estado enviados frente a los que la cache se ahorro en el ultimo frame
+        if (currentTime - lastRenderStatsTime >= 5.0f) {
+            const RenderStateStats& stats = glState.stats;
+            std::cout << "Render: " << stats.drawCalls << " draws, " << stats.changes() << " state changes, "
+                      << stats.avoided() << " avoided (program " << stats.programSkipped << ", VAO " << stats.vaoSkipped
+                      << ", texture " << stats.textureSkipped << ", blend " << stats.blendSkipped
+                      << ", object uniforms " << stats.uniformSetupsSkipped << ")" << std::endl;
+            std::cout << "Characters: " << characterRenderer.instanceCount() << " visible in " << characterRenderer.batchCount()
+                      << " batches (" << characterRenderer.bakedInstanceCount() << " with baked poses), bone palettes "
+                      << (characterRenderer.paletteBytes() >> 10) << " KiB, baked poses " << (characterRenderer.bakedPoseBytes() >> 10)
+                      << " KiB" << std::endl;
+            std::cout << "Animation LOD:";
+            for (size_t t = 0; t < kAnimationLodTiers; ++t) {
+                const AnimationLodTier tier = static_cast<AnimationLodTier>(t);
+                const AnimationLodTierStats& lod = animationLod.tierStats(tier);
+                std::cout << (t ? "," : "") << " " << animationLodTierName(tier) << " " << lod.characters << " ("
+                          << lod.evaluated << " evaluated, " << lod.interpolated << " interpolated, " << lod.clockOnly
+                          << " clock only, " << lod.bonesSkipped << " bones skipped, every " << lod.interval << " frames, "
+                          << lod.milliseconds << " ms, " << lod.overBudgetFrames << " frames over budget)";
+            }
+            std::cout << std::endl;
+            const TextureManagerStats& textureStats = textureManager.statistics();
+            std::cout << "Textures: " << textureManager.size() << " resident, " << (textureManager.residentBytes() >> 20)
+                      << " MiB, " << textureStats.cookedLoads << " cooked, " << textureStats.cacheHits << " shared loads, " << textureStats.evictions << " evicted, "
+                      << textureStats.downsizes << " downsized" << std::endl;
+            lastRenderStatsTime = currentTime;
+        }
+        glState.resetStats();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -1205,29 +1092,27 @@ glDrawArraysInstanced(GL_TRIANGLES, 0, 6, posiciones.size());
     std::cout << "Main: Exiting main loop." << std::endl;
 
     // --- Free floor resources ---
-    glDeleteProgram(floorShaderProgram);
+    floorShader.release();
     glDeleteVertexArrays(1, &floorVAO);
     glDeleteBuffers(1, &floorVBO);
     glDeleteBuffers(1, &floorEBO);
-    glDeleteTextures(1, &floorTextureID); 
-    glDeleteTextures(1, &sandTextureID); 
-    glDeleteTextures(1, &rockTextureID); 
-    glDeleteTextures(1, &heightmapTextureID);
+    glDeleteTextures(1, &terrainGridTexture);
     checkGLError("Freeing floor resources");
 
-    if (heightmapCpuData) {
-        stbi_image_free(heightmapCpuData);
-        std::cout << "Heightmap CPU data freed." << std::endl;
-    }
 
 
 //-------NEWOBJ-----
-    glDeleteProgram(objectShaderProgram);
+    cocoBillboards.reset();
+    arbolBillboards.reset();
+    objectShader.release();
     glDeleteVertexArrays(1, &newObjectVAO);
     glDeleteBuffers(1, &newObjectVBO);
-    glDeleteTextures(1, &newObjectTextureID);
 
 
+    characterRenderer.release();
+
+    // Las texturas que aun referencian los modelos y handles se liberan aqui, con el contexto vivo
+    textureManager.shutdown();
 
     glfwTerminate();
     std::cout << "Main: GLFW terminated." << std::endl;